@@ -44,5 +44,35 @@ for test in $(ls src/test/c/reject/); do
 done
 echo ""
 
+echo "Compiler should draw the same image with any amount of threads..."
+echo ""
+
+for test in $(ls src/test/c/threads/); do
+	cat "src/test/c/threads/$test" | ".build/Flex-Bison-Compiler" $OUTPUT_DIR/$test.1.bmp --threads=1 >/dev/null 2>&1
+	cat "src/test/c/threads/$test" | ".build/Flex-Bison-Compiler" $OUTPUT_DIR/$test.4.bmp --threads=4 >/dev/null 2>&1
+	if cmp -s "$OUTPUT_DIR/$test.1.bmp" "$OUTPUT_DIR/$test.4.bmp"; then
+		echo -e "    $test, ${GREEN}and it does${OFF}"
+	else
+		STATUS=1
+		echo -e "    $test, ${RED}but it does not${OFF}"
+	fi
+done
+echo ""
+
+echo "Compiler should draw the same image with level of detail..."
+echo ""
+
+for test in $(ls src/test/c/lod/); do
+	cat "src/test/c/lod/$test" | ".build/Flex-Bison-Compiler" $OUTPUT_DIR/$test.bmp >/dev/null 2>&1
+	cat "src/test/c/lod/$test" | ".build/Flex-Bison-Compiler" $OUTPUT_DIR/$test.lod.bmp --lod=true >/dev/null 2>&1
+	if cmp -s "$OUTPUT_DIR/$test.bmp" "$OUTPUT_DIR/$test.lod.bmp"; then
+		echo -e "    $test, ${GREEN}and it does${OFF}"
+	else
+		STATUS=1
+		echo -e "    $test, ${RED}but it does not${OFF}"
+	fi
+done
+echo ""
+
 echo "All done."
 exit $STATUS
\ No newline at end of file
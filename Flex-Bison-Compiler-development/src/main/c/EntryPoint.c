@@ -3,6 +3,7 @@
 #include "frontend/Frontend.h"
 #include "frontend/lexical-analysis/FlexActions.h"
 #include "frontend/syntactic-analysis/BisonActions.h"
+#include "support/configuration/RenderConfiguration.h"
 #include "support/logging/Logger.h"
 #include "support/type/CompilationStatus.h"
 #include "support/type/CompilerState.h"
@@ -21,7 +22,8 @@ const int main(const int length, const char ** arguments) {
 	}
 	CompilerState compilerState = {
 		.abstractSyntaxtTree = NULL,
-		.outputImageName = length > 1 ? compilerState.outputImageName = arguments[1] : "output.bmp"
+		.outputImageName = length > 1 ? compilerState.outputImageName = arguments[1] : "output.bmp",
+		.renderOptions = loadRenderOptions(length, arguments)
 	};
 
 	ModuleDestructor moduleDestructors[] = {
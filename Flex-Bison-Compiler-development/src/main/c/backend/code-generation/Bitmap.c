@@ -34,18 +34,109 @@ void clearBitmap(Bitmap * bitmap, RGBColor color) {
     }
 }
 
+/* Código de Cohen-Sutherland del punto: un bit por cada lado de la caja del que queda afuera. */
+static int outcode(int x, int y, int minX, int minY, int maxX, int maxY) {
+    return (x < minX) | (x > maxX) << 1 | (y < minY) << 2 | (y > maxY) << 3;
+}
+
+int lineMayBeVisible(const Bitmap * bitmap, int x0, int y0, int x1, int y1) {
+    int maxX = bitmap->width - 1, maxY = bitmap->height - 1;
+    return (outcode(x0, y0, 0, 0, maxX, maxY) & outcode(x1, y1, 0, 0, maxX, maxY)) == 0;
+}
+
+typedef __int128 wide;
+
+/* Redondea n / d hacia arriba, con d > 0. */
+static wide ceilDivide(wide n, wide d) {
+    return n >= 0 ? (n + d - 1) / d : -((-n) / d);
+}
+
+/*
+ * Paso de la recta en que la coordenada menor alcanza "minor" (el primero con
+ * f(k) >= minor), donde f(k) = floor((2 * dMinor * k + dMajor) / (2 * dMajor))
+ * es cuántas veces avanzó la coordenada menor en el paso k del eje mayor.
+ */
+static wide firstStepReaching(wide minor, wide dMajor, wide dMinor) {
+    if (minor <= 0) return 0;
+    return ceilDivide(2 * dMajor * minor - dMajor, 2 * dMinor);
+}
+
+/* Escribe "count" + 1 píxeles de la recta desde "pixel", con el error de Zingl en "err". */
+static inline void walkLine(Bitmap * bitmap, RGBColor * pixel, int64_t err, int64_t deltaX, int64_t deltaY, int sx, int sy, int64_t count, RGBColor color) {
+    int64_t stepY = (int64_t)sy * bitmap->width;
+    for (; ; count--) {
+        *pixel = color;
+        if (count == 0) break;
+        int64_t e2 = 2 * err;
+        if (e2 >= -deltaY) { err -= deltaY; pixel += sx; }
+        if (e2 <= deltaX) { err += deltaX; pixel += stepY; }
+    }
+}
+
 void drawLine(Bitmap * bitmap, int x0, int y0, int x1, int y1, RGBColor color) {
-    int dx = abs(x1 - x0), sx = x0 < x1 ? 1 : -1;
-    int dy = -abs(y1 - y0), sy = y0 < y1 ? 1 : -1;
-    int err = dx + dy, e2;
-
-    while (1) {
-        setPixel(bitmap, x0, y0, color);
-        if (x0 == x1 && y0 == y1) break;
-        e2 = 2 * err;
-        if (e2 >= dy) { err += dy; x0 += sx; }
-        if (e2 <= dx) { err += dx; y0 += sy; }
+    drawLineInBox(bitmap, x0, y0, x1, y1, color, 0, 0, bitmap->width - 1, bitmap->height - 1);
+}
+
+/*
+ * Bresenham (la variante simétrica de Zingl), recortado a la caja de modo
+ * exacto: el píxel del paso k del eje mayor está en a0 + sa * k y
+ * b0 + sb * f(k) (ver firstStepReaching), así que el rango de pasos visibles
+ * se calcula directamente, el error se inicializa en el primero de ellos, y
+ * el ciclo escribe sólo esos píxeles, sin mirar los bordes. Dibuja los mismos
+ * píxeles que recorriendo la recta entera y descartando los de afuera.
+ */
+void drawLineInBox(Bitmap * bitmap, int x0, int y0, int x1, int y1, RGBColor color, int minX, int minY, int maxX, int maxY) {
+    int code0 = outcode(x0, y0, minX, minY, maxX, maxY), code1 = outcode(x1, y1, minX, minY, maxX, maxY);
+    if (code0 & code1) return;
+    if ((code0 | code1) == 0) {
+        /* Los dos extremos adentro: la recta entera, sin recortar. */
+        int64_t deltaX = abs(x1 - x0), deltaY = abs(y1 - y0);
+        walkLine(bitmap, bitmap->pixels + (int64_t)y0 * bitmap->width + x0, deltaX - deltaY, deltaX, deltaY,
+            x0 < x1 ? 1 : -1, y0 < y1 ? 1 : -1, deltaX > deltaY ? deltaX : deltaY, color);
+        return;
     }
+
+    wide dx = x1 > x0 ? (wide)x1 - x0 : (wide)x0 - x1;
+    wide dy = y1 > y0 ? (wide)y1 - y0 : (wide)y0 - y1;
+    int sx = x0 < x1 ? 1 : -1;
+    int sy = y0 < y1 ? 1 : -1;
+
+    /* Eje mayor "a" y menor "b"; con dx == dy las dos formas dan la diagonal. */
+    int xMajor = dx >= dy;
+    wide dMajor = xMajor ? dx : dy, dMinor = xMajor ? dy : dx;
+    wide a0 = xMajor ? x0 : y0, b0 = xMajor ? y0 : x0;
+    int sa = xMajor ? sx : sy, sb = xMajor ? sy : sx;
+    wide minA = xMajor ? minX : minY, maxA = xMajor ? maxX : maxY;
+    wide minB = xMajor ? minY : minX, maxB = xMajor ? maxY : maxX;
+
+    /* Pasos en que la coordenada mayor está adentro. */
+    wide first = sa > 0 ? minA - a0 : a0 - maxA;
+    wide last = sa > 0 ? maxA - a0 : a0 - minA;
+    if (first < 0) first = 0;
+    if (last > dMajor) last = dMajor;
+
+    /* Pasos en que f(k) está en [lowB, highB], o sea la coordenada menor adentro. */
+    wide lowB = sb > 0 ? minB - b0 : b0 - maxB;
+    wide highB = sb > 0 ? maxB - b0 : b0 - minB;
+    if (highB < 0) return;
+    if (dMinor > 0) {
+        wide low = firstStepReaching(lowB, dMajor, dMinor);
+        wide high = firstStepReaching(highB + 1, dMajor, dMinor) - 1;
+        if (low > first) first = low;
+        if (high < last) last = high;
+    } else if (lowB > 0) {
+        return;
+    }
+    if (first > last) return;
+
+    wide minorSteps = dMajor > 0 ? (2 * dMinor * first + dMajor) / (2 * dMajor) : 0;
+    wide xSteps = xMajor ? first : minorSteps;
+    wide ySteps = xMajor ? minorSteps : first;
+
+    /* El error de Zingl después de i pasos en x y j en y es dx (j + 1) - dy (i + 1). */
+    int64_t err = (int64_t)(dx * (ySteps + 1) - dy * (xSteps + 1));
+    RGBColor * pixel = bitmap->pixels + (int64_t)(y0 + sy * ySteps) * bitmap->width + (int64_t)(x0 + sx * xSteps);
+    walkLine(bitmap, pixel, err, (int64_t)dx, (int64_t)dy, sx, sy, (int64_t)(last - first), color);
 }
 
 void saveBitmap(Bitmap * bitmap, const char * filename) {
@@ -85,12 +176,10 @@ void saveBitmap(Bitmap * bitmap, const char * filename) {
     fwrite(fileHeader, 1, 14, f);
     fwrite(infoHeader, 1, 40, f);
 
+    // RGBColor ya está en el orden del archivo (B, G, R, sin relleno): cada fila se escribe de una vez.
     unsigned char padding[3] = {0, 0, 0};
     for (int y = 0; y < h; y++) {
-        for (int x = 0; x < w; x++) {
-            RGBColor p = bitmap->pixels[y * w + x];
-            fwrite(&p, 1, 3, f); // Escribe B, G, R
-        }
+        fwrite(bitmap->pixels + (size_t)y * w, sizeof(RGBColor), w, f);
         fwrite(padding, 1, paddedRowSize - (w * 3), f);
     }
 
@@ -6,12 +6,15 @@
 #include <stdlib.h>
 #include "../../support/logging/Logger.h"
 
+/** Un píxel con el orden y el tamaño (3 bytes) de los del archivo .bmp. */
 typedef struct {
     uint8_t b;
     uint8_t g;
     uint8_t r;
 } RGBColor;
 
+_Static_assert(sizeof(RGBColor) == 3, "RGBColor debe tener el tamaño de un píxel del .bmp");
+
 typedef struct {
     int width;
     int height;
@@ -33,7 +36,22 @@ void saveBitmap(Bitmap * bitmap, const char * filename);
 /** Limpia el bitmap con un color de fondo */
 void clearBitmap(Bitmap * bitmap, RGBColor color);
 
-/** Dibuja una línea usando el algoritmo de Bresenham */
+/**
+ * Si la línea puede tener píxeles en el bitmap: es falso cuando sus dos
+ * extremos quedan del mismo lado de afuera (Cohen-Sutherland), y entonces se
+ * puede descartar sin rasterizarla.
+ */
+int lineMayBeVisible(const Bitmap * bitmap, int x0, int y0, int x1, int y1);
+
+/** Dibuja una línea usando el algoritmo de Bresenham, recortada al bitmap */
 void drawLine(Bitmap * bitmap, int x0, int y0, int x1, int y1, RGBColor color);
 
+/**
+ * Dibuja sólo los píxeles de la línea de drawLine que caen en la caja
+ * [minX, maxX] x [minY, maxY], que tiene que estar dentro del bitmap: las
+ * cajas que cubren el bitmap sin superponerse dibujan, entre todas, lo mismo
+ * que drawLine.
+ */
+void drawLineInBox(Bitmap * bitmap, int x0, int y0, int x1, int y1, RGBColor color, int minX, int minY, int maxX, int maxY);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,103 @@
+#ifndef COMPLEX_HEADER
+#define COMPLEX_HEADER
+
+#include <math.h>
+#include <string.h>
+
+/** Número complejo en doble precisión, usado por las fórmulas de escape. */
+typedef struct
+{
+    double re;
+    double im;
+} Complex;
+
+static inline Complex makeComplex(double re, double im)
+{
+    Complex c;
+    c.re = re;
+    c.im = im;
+    return c;
+}
+
+static inline Complex complexAdd(Complex a, Complex b)
+{
+    return makeComplex(a.re + b.re, a.im + b.im);
+}
+
+static inline Complex complexSub(Complex a, Complex b)
+{
+    return makeComplex(a.re - b.re, a.im - b.im);
+}
+
+static inline Complex complexMul(Complex a, Complex b)
+{
+    return makeComplex(a.re * b.re - a.im * b.im,
+                       a.re * b.im + a.im * b.re);
+}
+
+static inline Complex complexDiv(Complex a, Complex b)
+{
+    double den = b.re * b.re + b.im * b.im;
+    if (den == 0.0)
+        return makeComplex(0.0, 0.0);
+    return makeComplex((a.re * b.re + a.im * b.im) / den,
+                       (a.im * b.re - a.re * b.im) / den);
+}
+
+static inline double complexAbs(Complex a)
+{
+    return sqrt(a.re * a.re + a.im * a.im);
+}
+
+/*
+ * Igualdad bit a bit (distingue 0.0 de -0.0, y un NaN es igual a sí mismo).
+ * Es la que importa para saber si una órbita se repite exactamente.
+ */
+static inline int complexSameBits(Complex a, Complex b)
+{
+    return memcmp(&a.re, &b.re, sizeof(double)) == 0 && memcmp(&a.im, &b.im, sizeof(double)) == 0;
+}
+
+/* Norma al cuadrado: el radicando de complexAbs, con las mismas operaciones. */
+static inline double complexNorm(Complex a)
+{
+    return a.re * a.re + a.im * a.im;
+}
+
+/*
+ * Umbrales para comparar |z| contra k sin raíz. Como sqrt está correctamente
+ * redondeada, es monótona: el conjunto de normas m con sqrt(m) <= k es un
+ * intervalo, y basta con buscar (con nextafter) su extremo exacto. Así,
+ * "sqrt(m) > k" vale exactamente cuando "m > complexAbsAboveThreshold(k)", y
+ * "sqrt(m) < k" exactamente cuando "m < complexAbsBelowThreshold(k)", incluso
+ * con NaN e infinitos.
+ */
+static inline double complexAbsAboveThreshold(double k)
+{
+    if (isnan(k) || isinf(k))
+        return k;
+    if (k < 0.0)
+        return -INFINITY;
+    double t = k * k;
+    while (sqrt(t) > k)
+        t = nextafter(t, -INFINITY);
+    while (sqrt(nextafter(t, INFINITY)) <= k)
+        t = nextafter(t, INFINITY);
+    return t;
+}
+
+static inline double complexAbsBelowThreshold(double k)
+{
+    if (isnan(k) || isinf(k))
+        return k;
+    if (k <= 0.0)
+        return -INFINITY;
+    double t = k * k;
+    while (sqrt(t) < k)
+        t = nextafter(t, INFINITY);
+    while (sqrt(nextafter(t, -INFINITY)) >= k)
+        t = nextafter(t, -INFINITY);
+    return t;
+}
+
+#endif
@@ -0,0 +1,190 @@
+#ifndef DOUBLE_DOUBLE_HEADER
+#define DOUBLE_DOUBLE_HEADER
+
+#include "Complex.h"
+
+/*
+ * Aritmética double-double: cada real es la suma no evaluada hi + lo de dos
+ * doubles que no se solapan, unos 106 bits de mantisa. Las operaciones usan
+ * las transformaciones exactas de Dekker y Knuth (twoSum y twoProd), que
+ * dependen de que cada operación se redondee por separado: este archivo no se
+ * debe compilar con FMA ni con -ffast-math.
+ */
+typedef struct
+{
+    double hi;
+    double lo;
+} DoubleDouble;
+
+/** Número complejo con partes double-double (ver Complex). */
+typedef struct
+{
+    DoubleDouble re;
+    DoubleDouble im;
+} DoubleDoubleComplex;
+
+/* Precisión relativa de un double-double, 2^-104. */
+#define DOUBLE_DOUBLE_EPSILON 4.93038065763132e-32
+
+static inline DoubleDouble makeDoubleDouble(double hi, double lo)
+{
+    DoubleDouble d;
+    d.hi = hi;
+    d.lo = lo;
+    return d;
+}
+
+static inline DoubleDouble ddFromDouble(double value)
+{
+    return makeDoubleDouble(value, 0.0);
+}
+
+/*
+ * s + e == a + b exactamente, para cualquier a y b. Si la suma se desborda, el
+ * error queda en cero para que el infinito no se vuelva NaN (como en double,
+ * una órbita que se va a infinito tiene que seguir comparando como grande).
+ */
+static inline DoubleDouble ddTwoSum(double a, double b)
+{
+    double s = a + b;
+    if (!isfinite(s))
+        return makeDoubleDouble(s, 0.0);
+    double v = s - a;
+    return makeDoubleDouble(s, (a - (s - v)) + (b - v));
+}
+
+/* Igual que ddTwoSum, pero sólo vale si |a| >= |b|. */
+static inline DoubleDouble ddQuickTwoSum(double a, double b)
+{
+    double s = a + b;
+    if (!isfinite(s))
+        return makeDoubleDouble(s, 0.0);
+    return makeDoubleDouble(s, b - (s - a));
+}
+
+/* p + e == a * b exactamente, partiendo cada factor en dos mitades de 26 bits. */
+static inline DoubleDouble ddTwoProd(double a, double b)
+{
+    double p = a * b;
+    if (!isfinite(p))
+        return makeDoubleDouble(p, 0.0);
+    double ta = 134217729.0 * a;
+    double ah = ta - (ta - a);
+    double al = a - ah;
+    double tb = 134217729.0 * b;
+    double bh = tb - (tb - b);
+    double bl = b - bh;
+    return makeDoubleDouble(p, ((ah * bh - p) + ah * bl + al * bh) + al * bl);
+}
+
+static inline DoubleDouble ddNegate(DoubleDouble a)
+{
+    return makeDoubleDouble(-a.hi, -a.lo);
+}
+
+static inline DoubleDouble ddAdd(DoubleDouble a, DoubleDouble b)
+{
+    DoubleDouble s = ddTwoSum(a.hi, b.hi);
+    DoubleDouble t = ddTwoSum(a.lo, b.lo);
+    s = ddQuickTwoSum(s.hi, s.lo + t.hi);
+    return ddQuickTwoSum(s.hi, s.lo + t.lo);
+}
+
+static inline DoubleDouble ddSub(DoubleDouble a, DoubleDouble b)
+{
+    return ddAdd(a, ddNegate(b));
+}
+
+static inline DoubleDouble ddMul(DoubleDouble a, DoubleDouble b)
+{
+    DoubleDouble p = ddTwoProd(a.hi, b.hi);
+    return ddQuickTwoSum(p.hi, p.lo + (a.hi * b.lo + a.lo * b.hi));
+}
+
+static inline DoubleDouble ddMulDouble(DoubleDouble a, double b)
+{
+    DoubleDouble p = ddTwoProd(a.hi, b);
+    return ddQuickTwoSum(p.hi, p.lo + a.lo * b);
+}
+
+/* Tres pasos de división larga: cada cociente parcial corrige el resto del anterior. */
+static inline DoubleDouble ddDiv(DoubleDouble a, DoubleDouble b)
+{
+    double q1 = a.hi / b.hi;
+    DoubleDouble r = ddSub(a, ddMulDouble(b, q1));
+    double q2 = r.hi / b.hi;
+    r = ddSub(r, ddMulDouble(b, q2));
+    double q3 = r.hi / b.hi;
+    return ddAdd(ddQuickTwoSum(q1, q2), ddFromDouble(q3));
+}
+
+/* Un paso de Newton sobre la raíz en double (Karp): sqrt(a) ~ a*x + (a - (a*x)^2) * x/2, x = 1/sqrt(a). */
+static inline DoubleDouble ddSqrt(DoubleDouble a)
+{
+    if (a.hi <= 0.0 || isinf(a.hi))
+        return ddFromDouble(a.hi == 0.0 ? 0.0 : sqrt(a.hi));
+    double x = 1.0 / sqrt(a.hi);
+    double ax = a.hi * x;
+    DoubleDouble error = ddSub(a, ddTwoProd(ax, ax));
+    return ddTwoSum(ax, error.hi * (x * 0.5));
+}
+
+/* -1, 0 o 1 (un NaN compara como igual, como los "<" y ">" de double dan falso). */
+static inline int ddCompare(DoubleDouble a, DoubleDouble b)
+{
+    if (a.hi < b.hi || (a.hi == b.hi && a.lo < b.lo))
+        return -1;
+    if (a.hi > b.hi || (a.hi == b.hi && a.lo > b.lo))
+        return 1;
+    return 0;
+}
+
+static inline DoubleDoubleComplex makeDoubleDoubleComplex(DoubleDouble re, DoubleDouble im)
+{
+    DoubleDoubleComplex c;
+    c.re = re;
+    c.im = im;
+    return c;
+}
+
+static inline DoubleDoubleComplex ddComplexFromComplex(Complex value)
+{
+    return makeDoubleDoubleComplex(ddFromDouble(value.re), ddFromDouble(value.im));
+}
+
+static inline DoubleDoubleComplex ddComplexAdd(DoubleDoubleComplex a, DoubleDoubleComplex b)
+{
+    return makeDoubleDoubleComplex(ddAdd(a.re, b.re), ddAdd(a.im, b.im));
+}
+
+static inline DoubleDoubleComplex ddComplexSub(DoubleDoubleComplex a, DoubleDoubleComplex b)
+{
+    return makeDoubleDoubleComplex(ddSub(a.re, b.re), ddSub(a.im, b.im));
+}
+
+static inline DoubleDoubleComplex ddComplexMul(DoubleDoubleComplex a, DoubleDoubleComplex b)
+{
+    return makeDoubleDoubleComplex(ddSub(ddMul(a.re, b.re), ddMul(a.im, b.im)),
+                                   ddAdd(ddMul(a.re, b.im), ddMul(a.im, b.re)));
+}
+
+static inline DoubleDouble ddComplexNorm(DoubleDoubleComplex a)
+{
+    return ddAdd(ddMul(a.re, a.re), ddMul(a.im, a.im));
+}
+
+static inline DoubleDoubleComplex ddComplexDiv(DoubleDoubleComplex a, DoubleDoubleComplex b)
+{
+    DoubleDouble den = ddComplexNorm(b);
+    if (den.hi == 0.0)
+        return makeDoubleDoubleComplex(ddFromDouble(0.0), ddFromDouble(0.0));
+    return makeDoubleDoubleComplex(ddDiv(ddAdd(ddMul(a.re, b.re), ddMul(a.im, b.im)), den),
+                                   ddDiv(ddSub(ddMul(a.im, b.re), ddMul(a.re, b.im)), den));
+}
+
+static inline DoubleDouble ddComplexAbs(DoubleDoubleComplex a)
+{
+    return ddSqrt(ddComplexNorm(a));
+}
+
+#endif
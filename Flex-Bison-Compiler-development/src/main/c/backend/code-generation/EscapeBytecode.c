@@ -0,0 +1,522 @@
+#include "EscapeBytecode.h"
+#include "EscapeExpression.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* Cantidad máxima de parámetros distintos referenciados por un escape. */
+#define ESCAPE_MAX_NAMES 64
+
+/* De qué depende el valor de un registro, de menor a mayor. */
+typedef enum
+{
+    ESCAPE_DEPENDS_ON_NOTHING,
+    ESCAPE_DEPENDS_ON_PIXEL,
+    ESCAPE_DEPENDS_ON_Z
+} EscapeDependency;
+
+/* Código en construcción. */
+typedef struct
+{
+    EscapeInstruction *buffer;
+    int length;
+    int capacity;
+} EscapeCodeBuffer;
+
+typedef struct
+{
+    EscapeProgram *program;
+    Escape *escape;
+    RenderContext *ctx;
+
+    /* Código del bloque que se está compilando, y el del bloque por píxel. */
+    EscapeCodeBuffer code;
+    EscapeCodeBuffer pixel;
+    int failed;
+
+    uint8_t dependencies[ESCAPE_MAX_REGISTERS];
+
+    int constants[ESCAPE_MAX_REGISTERS];
+    int constantCount;
+
+    char *names[ESCAPE_MAX_NAMES];
+    int nameRegisters[ESCAPE_MAX_NAMES];
+    int nameCount;
+} EscapeCompiler;
+
+/* Semántica de cada opcode; la comparten el intérprete y el plegado de constantes. */
+static inline Complex applyEscapeOpcode(uint8_t opcode, Complex a, Complex b)
+{
+    switch (opcode)
+    {
+    case ESCAPE_OP_ADD:
+        return complexAdd(a, b);
+    case ESCAPE_OP_SUB:
+        return complexSub(a, b);
+    case ESCAPE_OP_MUL:
+        return complexMul(a, b);
+    case ESCAPE_OP_DIV:
+        return complexDiv(a, b);
+    case ESCAPE_OP_ABS:
+        return makeComplex(complexAbs(a), 0.0);
+    case ESCAPE_OP_LT:
+        return makeComplex((a.re < b.re) ? 1.0 : 0.0, 0.0);
+    case ESCAPE_OP_GT:
+        return makeComplex((a.re > b.re) ? 1.0 : 0.0, 0.0);
+    case ESCAPE_OP_MAKE:
+        return makeComplex(a.re, b.re);
+    case ESCAPE_OP_SQUARE:
+        return complexMul(a, a);
+    case ESCAPE_OP_NORM_GT:
+        return makeComplex((complexNorm(a) > b.re) ? 1.0 : 0.0, 0.0);
+    case ESCAPE_OP_NORM_LT:
+        return makeComplex((complexNorm(a) < b.re) ? 1.0 : 0.0, 0.0);
+    default:
+        return makeComplex(0.0, 0.0);
+    }
+}
+
+static int newRegister(EscapeCompiler *compiler, Complex initialValue, EscapeDependency dependency)
+{
+    EscapeProgram *program = compiler->program;
+    if (program->registerCount >= ESCAPE_MAX_REGISTERS)
+    {
+        compiler->failed = 1;
+        return ESCAPE_REGISTER_Z;
+    }
+    program->initialRegisters[program->registerCount] = initialValue;
+    compiler->dependencies[program->registerCount] = (uint8_t)dependency;
+    return program->registerCount++;
+}
+
+/* Las constantes se deduplican para no desperdiciar registros. */
+static int constantRegister(EscapeCompiler *compiler, double re, double im)
+{
+    EscapeProgram *program = compiler->program;
+    for (int k = 0; k < compiler->constantCount; k++)
+    {
+        Complex c = program->initialRegisters[compiler->constants[k]];
+        if (memcmp(&c.re, &re, sizeof(double)) == 0 && memcmp(&c.im, &im, sizeof(double)) == 0)
+            return compiler->constants[k];
+    }
+    int reg = newRegister(compiler, makeComplex(re, im), ESCAPE_DEPENDS_ON_NOTHING);
+    if (!compiler->failed)
+        compiler->constants[compiler->constantCount++] = reg;
+    return reg;
+}
+
+/* Los parámetros de la regla son constantes durante todo el escape. */
+static int variableRegister(EscapeCompiler *compiler, Variable *variable)
+{
+    char *name = variable->name;
+    Escape *escape = compiler->escape;
+    if (escape->variable && strcmp(name, escape->variable->name) == 0)
+    {
+        return ESCAPE_REGISTER_Z;
+    }
+    for (int k = 0; k < compiler->nameCount; k++)
+    {
+        if (strcmp(compiler->names[k], name) == 0)
+            return compiler->nameRegisters[k];
+    }
+    if (compiler->nameCount >= ESCAPE_MAX_NAMES)
+    {
+        compiler->failed = 1;
+        return ESCAPE_REGISTER_Z;
+    }
+    int reg = newRegister(compiler, makeComplex(getVariableValue(compiler->ctx, variable), 0.0),
+                          ESCAPE_DEPENDS_ON_NOTHING);
+    compiler->names[compiler->nameCount] = name;
+    compiler->nameRegisters[compiler->nameCount] = reg;
+    compiler->nameCount++;
+    return reg;
+}
+
+static void append(EscapeCodeBuffer *code, EscapeInstruction instruction)
+{
+    if (code->length == code->capacity)
+    {
+        code->capacity = code->capacity ? 2 * code->capacity : 16;
+        code->buffer = realloc(code->buffer, code->capacity * sizeof(EscapeInstruction));
+    }
+    code->buffer[code->length++] = instruction;
+}
+
+/*
+ * Emite registers[dst] = registers[a] op registers[b]. Si los operandos no
+ * dependen de nada, la operación se pliega a una constante; si sólo dependen
+ * del píxel, va al bloque por píxel en lugar del bloque actual.
+ */
+static int emit(EscapeCompiler *compiler, EscapeOpcode opcode, int a, int b)
+{
+    EscapeDependency dependency = compiler->dependencies[a] > compiler->dependencies[b]
+                                      ? compiler->dependencies[a]
+                                      : compiler->dependencies[b];
+    if (dependency == ESCAPE_DEPENDS_ON_NOTHING)
+    {
+        Complex *registers = compiler->program->initialRegisters;
+        Complex value = applyEscapeOpcode((uint8_t)opcode, registers[a], registers[b]);
+        return constantRegister(compiler, value.re, value.im);
+    }
+
+    int dst = newRegister(compiler, makeComplex(0.0, 0.0), dependency);
+    EscapeInstruction instruction;
+    instruction.opcode = (uint8_t)opcode;
+    instruction.dst = (uint8_t)dst;
+    instruction.a = (uint8_t)a;
+    instruction.b = (uint8_t)b;
+    append(dependency == ESCAPE_DEPENDS_ON_PIXEL ? &compiler->pixel : &compiler->code, instruction);
+    return dst;
+}
+
+static int isAbsoluteValue(EscapeExpression *expr)
+{
+    expr = unwrapEscapeExpression(expr);
+    return expr && expr->type == ABSOLUTE_VALUE;
+}
+
+static int compileExpression(EscapeCompiler *compiler, EscapeExpression *expr);
+
+/*
+ * Comparación con un |a| de un lado. Si el otro lado k es constante, se
+ * compara la norma al cuadrado de a contra un umbral exacto, sin calcular la
+ * raíz en cada iteración. Si no, se compila como cualquier comparación.
+ */
+static int compileMagnitudeComparison(EscapeCompiler *compiler, EscapeExpression *expr, int magnitudeOnLeft)
+{
+    EscapeExpression *magnitude = unwrapEscapeExpression(magnitudeOnLeft ? expr->leftExpression : expr->rightExpression);
+    EscapeExpression *bound = magnitudeOnLeft ? expr->rightExpression : expr->leftExpression;
+    int a = compileExpression(compiler, magnitude->leftExpression);
+    int k = compileExpression(compiler, bound);
+
+    if (compiler->dependencies[k] == ESCAPE_DEPENDS_ON_NOTHING)
+    {
+        double value = compiler->program->initialRegisters[k].re;
+        /* |a| > k y k < |a| son la misma comparación. */
+        if ((expr->type == GREATER_THAN_OP) == magnitudeOnLeft)
+            return emit(compiler, ESCAPE_OP_NORM_GT, a, constantRegister(compiler, complexAbsAboveThreshold(value), 0.0));
+        return emit(compiler, ESCAPE_OP_NORM_LT, a, constantRegister(compiler, complexAbsBelowThreshold(value), 0.0));
+    }
+
+    int abs = emit(compiler, ESCAPE_OP_ABS, a, a);
+    EscapeOpcode opcode = expr->type == GREATER_THAN_OP ? ESCAPE_OP_GT : ESCAPE_OP_LT;
+    return magnitudeOnLeft ? emit(compiler, opcode, abs, k) : emit(compiler, opcode, k, abs);
+}
+
+static int compileFactor(EscapeCompiler *compiler, EscapeFactor *factor)
+{
+    if (!factor)
+        return constantRegister(compiler, 0.0, 0.0);
+
+    switch (factor->type)
+    {
+    case CONSTANT:
+        return constantRegister(compiler, (double)factor->constant->value, 0.0);
+
+    case DOUBLE_CONSTANT:
+        return constantRegister(compiler, factor->doubleConstant->value, 0.0);
+
+    case VARIABLE:
+        return variableRegister(compiler, factor->variable);
+
+    case EXPRESSION:
+        return compileExpression(compiler, factor->expression);
+
+    case X_COORD_FACTOR:
+        return ESCAPE_REGISTER_X;
+
+    case Y_COORD_FACTOR:
+        return ESCAPE_REGISTER_Y;
+
+    case RANGE:
+        /* [expr1, expr2] => expr1 + i*expr2 */
+        if (factor->range)
+        {
+            int a = compileExpression(compiler, factor->range->start);
+            int b = compileExpression(compiler, factor->range->end);
+            return emit(compiler, ESCAPE_OP_MAKE, a, b);
+        }
+        return constantRegister(compiler, 0.0, 0.0);
+
+    default:
+        return constantRegister(compiler, 0.0, 0.0);
+    }
+}
+
+static int compileExpression(EscapeCompiler *compiler, EscapeExpression *expr)
+{
+    if (!expr)
+        return constantRegister(compiler, 0.0, 0.0);
+
+    if (expr->type == FACTOR)
+        return compileFactor(compiler, expr->factor);
+
+    if (expr->type == ABSOLUTE_VALUE)
+    {
+        int a = compileExpression(compiler, expr->leftExpression);
+        return emit(compiler, ESCAPE_OP_ABS, a, a);
+    }
+
+    if (expr->type == LOWER_THAN_OP || expr->type == GREATER_THAN_OP)
+    {
+        if (isAbsoluteValue(expr->leftExpression))
+            return compileMagnitudeComparison(compiler, expr, 1);
+        if (isAbsoluteValue(expr->rightExpression))
+            return compileMagnitudeComparison(compiler, expr, 0);
+    }
+
+    int a = compileExpression(compiler, expr->leftExpression);
+    int b = compileExpression(compiler, expr->rightExpression);
+
+    switch (expr->type)
+    {
+    case ADDITION:
+        return emit(compiler, ESCAPE_OP_ADD, a, b);
+    case SUBTRACTION:
+        return emit(compiler, ESCAPE_OP_SUB, a, b);
+    case MULTIPLICATION:
+        /* El mismo registro en ambos lados (ej: z*z) es un cuadrado. */
+        if (a == b)
+            return emit(compiler, ESCAPE_OP_SQUARE, a, a);
+        return emit(compiler, ESCAPE_OP_MUL, a, b);
+    case DIVISION:
+        return emit(compiler, ESCAPE_OP_DIV, a, b);
+    case LOWER_THAN_OP:
+        return emit(compiler, ESCAPE_OP_LT, a, b);
+    case GREATER_THAN_OP:
+        return emit(compiler, ESCAPE_OP_GT, a, b);
+    default:
+        return constantRegister(compiler, 0.0, 0.0);
+    }
+}
+
+static EscapeCode finishCode(EscapeCodeBuffer *buffer, int result)
+{
+    EscapeCode code;
+    code.instructions = buffer->buffer;
+    code.length = buffer->length;
+    code.result = result;
+    memset(buffer, 0, sizeof(EscapeCodeBuffer));
+    return code;
+}
+
+static EscapeCode compileCode(EscapeCompiler *compiler, EscapeExpression *expr)
+{
+    int result = compileExpression(compiler, expr);
+    return finishCode(&compiler->code, result);
+}
+
+EscapeProgram *compileEscapeProgram(Escape *escape, RenderContext *ctx)
+{
+    if (!escape)
+        return NULL;
+
+    EscapeCompiler compiler;
+    memset(&compiler, 0, sizeof(compiler));
+    compiler.program = calloc(1, sizeof(EscapeProgram));
+    compiler.escape = escape;
+    compiler.ctx = ctx;
+    compiler.dependencies[ESCAPE_REGISTER_Z] = ESCAPE_DEPENDS_ON_Z;
+    compiler.dependencies[ESCAPE_REGISTER_X] = ESCAPE_DEPENDS_ON_PIXEL;
+    compiler.dependencies[ESCAPE_REGISTER_Y] = ESCAPE_DEPENDS_ON_PIXEL;
+
+    EscapeProgram *program = compiler.program;
+    program->registerCount = ESCAPE_REGISTER_Y + 1;
+    program->hasInitial = escape->initialValue != NULL;
+    program->hasStep = escape->recursiveAssigment != NULL;
+    program->hasUntil = escape->untilCondition != NULL;
+    program->initial = compileCode(&compiler, escape->initialValue);
+    program->step = compileCode(&compiler, escape->recursiveAssigment);
+    program->until = compileCode(&compiler, escape->untilCondition);
+    program->pixel = finishCode(&compiler.pixel, ESCAPE_REGISTER_Z);
+
+    if (compiler.failed)
+    {
+        destroyEscapeProgram(program);
+        return NULL;
+    }
+    return program;
+}
+
+void destroyEscapeProgram(EscapeProgram *program)
+{
+    if (program)
+    {
+        free(program->pixel.instructions);
+        free(program->initial.instructions);
+        free(program->step.instructions);
+        free(program->until.instructions);
+        free(program);
+    }
+}
+
+static inline void runEscapeCode(const EscapeCode *code, Complex *r)
+{
+    const EscapeInstruction *instruction = code->instructions;
+    const EscapeInstruction *end = instruction + code->length;
+    for (; instruction < end; instruction++)
+    {
+        r[instruction->dst] = applyEscapeOpcode(instruction->opcode, r[instruction->a], r[instruction->b]);
+    }
+}
+
+Complex escapeInitialValue(const EscapeProgram *program, Complex *registers, double x, double y)
+{
+    registers[ESCAPE_REGISTER_Z] = makeComplex(0.0, 0.0);
+    registers[ESCAPE_REGISTER_X] = makeComplex(x, 0.0);
+    registers[ESCAPE_REGISTER_Y] = makeComplex(y, 0.0);
+    runEscapeCode(&program->pixel, registers);
+
+    if (program->hasInitial)
+    {
+        runEscapeCode(&program->initial, registers);
+        return registers[program->initial.result];
+    }
+    return registers[ESCAPE_REGISTER_Z];
+}
+
+int iterateEscapeProgram(const EscapeProgram *program, Complex *registers, double x, double y, int maxIter)
+{
+    registers[ESCAPE_REGISTER_Z] = escapeInitialValue(program, registers, x, y);
+
+    /*
+     * Detección de ciclos de Brent: el paso sólo depende de z (el resto de los
+     * registros no cambia durante el píxel), así que si z se repite bit a bit
+     * la órbita es periódica y no va a escapar.
+     */
+    Complex check = registers[ESCAPE_REGISTER_Z];
+    int steps = 0;
+    int power = 1;
+
+    int iter = 0;
+    while (iter < maxIter)
+    {
+        if (program->hasUntil)
+        {
+            runEscapeCode(&program->until, registers);
+            if (registers[program->until.result].re != 0.0)
+                break;
+        }
+        if (!program->hasStep)
+            break;
+        runEscapeCode(&program->step, registers);
+        registers[ESCAPE_REGISTER_Z] = registers[program->step.result];
+        iter++;
+        if (program->periodicity)
+        {
+            if (complexSameBits(registers[ESCAPE_REGISTER_Z], check))
+                return maxIter;
+            if (++steps == power)
+            {
+                check = registers[ESCAPE_REGISTER_Z];
+                steps = 0;
+                power <<= 1;
+            }
+        }
+    }
+    return iter;
+}
+
+/* Igual que applyEscapeOpcode, con cada operación de Complex en double-double. */
+static inline DoubleDoubleComplex applyEscapeOpcodeDoubleDouble(uint8_t opcode, DoubleDoubleComplex a,
+                                                                DoubleDoubleComplex b)
+{
+    const DoubleDouble zero = ddFromDouble(0.0);
+    const DoubleDouble one = ddFromDouble(1.0);
+    switch (opcode)
+    {
+    case ESCAPE_OP_ADD:
+        return ddComplexAdd(a, b);
+    case ESCAPE_OP_SUB:
+        return ddComplexSub(a, b);
+    case ESCAPE_OP_MUL:
+        return ddComplexMul(a, b);
+    case ESCAPE_OP_DIV:
+        return ddComplexDiv(a, b);
+    case ESCAPE_OP_ABS:
+        return makeDoubleDoubleComplex(ddComplexAbs(a), zero);
+    case ESCAPE_OP_LT:
+        return makeDoubleDoubleComplex(ddCompare(a.re, b.re) < 0 ? one : zero, zero);
+    case ESCAPE_OP_GT:
+        return makeDoubleDoubleComplex(ddCompare(a.re, b.re) > 0 ? one : zero, zero);
+    case ESCAPE_OP_MAKE:
+        return makeDoubleDoubleComplex(a.re, b.re);
+    case ESCAPE_OP_SQUARE:
+        return ddComplexMul(a, a);
+    case ESCAPE_OP_NORM_GT:
+        return makeDoubleDoubleComplex(ddCompare(ddComplexNorm(a), b.re) > 0 ? one : zero, zero);
+    case ESCAPE_OP_NORM_LT:
+        return makeDoubleDoubleComplex(ddCompare(ddComplexNorm(a), b.re) < 0 ? one : zero, zero);
+    default:
+        return makeDoubleDoubleComplex(zero, zero);
+    }
+}
+
+static inline void runEscapeCodeDoubleDouble(const EscapeCode *code, DoubleDoubleComplex *r)
+{
+    const EscapeInstruction *instruction = code->instructions;
+    const EscapeInstruction *end = instruction + code->length;
+    for (; instruction < end; instruction++)
+    {
+        r[instruction->dst] = applyEscapeOpcodeDoubleDouble(instruction->opcode, r[instruction->a], r[instruction->b]);
+    }
+}
+
+static inline int ddComplexSameBits(DoubleDoubleComplex a, DoubleDoubleComplex b)
+{
+    return memcmp(&a, &b, sizeof(DoubleDoubleComplex)) == 0;
+}
+
+void loadEscapeRegistersDoubleDouble(const EscapeProgram *program, DoubleDoubleComplex *registers)
+{
+    for (int k = 0; k < program->registerCount; k++)
+    {
+        registers[k] = ddComplexFromComplex(program->initialRegisters[k]);
+    }
+}
+
+int iterateEscapeProgramDoubleDouble(const EscapeProgram *program, DoubleDoubleComplex *registers, DoubleDouble x,
+                                     DoubleDouble y, int maxIter)
+{
+    const DoubleDouble zero = ddFromDouble(0.0);
+    registers[ESCAPE_REGISTER_Z] = makeDoubleDoubleComplex(zero, zero);
+    registers[ESCAPE_REGISTER_X] = makeDoubleDoubleComplex(x, zero);
+    registers[ESCAPE_REGISTER_Y] = makeDoubleDoubleComplex(y, zero);
+    runEscapeCodeDoubleDouble(&program->pixel, registers);
+    if (program->hasInitial)
+    {
+        runEscapeCodeDoubleDouble(&program->initial, registers);
+        registers[ESCAPE_REGISTER_Z] = registers[program->initial.result];
+    }
+
+    DoubleDoubleComplex check = registers[ESCAPE_REGISTER_Z];
+    int steps = 0;
+    int power = 1;
+
+    int iter = 0;
+    while (iter < maxIter)
+    {
+        if (program->hasUntil)
+        {
+            runEscapeCodeDoubleDouble(&program->until, registers);
+            if (registers[program->until.result].re.hi != 0.0)
+                break;
+        }
+        if (!program->hasStep)
+            break;
+        runEscapeCodeDoubleDouble(&program->step, registers);
+        registers[ESCAPE_REGISTER_Z] = registers[program->step.result];
+        iter++;
+        if (program->periodicity)
+        {
+            if (ddComplexSameBits(registers[ESCAPE_REGISTER_Z], check))
+                return maxIter;
+            if (++steps == power)
+            {
+                check = registers[ESCAPE_REGISTER_Z];
+                steps = 0;
+                power <<= 1;
+            }
+        }
+    }
+    return iter;
+}
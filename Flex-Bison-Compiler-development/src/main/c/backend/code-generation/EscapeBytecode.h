@@ -0,0 +1,112 @@
+#ifndef ESCAPE_BYTECODE_HEADER
+#define ESCAPE_BYTECODE_HEADER
+
+#include "../../frontend/syntactic-analysis/AbstractSyntaxTree.h"
+#include "Complex.h"
+#include "DoubleDouble.h"
+#include "RenderContext.h"
+#include <stdint.h>
+
+/* Cantidad máxima de registros de un programa (los operandos son de 8 bits). */
+#define ESCAPE_MAX_REGISTERS 256
+
+/* Registros fijos: la variable del escape y las coordenadas del píxel. */
+#define ESCAPE_REGISTER_Z 0
+#define ESCAPE_REGISTER_X 1
+#define ESCAPE_REGISTER_Y 2
+
+typedef enum
+{
+    ESCAPE_OP_ADD,
+    ESCAPE_OP_SUB,
+    ESCAPE_OP_MUL,
+    ESCAPE_OP_DIV,
+    ESCAPE_OP_ABS,
+    ESCAPE_OP_LT,
+    ESCAPE_OP_GT,
+    ESCAPE_OP_MAKE,
+    /* a*a, sin leer dos veces el mismo registro. */
+    ESCAPE_OP_SQUARE,
+    /* |a| > k y |a| < k, comparando la norma al cuadrado de a con el umbral
+       exacto b (ver complexAbsAboveThreshold/complexAbsBelowThreshold). */
+    ESCAPE_OP_NORM_GT,
+    ESCAPE_OP_NORM_LT
+} EscapeOpcode;
+
+/** Instrucción de 3 direcciones: registers[dst] = registers[a] op registers[b]. */
+typedef struct
+{
+    uint8_t opcode;
+    uint8_t dst;
+    uint8_t a;
+    uint8_t b;
+} EscapeInstruction;
+
+/** Secuencia lineal de instrucciones cuyo valor queda en el registro result. */
+typedef struct
+{
+    EscapeInstruction *instructions;
+    int length;
+    int result;
+} EscapeCode;
+
+/**
+ * Un "escape:" compilado. Las constantes y los parámetros de la regla se
+ * resuelven a registros precargados (initialRegisters), y toda subexpresión
+ * que no depende de z se saca del loop: si tampoco depende del píxel se
+ * calcula al compilar, y si no, una vez por píxel en "pixel". Así, en el loop
+ * de iteración sólo se ejecuta lo que cambia con z.
+ */
+typedef struct
+{
+    EscapeCode pixel;
+    EscapeCode initial;
+    EscapeCode step;
+    EscapeCode until;
+    int hasInitial;
+    int hasStep;
+    int hasUntil;
+    /* Detección de ciclos exactos en la órbita (opcional, la activa el renderer). */
+    int periodicity;
+    int registerCount;
+    Complex initialRegisters[ESCAPE_MAX_REGISTERS];
+} EscapeProgram;
+
+/**
+ * Compila un escape a bytecode de registros. Los parámetros de la regla se
+ * leen una sola vez desde el contexto. Devuelve NULL si la fórmula no entra
+ * en el banco de registros (se debe usar el evaluador del árbol).
+ */
+EscapeProgram *compileEscapeProgram(Escape *escape, RenderContext *ctx);
+
+/** Libera un programa compilado. */
+void destroyEscapeProgram(EscapeProgram *program);
+
+/**
+ * Evalúa el valor inicial de la variable del escape para el píxel (x, y). Deja
+ * cargados en "registers" las coordenadas y los valores por píxel (los
+ * destinos de "pixel"), igual que iterateEscapeProgram.
+ */
+Complex escapeInitialValue(const EscapeProgram *program, Complex *registers, double x, double y);
+
+/**
+ * Itera el programa para un píxel con coordenadas (x, y) y devuelve la
+ * cantidad de iteraciones realizadas. Con periodicity, si z vuelve a tomar
+ * exactamente un valor anterior devuelve maxIter sin terminar de iterar. "registers" debe tener registerCount
+ * elementos inicializados con initialRegisters.
+ */
+int iterateEscapeProgram(const EscapeProgram *program, Complex *registers, double x, double y, int maxIter);
+
+/** Carga en "registers" los initialRegisters del programa, pasados a double-double. */
+void loadEscapeRegistersDoubleDouble(const EscapeProgram *program, DoubleDoubleComplex *registers);
+
+/**
+ * Igual que iterateEscapeProgram, pero con los registros y las coordenadas del
+ * píxel en double-double. Las constantes siguen siendo las del programa (los
+ * literales se leen como double); lo que gana precisión son las coordenadas y
+ * la órbita, que es lo que hace falta en un view angosto.
+ */
+int iterateEscapeProgramDoubleDouble(const EscapeProgram *program, DoubleDoubleComplex *registers, DoubleDouble x,
+                                     DoubleDouble y, int maxIter);
+
+#endif
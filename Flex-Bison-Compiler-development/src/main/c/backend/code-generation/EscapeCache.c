@@ -0,0 +1,229 @@
+#include "EscapeCache.h"
+#include "EscapeDeepZoom.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* Cambia si cambia el formato del archivo, lo que entra en la clave o cómo se calculan las cuentas. */
+static const char ESCAPE_CACHE_MAGIC[8] = {'T', 'L', 'A', 'I', 'T', 'E', 'R', '3'};
+
+/* El archivo trae las partes fraccionarias después de las cuentas. */
+#define ESCAPE_CACHE_FRACTIONS 1u
+
+/* 32 bytes: las cuentas que siguen quedan alineadas. */
+typedef struct
+{
+    char magic[8];
+    uint64_t key;
+    uint32_t width;
+    uint32_t height;
+    uint32_t maxIter;
+    uint32_t flags;
+} EscapeCacheHeader;
+
+/* FNV-1a de 64 bits. */
+static uint64_t hashBytes(uint64_t hash, const void *data, size_t length)
+{
+    const unsigned char *bytes = data;
+    for (size_t k = 0; k < length; k++)
+    {
+        hash ^= bytes[k];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+static uint64_t hashInt(uint64_t hash, int value)
+{
+    return hashBytes(hash, &value, sizeof(value));
+}
+
+static uint64_t hashDouble(uint64_t hash, double value)
+{
+    return hashBytes(hash, &value, sizeof(value));
+}
+
+static uint64_t hashEscapeExpression(uint64_t hash, EscapeExpression *expr, RenderContext *ctx, Escape *escape);
+
+static uint64_t hashEscapeFactor(uint64_t hash, EscapeFactor *factor, RenderContext *ctx, Escape *escape)
+{
+    if (!factor)
+        return hashInt(hash, -1);
+
+    hash = hashInt(hash, factor->type);
+    switch (factor->type)
+    {
+    case CONSTANT:
+        return hashInt(hash, factor->constant->value);
+
+    case DOUBLE_CONSTANT:
+        if (factor->doubleConstant->lexeme)
+            return hashBytes(hash, factor->doubleConstant->lexeme, strlen(factor->doubleConstant->lexeme));
+        return hashDouble(hash, factor->doubleConstant->value);
+
+    case VARIABLE:
+        /* La variable del escape es z; cualquier otra es un parámetro y cuenta su valor. */
+        if (escape && escape->variable && strcmp(factor->variable->name, escape->variable->name) == 0)
+            return hashInt(hash, -2);
+        return hashDouble(hash, getVariableValue(ctx, factor->variable));
+
+    case EXPRESSION:
+        return hashEscapeExpression(hash, factor->expression, ctx, escape);
+
+    case RANGE:
+        if (factor->range)
+        {
+            hash = hashEscapeExpression(hash, factor->range->start, ctx, escape);
+            return hashEscapeExpression(hash, factor->range->end, ctx, escape);
+        }
+        return hash;
+
+    default:
+        return hash;
+    }
+}
+
+static uint64_t hashEscapeExpression(uint64_t hash, EscapeExpression *expr, RenderContext *ctx, Escape *escape)
+{
+    if (!expr)
+        return hashInt(hash, -1);
+
+    hash = hashInt(hash, expr->type);
+    if (expr->type == FACTOR)
+        return hashEscapeFactor(hash, expr->factor, ctx, escape);
+    if (expr->type == ABSOLUTE_VALUE)
+        return hashEscapeExpression(hash, expr->leftExpression, ctx, escape);
+    hash = hashEscapeExpression(hash, expr->leftExpression, ctx, escape);
+    return hashEscapeExpression(hash, expr->rightExpression, ctx, escape);
+}
+
+uint64_t escapeCacheKey(Escape *escape, RenderContext *ctx, int maxIter)
+{
+    uint64_t hash = 14695981039346656037ull;
+    hash = hashBytes(hash, ESCAPE_CACHE_MAGIC, sizeof(ESCAPE_CACHE_MAGIC));
+    hash = hashEscapeExpression(hash, escape->initialValue, ctx, escape);
+    hash = hashEscapeExpression(hash, escape->recursiveAssigment, ctx, escape);
+    hash = hashEscapeExpression(hash, escape->untilCondition, ctx, escape);
+    hash = hashInt(hash, maxIter);
+    hash = hashInt(hash, ctx->width);
+    hash = hashInt(hash, ctx->height);
+    hash = hashDouble(hash, ctx->minX);
+    hash = hashDouble(hash, ctx->maxX);
+    hash = hashDouble(hash, ctx->minY);
+    hash = hashDouble(hash, ctx->maxY);
+    DeepZoomView view = loadDeepZoomView(ctx);
+    hash = hashBytes(hash, &view, sizeof(view));
+
+    /* Las opciones que cambian alguna cuenta (periodicity e interior dan las mismas). */
+    const RenderOptions *options = ctx->options;
+    if (options)
+    {
+        hash = hashInt(hash, options->simd);
+        hash = hashInt(hash, options->subdivision);
+        hash = hashInt(hash, options->deepZoom);
+        hash = hashInt(hash, options->precision);
+        hash = hashInt(hash, options->smooth);
+        hash = hashInt(hash, options->symmetry);
+    }
+    return hash;
+}
+
+char *escapeCachePath(const RenderContext *ctx, uint64_t key)
+{
+    const char *output = ctx->outputFilename ? ctx->outputFilename : "output.bmp";
+    size_t length = strlen(output) + 32;
+    char *path = malloc(length);
+    snprintf(path, length, "%s.%016llx.iter", output, (unsigned long long)key);
+    return path;
+}
+
+static size_t cacheSize(int width, int height, uint32_t flags)
+{
+    size_t pixels = (size_t)width * height;
+    size_t size = sizeof(EscapeCacheHeader) + pixels * sizeof(uint32_t);
+    if (flags & ESCAPE_CACHE_FRACTIONS)
+        size += pixels * sizeof(float);
+    return size;
+}
+
+int openEscapeCache(const char *path, uint64_t key, int width, int height, int maxIter, EscapeCache *cache)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return 0;
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(EscapeCacheHeader))
+    {
+        close(fd);
+        return 0;
+    }
+    void *mapping = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED)
+        return 0;
+
+    const EscapeCacheHeader *header = mapping;
+    if (memcmp(header->magic, ESCAPE_CACHE_MAGIC, sizeof(ESCAPE_CACHE_MAGIC)) != 0 || header->key != key ||
+        header->width != (uint32_t)width || header->height != (uint32_t)height ||
+        header->maxIter != (uint32_t)maxIter || (size_t)info.st_size != cacheSize(width, height, header->flags))
+    {
+        munmap(mapping, info.st_size);
+        return 0;
+    }
+
+    cache->mapping = mapping;
+    cache->size = info.st_size;
+    cache->counts = (const uint32_t *)(header + 1);
+    cache->fractions = NULL;
+    if (header->flags & ESCAPE_CACHE_FRACTIONS)
+        cache->fractions = (const float *)(cache->counts + (size_t)width * height);
+    return 1;
+}
+
+void closeEscapeCache(EscapeCache *cache)
+{
+    if (cache->mapping)
+        munmap(cache->mapping, cache->size);
+    cache->mapping = NULL;
+}
+
+int saveEscapeCache(const char *path, uint64_t key, int width, int height, int maxIter, const int *counts,
+                    const float *fractions)
+{
+    EscapeCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, ESCAPE_CACHE_MAGIC, sizeof(ESCAPE_CACHE_MAGIC));
+    header.key = key;
+    header.width = (uint32_t)width;
+    header.height = (uint32_t)height;
+    header.maxIter = (uint32_t)maxIter;
+    header.flags = fractions ? ESCAPE_CACHE_FRACTIONS : 0u;
+
+    /* Se escribe aparte y se renombra, para que otra corrida nunca mapee un archivo a medias. */
+    size_t length = strlen(path) + 5;
+    char *temporary = malloc(length);
+    snprintf(temporary, length, "%s.tmp", path);
+    FILE *file = fopen(temporary, "wb");
+    if (!file)
+    {
+        free(temporary);
+        return 0;
+    }
+
+    /* Las cuentas nunca son negativas: un int y un uint32_t tienen los mismos bytes. */
+    size_t pixels = (size_t)width * height;
+    int ok = fwrite(&header, sizeof(header), 1, file) == 1 && fwrite(counts, sizeof(uint32_t), pixels, file) == pixels;
+    if (ok && fractions)
+        ok = fwrite(fractions, sizeof(float), pixels, file) == pixels;
+    ok = fclose(file) == 0 && ok;
+    ok = ok && rename(temporary, path) == 0;
+    if (!ok)
+        remove(temporary);
+    free(temporary);
+    return ok;
+}
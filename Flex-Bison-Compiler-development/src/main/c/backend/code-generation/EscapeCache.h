@@ -0,0 +1,48 @@
+#ifndef ESCAPE_CACHE_HEADER
+#define ESCAPE_CACHE_HEADER
+
+#include "../../frontend/syntactic-analysis/AbstractSyntaxTree.h"
+#include "RenderContext.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Iteraciones de todos los píxeles de un escape, guardadas junto a la imagen
+ * ("salida.bmp.<clave>.iter") para volver a colorearlas sin iterar. El
+ * archivo es un encabezado seguido de las cuentas (uint32, fila por fila) y,
+ * con coloreo suave, de la parte fraccionaria de cada una (float), así que se
+ * lee mapeándolo en memoria.
+ */
+typedef struct
+{
+    void *mapping;
+    size_t size;
+    const uint32_t *counts;
+    /* NULL si el archivo no tiene las partes fraccionarias. */
+    const float *fractions;
+} EscapeCache;
+
+/**
+ * Clave del archivo: hash de todo lo que decide las iteraciones y no el
+ * color. Incluye la fórmula (con los parámetros de la regla ya resueltos), el
+ * view (también en punto fijo, para los zooms profundos), el tamaño, "max:" y
+ * las opciones que cambian las cuentas.
+ */
+uint64_t escapeCacheKey(Escape *escape, RenderContext *ctx, int maxIter);
+
+/** Ruta del archivo de la clave, al lado de la imagen de salida. Se libera con free. */
+char *escapeCachePath(const RenderContext *ctx, uint64_t key);
+
+/**
+ * Mapea el archivo si existe y su encabezado coincide con la clave y las
+ * dimensiones. Devuelve 0 (sin tocar cache) si no se puede usar.
+ */
+int openEscapeCache(const char *path, uint64_t key, int width, int height, int maxIter, EscapeCache *cache);
+
+void closeEscapeCache(EscapeCache *cache);
+
+/** Escribe el archivo; fractions puede ser NULL. Devuelve 0 si falla. */
+int saveEscapeCache(const char *path, uint64_t key, int width, int height, int maxIter, const int *counts,
+                    const float *fractions);
+
+#endif
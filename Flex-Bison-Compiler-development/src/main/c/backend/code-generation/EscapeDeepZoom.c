@@ -0,0 +1,428 @@
+#include "EscapeDeepZoom.h"
+#include <stdlib.h>
+
+/* Con bailout <= 1024, z*z + c nunca pasa de 2^21 y entra en la parte entera del punto fijo. */
+#define DEEP_ZOOM_MAX_BAILOUT 1024.0
+
+/* Criterio de Pauldelbrot: |z|^2 < 1e-6 |Z|^2 indica que la diferencia perdió los bits útiles. */
+#define DEEP_ZOOM_GLITCH_TOLERANCE 1e-6
+
+/* La serie vale mientras el término cúbico sea despreciable frente al lineal. */
+#define DEEP_ZOOM_SERIES_TOLERANCE 1e-12
+
+/* Órbitas de referencia por imagen, contando la primera. */
+#define DEEP_ZOOM_MAX_REFERENCES 32
+
+/* Píxeles que toma un worker por vez. */
+#define DEEP_ZOOM_CHUNK 64
+
+/* Marca de los píxeles que hay que volver a iterar con otra referencia. */
+#define DEEP_ZOOM_GLITCH (-1)
+
+/** Órbita de referencia, calculada en punto fijo y guardada en double. */
+typedef struct
+{
+    int px;
+    int py;
+    /* Z_0 .. Z_length. */
+    Complex *orbit;
+    /* Iteración en la que escapó la referencia, o maxIter si no escapó. */
+    int length;
+    /* El c de la referencia, para seguir un píxel cuando la referencia escapa antes. */
+    Complex c;
+    /* Serie: la diferencia en la iteración skip es a*d + b*d^2 + cubic*d^3. */
+    int skip;
+    Complex a;
+    Complex b;
+    Complex cubic;
+} DeepZoomReference;
+
+/** Una pasada sobre una lista de píxeles, repartida entre los workers. */
+typedef struct
+{
+    const EscapeKernel *kernel;
+    const DeepZoomReference *reference;
+    double stepX;
+    double stepY;
+    int width;
+    int maxIter;
+    int detectGlitches;
+    /* NULL para iterar todos los píxeles en orden. */
+    const int *pixels;
+    int count;
+    int next;
+    int *iterations;
+} DeepZoomPass;
+
+static FixedPoint evaluateFixedExpression(Expression *expr, RenderContext *ctx);
+
+static FixedPoint evaluateFixedFactor(Factor *factor, RenderContext *ctx)
+{
+    if (!factor)
+        return fixedFromInt(0);
+    switch (factor->type)
+    {
+    case CONSTANT:
+        return fixedFromInt(factor->constant->value);
+    case DOUBLE_CONSTANT:
+        if (factor->doubleConstant->lexeme)
+            return fixedFromDecimal(factor->doubleConstant->lexeme);
+        return fixedFromDouble(factor->doubleConstant->value);
+    case VARIABLE:
+        return fixedFromDouble(getVariableValue(ctx, factor->variable));
+    case EXPRESSION:
+        return evaluateFixedExpression(factor->expression, ctx);
+    case X_COORD_FACTOR:
+        return fixedFromDouble(ctx->currentPixelX);
+    case Y_COORD_FACTOR:
+        return fixedFromDouble(ctx->currentPixelY);
+    default:
+        return fixedFromInt(0);
+    }
+}
+
+/* Igual que evaluateExpression (Interpreter.c), en punto fijo. */
+static FixedPoint evaluateFixedExpression(Expression *expr, RenderContext *ctx)
+{
+    if (!expr)
+        return fixedFromInt(0);
+    if (expr->type == FACTOR)
+        return evaluateFixedFactor(expr->factor, ctx);
+    if (expr->type == ABSOLUTE_VALUE)
+        return fixedAbs(evaluateFixedExpression(expr->leftExpression, ctx));
+
+    FixedPoint left = evaluateFixedExpression(expr->leftExpression, ctx);
+    FixedPoint right = evaluateFixedExpression(expr->rightExpression, ctx);
+    switch (expr->type)
+    {
+    case ADDITION:
+        return fixedAdd(left, right);
+    case SUBTRACTION:
+        return fixedSub(left, right);
+    case MULTIPLICATION:
+        return fixedMul(left, right);
+    case DIVISION:
+        return fixedDiv(left, right);
+    case LOWER_THAN_OP:
+        return fixedFromInt(fixedCompare(left, right) < 0);
+    case GREATER_THAN_OP:
+        return fixedFromInt(fixedCompare(left, right) > 0);
+    default:
+        return fixedFromInt(0);
+    }
+}
+
+DeepZoomView loadDeepZoomView(RenderContext *ctx)
+{
+    DeepZoomView view;
+    if (ctx->view && ctx->view->x && ctx->view->y)
+    {
+        view.minX = evaluateFixedExpression(ctx->view->x->start, ctx);
+        view.maxX = evaluateFixedExpression(ctx->view->x->end, ctx);
+        view.minY = evaluateFixedExpression(ctx->view->y->start, ctx);
+        view.maxY = evaluateFixedExpression(ctx->view->y->end, ctx);
+    }
+    else
+    {
+        view.minX = fixedFromDouble(ctx->minX);
+        view.maxX = fixedFromDouble(ctx->maxX);
+        view.minY = fixedFromDouble(ctx->minY);
+        view.maxY = fixedFromDouble(ctx->maxY);
+    }
+    return view;
+}
+
+int supportsDeepZoom(const EscapeKernel *kernel)
+{
+    return kernel->type != ESCAPE_KERNEL_NONE && kernel->bailout <= DEEP_ZOOM_MAX_BAILOUT;
+}
+
+static int isPixelOperand(const EscapeOperand *operand)
+{
+    return operand->reSource != ESCAPE_SOURCE_CONSTANT || operand->imSource != ESCAPE_SOURCE_CONSTANT;
+}
+
+static inline double sourceDelta(EscapeSource source, double dx, double dy)
+{
+    if (source == ESCAPE_SOURCE_X)
+        return dx;
+    if (source == ESCAPE_SOURCE_Y)
+        return dy;
+    return 0.0;
+}
+
+/* Diferencia entre el operando en el píxel y en la referencia. */
+static inline Complex operandDelta(const EscapeOperand *operand, double dx, double dy)
+{
+    return makeComplex(sourceDelta(operand->reSource, dx, dy), sourceDelta(operand->imSource, dx, dy));
+}
+
+static FixedPoint sourceValue(EscapeSource source, double constant, FixedPoint x, FixedPoint y)
+{
+    if (source == ESCAPE_SOURCE_X)
+        return x;
+    if (source == ESCAPE_SOURCE_Y)
+        return y;
+    return fixedFromDouble(constant);
+}
+
+/*
+ * La serie se arma sobre la diferencia d del operando que depende del píxel.
+ * Si dependen los dos (z0 = c), sólo vale cuando su diferencia es la misma.
+ */
+static int supportsSeries(const EscapeKernel *kernel)
+{
+    if (isPixelOperand(&kernel->initial) && isPixelOperand(&kernel->c))
+        return kernel->initial.reSource == kernel->c.reSource && kernel->initial.imSource == kernel->c.imSource;
+    return 1;
+}
+
+static const EscapeOperand *seriesOperand(const EscapeKernel *kernel)
+{
+    return isPixelOperand(&kernel->c) ? &kernel->c : &kernel->initial;
+}
+
+static double complexMagnitude(Complex value)
+{
+    return sqrt(value.re * value.re + value.im * value.im);
+}
+
+/*
+ * Coeficientes de delta_n = A d + B d^2 + C d^3. Con delta_{n+1} =
+ * 2 Z_n delta_n + delta_n^2 + delta_c, cada término sale de agrupar potencias de d.
+ * Se avanza mientras el término cúbico sea despreciable para el d más grande y
+ * ningún píxel pueda haber escapado en la iteración que se saltea.
+ */
+static void computeSeries(DeepZoomReference *reference, const EscapeKernel *kernel, double maxDelta)
+{
+    reference->skip = 0;
+    reference->a = makeComplex(isPixelOperand(&kernel->initial) ? 1.0 : 0.0, 0.0);
+    reference->b = makeComplex(0.0, 0.0);
+    reference->cubic = makeComplex(0.0, 0.0);
+    if (!supportsSeries(kernel) || maxDelta <= 0.0)
+        return;
+
+    Complex one = makeComplex(isPixelOperand(&kernel->c) ? 1.0 : 0.0, 0.0);
+    Complex two = makeComplex(2.0, 0.0);
+    for (int n = 0; n < reference->length; n++)
+    {
+        double bound = complexMagnitude(reference->orbit[n]) + complexMagnitude(reference->a) * maxDelta +
+                       complexMagnitude(reference->b) * maxDelta * maxDelta +
+                       complexMagnitude(reference->cubic) * maxDelta * maxDelta * maxDelta;
+        if (bound * bound > kernel->threshold)
+            break;
+        Complex twoZ = complexMul(two, reference->orbit[n]);
+        Complex a = complexAdd(complexMul(twoZ, reference->a), one);
+        Complex b = complexAdd(complexMul(twoZ, reference->b), complexMul(reference->a, reference->a));
+        Complex cubic = complexAdd(complexMul(twoZ, reference->cubic),
+                                   complexMul(two, complexMul(reference->a, reference->b)));
+        double linear = complexMagnitude(a) * maxDelta;
+        double cubed = complexMagnitude(cubic) * maxDelta * maxDelta * maxDelta;
+        if (!isfinite(linear) || !isfinite(cubed) || cubed > DEEP_ZOOM_SERIES_TOLERANCE * linear)
+            break;
+        reference->a = a;
+        reference->b = b;
+        reference->cubic = cubic;
+        reference->skip = n + 1;
+    }
+}
+
+/* Itera la referencia en el píxel (px, py) con la precisión completa del punto fijo. */
+static void computeReference(DeepZoomReference *reference, const EscapeKernel *kernel, const DeepZoomView *view,
+                             int width, int height, int maxIter)
+{
+    FixedPoint x = fixedAdd(view->minX, fixedDiv(fixedMul(fixedSub(view->maxX, view->minX), fixedFromInt(reference->px)),
+                                                 fixedFromInt(width)));
+    FixedPoint y = fixedAdd(view->minY, fixedDiv(fixedMul(fixedSub(view->maxY, view->minY), fixedFromInt(reference->py)),
+                                                 fixedFromInt(height)));
+    FixedPoint zr = sourceValue(kernel->initial.reSource, kernel->initial.re, x, y);
+    FixedPoint zi = sourceValue(kernel->initial.imSource, kernel->initial.im, x, y);
+    FixedPoint cr = sourceValue(kernel->c.reSource, kernel->c.re, x, y);
+    FixedPoint ci = sourceValue(kernel->c.imSource, kernel->c.im, x, y);
+    reference->c = makeComplex(fixedToDouble(cr), fixedToDouble(ci));
+
+    reference->orbit[0] = makeComplex(fixedToDouble(zr), fixedToDouble(zi));
+    reference->length = maxIter;
+    for (int n = 0; n < maxIter; n++)
+    {
+        if (complexNorm(reference->orbit[n]) > kernel->threshold)
+        {
+            reference->length = n;
+            break;
+        }
+        FixedPoint product = fixedMul(zr, zi);
+        FixedPoint re = fixedAdd(fixedSub(fixedMul(zr, zr), fixedMul(zi, zi)), cr);
+        zi = fixedAdd(fixedAdd(product, product), ci);
+        zr = re;
+        reference->orbit[n + 1] = makeComplex(fixedToDouble(zr), fixedToDouble(zi));
+    }
+    reference->skip = 0;
+}
+
+/* Sigue en double a un píxel que sobrevivió a su referencia. */
+static int continueWithoutReference(double zr, double zi, Complex c, double threshold, int iter, int maxIter)
+{
+    while (iter < maxIter)
+    {
+        double rr = zr * zr;
+        double ii = zi * zi;
+        if (rr + ii > threshold)
+            break;
+        double re = (rr - ii) + c.re;
+        zi = (zr * zi + zi * zr) + c.im;
+        zr = re;
+        iter++;
+    }
+    return iter;
+}
+
+/* |d| del píxel respecto de la referencia de la pasada, la variable de la serie. */
+static double pixelDelta(const DeepZoomPass *pass, int pixel)
+{
+    double dx = (pixel % pass->width - pass->reference->px) * pass->stepX;
+    double dy = (pixel / pass->width - pass->reference->py) * pass->stepY;
+    return complexMagnitude(operandDelta(seriesOperand(pass->kernel), dx, dy));
+}
+
+static int iteratePixel(const DeepZoomPass *pass, int pixel)
+{
+    const DeepZoomReference *reference = pass->reference;
+    const EscapeKernel *kernel = pass->kernel;
+    double dx = (pixel % pass->width - reference->px) * pass->stepX;
+    double dy = (pixel / pass->width - reference->py) * pass->stepY;
+    Complex dz = operandDelta(&kernel->initial, dx, dy);
+    Complex dc = operandDelta(&kernel->c, dx, dy);
+
+    int iter = 0;
+    if (reference->skip > 0)
+    {
+        Complex d = operandDelta(seriesOperand(kernel), dx, dy);
+        dz = complexMul(d, complexAdd(reference->a, complexMul(d, complexAdd(reference->b, complexMul(d, reference->cubic)))));
+        iter = reference->skip;
+    }
+
+    while (iter < pass->maxIter)
+    {
+        Complex z = reference->orbit[iter];
+        double zr = z.re + dz.re;
+        double zi = z.im + dz.im;
+        double norm = zr * zr + zi * zi;
+        if (norm > kernel->threshold)
+            break;
+        if (iter == reference->length)
+        {
+            if (pass->detectGlitches)
+                return DEEP_ZOOM_GLITCH;
+            return continueWithoutReference(zr, zi, complexAdd(reference->c, dc), kernel->threshold, iter,
+                                            pass->maxIter);
+        }
+        if (pass->detectGlitches && norm < DEEP_ZOOM_GLITCH_TOLERANCE * complexNorm(z))
+            return DEEP_ZOOM_GLITCH;
+        /* delta' = (2Z + delta) delta + delta_c */
+        double tr = 2.0 * z.re + dz.re;
+        double ti = 2.0 * z.im + dz.im;
+        double re = tr * dz.re - ti * dz.im + dc.re;
+        double im = tr * dz.im + ti * dz.re + dc.im;
+        dz = makeComplex(re, im);
+        iter++;
+    }
+    return iter;
+}
+
+static void *deepZoomWorkerMain(void *argument)
+{
+    DeepZoomPass *pass = argument;
+    int first;
+    while ((first = __atomic_fetch_add(&pass->next, DEEP_ZOOM_CHUNK, __ATOMIC_RELAXED)) < pass->count)
+    {
+        int last = first + DEEP_ZOOM_CHUNK < pass->count ? first + DEEP_ZOOM_CHUNK : pass->count;
+        for (int k = first; k < last; k++)
+        {
+            int pixel = pass->pixels ? pass->pixels[k] : k;
+            pass->iterations[pixel] = iteratePixel(pass, pixel);
+        }
+    }
+    return NULL;
+}
+
+static void runPass(DeepZoomPass *pass, int threads)
+{
+    pass->next = 0;
+    runRenderThreads(deepZoomWorkerMain, pass, 0, threads);
+}
+
+DeepZoomStats iterateDeepZoom(const EscapeKernel *kernel, const DeepZoomView *view, int width, int height,
+                              int maxIter, int threads, int *iterations)
+{
+    DeepZoomStats stats = {0, 0, 0, 0};
+    DeepZoomReference reference;
+    reference.orbit = malloc((maxIter + 1) * sizeof(Complex));
+    reference.px = width / 2;
+    reference.py = height / 2;
+
+    DeepZoomPass pass;
+    pass.kernel = kernel;
+    pass.reference = &reference;
+    pass.stepX = fixedToDouble(fixedSub(view->maxX, view->minX)) / width;
+    pass.stepY = fixedToDouble(fixedSub(view->maxY, view->minY)) / height;
+    pass.width = width;
+    pass.maxIter = maxIter;
+    pass.detectGlitches = 1;
+    pass.pixels = NULL;
+    pass.count = width * height;
+    pass.iterations = iterations;
+
+    /* La d más grande es la de alguna esquina. */
+    double maxDelta = 0.0;
+    for (int corner = 0; corner < 4; corner++)
+    {
+        int pixel = ((corner & 2) ? height - 1 : 0) * width + ((corner & 1) ? width - 1 : 0);
+        maxDelta = fmax(maxDelta, pixelDelta(&pass, pixel));
+    }
+
+    computeReference(&reference, kernel, view, width, height, maxIter);
+    computeSeries(&reference, kernel, maxDelta);
+    stats.references = 1;
+    stats.skipped = reference.skip;
+    runPass(&pass, threads);
+
+    int *glitched = malloc((size_t)width * height * sizeof(int));
+    for (;;)
+    {
+        int count = 0;
+        for (int k = 0; k < width * height; k++)
+        {
+            if (iterations[k] == DEEP_ZOOM_GLITCH)
+                glitched[count++] = k;
+        }
+        if (count == 0)
+            break;
+
+        pass.pixels = glitched;
+        pass.count = count;
+        if (stats.references == DEEP_ZOOM_MAX_REFERENCES)
+        {
+            /* Sin más referencias, los que quedan se iteran igual con la última. */
+            stats.unresolved = count;
+            pass.detectGlitches = 0;
+            runPass(&pass, threads);
+            break;
+        }
+
+        /* La nueva referencia es uno de los píxeles con glitch, que la comparten. */
+        stats.glitches += count;
+        reference.px = glitched[count / 2] % width;
+        reference.py = glitched[count / 2] / width;
+        computeReference(&reference, kernel, view, width, height, maxIter);
+        maxDelta = 0.0;
+        for (int k = 0; k < count; k++)
+            maxDelta = fmax(maxDelta, pixelDelta(&pass, glitched[k]));
+        computeSeries(&reference, kernel, maxDelta);
+        stats.references++;
+        runPass(&pass, threads);
+    }
+
+    free(glitched);
+    free(reference.orbit);
+    return stats;
+}
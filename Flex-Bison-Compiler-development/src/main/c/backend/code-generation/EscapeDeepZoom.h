@@ -0,0 +1,53 @@
+#ifndef ESCAPE_DEEP_ZOOM_HEADER
+#define ESCAPE_DEEP_ZOOM_HEADER
+
+#include "EscapeKernels.h"
+#include "FixedPoint.h"
+#include "RenderContext.h"
+
+/** Límites del view en punto fijo, leídos de los literales del programa. */
+typedef struct
+{
+    FixedPoint minX;
+    FixedPoint maxX;
+    FixedPoint minY;
+    FixedPoint maxY;
+} DeepZoomView;
+
+/** Resultado de un render por perturbación (para el log). */
+typedef struct
+{
+    /* Órbitas de referencia calculadas, contando la primera. */
+    int references;
+    /* Iteraciones salteadas con la aproximación por series. */
+    int skipped;
+    /* Píxeles que hubo que volver a iterar con otra referencia. */
+    long glitches;
+    /* Píxeles que seguían con glitch al agotar las referencias. */
+    long unresolved;
+} DeepZoomStats;
+
+/**
+ * Evalúa las expresiones del view (ctx->view) en punto fijo, partiendo del
+ * texto de los literales. Sin view, usa los límites en double del contexto.
+ */
+DeepZoomView loadDeepZoomView(RenderContext *ctx);
+
+/**
+ * Si el kernel se puede iterar por perturbación: cualquier z = z*z + c cuyo
+ * bailout mantenga la órbita de referencia dentro del rango del punto fijo.
+ */
+int supportsDeepZoom(const EscapeKernel *kernel);
+
+/**
+ * Itera todos los píxeles por perturbación y deja en iterations[py * width + px]
+ * la cantidad de iteraciones de cada uno. Se calcula una órbita de referencia
+ * en punto fijo y cada píxel se itera en double como una diferencia con ella,
+ * salteando las primeras iteraciones con una serie de grado 3. Los píxeles con
+ * glitch (su órbita se acerca demasiado a cero respecto de la referencia) se
+ * vuelven a iterar con una referencia nueva elegida entre ellos.
+ */
+DeepZoomStats iterateDeepZoom(const EscapeKernel *kernel, const DeepZoomView *view, int width, int height,
+                              int maxIter, int threads, int *iterations);
+
+#endif
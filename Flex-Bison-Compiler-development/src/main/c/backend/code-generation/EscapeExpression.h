@@ -0,0 +1,16 @@
+#ifndef ESCAPE_EXPRESSION_HEADER
+#define ESCAPE_EXPRESSION_HEADER
+
+#include "../../frontend/syntactic-analysis/AbstractSyntaxTree.h"
+
+/* Quita los paréntesis redundantes: ((e)) => e. */
+static inline EscapeExpression *unwrapEscapeExpression(EscapeExpression *expr)
+{
+    while (expr && expr->type == FACTOR && expr->factor && expr->factor->type == EXPRESSION)
+    {
+        expr = expr->factor->expression;
+    }
+    return expr;
+}
+
+#endif
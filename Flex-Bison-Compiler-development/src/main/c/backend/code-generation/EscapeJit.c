@@ -0,0 +1,676 @@
+#include "EscapeJit.h"
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * xmm0 a xmm7 son temporales de cada operación; xmm8 a xmm15 guardan hasta
+ * cuatro registros complejos del programa (parte real e imaginaria) durante
+ * todo el loop. Todos son volátiles en el ABI de System V, igual que los
+ * registros enteros que se usan: no hace falta guardar nada.
+ */
+#define ESCAPE_JIT_PINNED 4
+#define ESCAPE_JIT_FIRST_PINNED 8
+
+/* Registros enteros: el banco de registros, maxIter, el contador y el estado de Brent. */
+#define REGISTERS JIT_RDI
+#define MAX_ITER JIT_RSI
+#define ITER JIT_RDX
+#define STEPS JIT_R8
+#define POWER JIT_R9
+#define CHECK_RE JIT_R10
+#define CHECK_IM JIT_R11
+
+typedef struct
+{
+    JitBuffer buffer;
+    /* xmm de la parte real de cada registro del programa, o -1 si vive en memoria. */
+    int pinned[ESCAPE_MAX_REGISTERS];
+} EscapeJitCompiler;
+
+static int32_t registerOffset(int reg, int imaginary)
+{
+    return (int32_t)(reg * sizeof(Complex) + (imaginary ? offsetof(Complex, im) : offsetof(Complex, re)));
+}
+
+/* Carga la parte real o imaginaria de un registro del programa en un xmm temporal. */
+static void loadPart(EscapeJitCompiler *compiler, int xmm, int reg, int imaginary)
+{
+    if (compiler->pinned[reg] >= 0)
+        jitSse(&compiler->buffer, JIT_PD, JIT_MOVAPD, xmm, compiler->pinned[reg] + imaginary);
+    else
+        jitSseMemory(&compiler->buffer, JIT_SD, JIT_MOVSD_LOAD, xmm, REGISTERS, registerOffset(reg, imaginary));
+}
+
+static void storePart(EscapeJitCompiler *compiler, int reg, int imaginary, int xmm)
+{
+    if (compiler->pinned[reg] >= 0)
+        jitSse(&compiler->buffer, JIT_PD, JIT_MOVAPD, compiler->pinned[reg] + imaginary, xmm);
+    else
+        jitSseMemory(&compiler->buffer, JIT_SD, JIT_MOVSD_STORE, xmm, REGISTERS, registerOffset(reg, imaginary));
+}
+
+static void store(EscapeJitCompiler *compiler, int reg, int re, int im)
+{
+    storePart(compiler, reg, 0, re);
+    storePart(compiler, reg, 1, im);
+}
+
+/* xmm = xmm op other, con el prefijo de double escalar. */
+static void sse(EscapeJitCompiler *compiler, uint8_t opcode, int xmm, int other)
+{
+    jitSse(&compiler->buffer, JIT_SD, opcode, xmm, other);
+}
+
+static void copy(EscapeJitCompiler *compiler, int xmm, int other)
+{
+    jitSse(&compiler->buffer, JIT_PD, JIT_MOVAPD, xmm, other);
+}
+
+static void zero(EscapeJitCompiler *compiler, int xmm)
+{
+    jitSse(&compiler->buffer, JIT_PD, JIT_XOR, xmm, xmm);
+}
+
+/* xmm4 = 1.0 si la comparación ya hecha con ucomisd dio "above", 0.0 si no (NaN incluido). */
+static void emitAboveFlag(EscapeJitCompiler *compiler)
+{
+    zero(compiler, 4);
+    size_t skip = jitJumpIf(&compiler->buffer, JIT_JBE);
+    jitLoadDouble(&compiler->buffer, 4, 1.0);
+    jitPatch(&compiler->buffer, skip);
+    zero(compiler, 5);
+}
+
+/* xmm0 = a.re * a.re + a.im * a.im, como complexNorm. */
+static void emitNorm(EscapeJitCompiler *compiler, int a)
+{
+    loadPart(compiler, 0, a, 0);
+    loadPart(compiler, 1, a, 1);
+    sse(compiler, JIT_MUL, 0, 0);
+    sse(compiler, JIT_MUL, 1, 1);
+    sse(compiler, JIT_ADD, 0, 1);
+}
+
+/* Cada caso repite, operación por operación, el de applyEscapeOpcode. */
+static void emitInstruction(EscapeJitCompiler *compiler, const EscapeInstruction *instruction)
+{
+    int a = instruction->a;
+    int b = instruction->b;
+    int dst = instruction->dst;
+    switch (instruction->opcode)
+    {
+    case ESCAPE_OP_ADD:
+    case ESCAPE_OP_SUB:
+    {
+        uint8_t opcode = instruction->opcode == ESCAPE_OP_ADD ? JIT_ADD : JIT_SUB;
+        loadPart(compiler, 0, a, 0);
+        loadPart(compiler, 1, a, 1);
+        loadPart(compiler, 2, b, 0);
+        loadPart(compiler, 3, b, 1);
+        sse(compiler, opcode, 0, 2);
+        sse(compiler, opcode, 1, 3);
+        store(compiler, dst, 0, 1);
+        break;
+    }
+
+    case ESCAPE_OP_MUL:
+    case ESCAPE_OP_SQUARE:
+        if (instruction->opcode == ESCAPE_OP_SQUARE)
+            b = a;
+        loadPart(compiler, 0, a, 0);
+        loadPart(compiler, 1, a, 1);
+        loadPart(compiler, 2, b, 0);
+        loadPart(compiler, 3, b, 1);
+        /* re = a.re * b.re - a.im * b.im */
+        copy(compiler, 4, 0);
+        sse(compiler, JIT_MUL, 4, 2);
+        copy(compiler, 5, 1);
+        sse(compiler, JIT_MUL, 5, 3);
+        sse(compiler, JIT_SUB, 4, 5);
+        /* im = a.re * b.im + a.im * b.re */
+        sse(compiler, JIT_MUL, 0, 3);
+        sse(compiler, JIT_MUL, 1, 2);
+        sse(compiler, JIT_ADD, 0, 1);
+        store(compiler, dst, 4, 0);
+        break;
+
+    case ESCAPE_OP_DIV:
+    {
+        loadPart(compiler, 0, a, 0);
+        loadPart(compiler, 1, a, 1);
+        loadPart(compiler, 2, b, 0);
+        loadPart(compiler, 3, b, 1);
+        /* den = b.re * b.re + b.im * b.im; con den == 0.0 (no con NaN) el resultado es 0. */
+        copy(compiler, 4, 2);
+        sse(compiler, JIT_MUL, 4, 2);
+        copy(compiler, 5, 3);
+        sse(compiler, JIT_MUL, 5, 3);
+        sse(compiler, JIT_ADD, 4, 5);
+        zero(compiler, 5);
+        jitSse(&compiler->buffer, JIT_PD, JIT_UCOMISD, 4, 5);
+        size_t unordered = jitJumpIf(&compiler->buffer, JIT_JP);
+        size_t nonZero = jitJumpIf(&compiler->buffer, JIT_JNE);
+        zero(compiler, 6);
+        zero(compiler, 1);
+        size_t done = jitJump(&compiler->buffer);
+        jitPatch(&compiler->buffer, unordered);
+        jitPatch(&compiler->buffer, nonZero);
+        /* re = (a.re * b.re + a.im * b.im) / den */
+        copy(compiler, 6, 0);
+        sse(compiler, JIT_MUL, 6, 2);
+        copy(compiler, 7, 1);
+        sse(compiler, JIT_MUL, 7, 3);
+        sse(compiler, JIT_ADD, 6, 7);
+        sse(compiler, JIT_DIV, 6, 4);
+        /* im = (a.im * b.re - a.re * b.im) / den */
+        sse(compiler, JIT_MUL, 1, 2);
+        sse(compiler, JIT_MUL, 0, 3);
+        sse(compiler, JIT_SUB, 1, 0);
+        sse(compiler, JIT_DIV, 1, 4);
+        jitPatch(&compiler->buffer, done);
+        store(compiler, dst, 6, 1);
+        break;
+    }
+
+    case ESCAPE_OP_ABS:
+        emitNorm(compiler, a);
+        sse(compiler, JIT_SQRT, 0, 0);
+        zero(compiler, 1);
+        store(compiler, dst, 0, 1);
+        break;
+
+    case ESCAPE_OP_LT:
+    case ESCAPE_OP_GT:
+        loadPart(compiler, 0, a, 0);
+        loadPart(compiler, 2, b, 0);
+        /* a.re < b.re es b.re "above" a.re; NaN no es "above" de nada. */
+        if (instruction->opcode == ESCAPE_OP_LT)
+            jitSse(&compiler->buffer, JIT_PD, JIT_UCOMISD, 2, 0);
+        else
+            jitSse(&compiler->buffer, JIT_PD, JIT_UCOMISD, 0, 2);
+        emitAboveFlag(compiler);
+        store(compiler, dst, 4, 5);
+        break;
+
+    case ESCAPE_OP_NORM_GT:
+    case ESCAPE_OP_NORM_LT:
+        emitNorm(compiler, a);
+        loadPart(compiler, 2, b, 0);
+        if (instruction->opcode == ESCAPE_OP_NORM_GT)
+            jitSse(&compiler->buffer, JIT_PD, JIT_UCOMISD, 0, 2);
+        else
+            jitSse(&compiler->buffer, JIT_PD, JIT_UCOMISD, 2, 0);
+        emitAboveFlag(compiler);
+        store(compiler, dst, 4, 5);
+        break;
+
+    case ESCAPE_OP_MAKE:
+        loadPart(compiler, 0, a, 0);
+        loadPart(compiler, 1, b, 0);
+        store(compiler, dst, 0, 1);
+        break;
+
+    default:
+        zero(compiler, 0);
+        store(compiler, dst, 0, 0);
+        break;
+    }
+}
+
+static void emitCode(EscapeJitCompiler *compiler, const EscapeCode *code)
+{
+    for (int k = 0; k < code->length; k++)
+        emitInstruction(compiler, &code->instructions[k]);
+}
+
+static void countUses(const EscapeCode *code, int *uses)
+{
+    for (int k = 0; k < code->length; k++)
+    {
+        uses[code->instructions[k].a]++;
+        uses[code->instructions[k].b]++;
+        uses[code->instructions[k].dst]++;
+    }
+    uses[code->result]++;
+}
+
+/*
+ * z siempre va a registros xmm; el resto de los lugares, a los registros más
+ * leídos y escritos en el loop (la constante c de z*z + c, los temporales).
+ */
+static void allocatePinned(EscapeJitCompiler *compiler, const EscapeProgram *program, int *loaded, int slots)
+{
+    int uses[ESCAPE_MAX_REGISTERS];
+    memset(uses, 0, sizeof(uses));
+    if (program->hasUntil)
+        countUses(&program->until, uses);
+    if (program->hasStep)
+        countUses(&program->step, uses);
+
+    for (int reg = 0; reg < ESCAPE_MAX_REGISTERS; reg++)
+        compiler->pinned[reg] = -1;
+    compiler->pinned[ESCAPE_REGISTER_Z] = ESCAPE_JIT_FIRST_PINNED;
+    loaded[0] = ESCAPE_REGISTER_Z;
+    int count = 1;
+    while (count < slots)
+    {
+        int best = -1;
+        for (int reg = 0; reg < program->registerCount; reg++)
+        {
+            if (compiler->pinned[reg] < 0 && uses[reg] > 0 && (best < 0 || uses[reg] > uses[best]))
+                best = reg;
+        }
+        if (best < 0)
+            break;
+        compiler->pinned[best] = ESCAPE_JIT_FIRST_PINNED + 2 * count;
+        loaded[count++] = best;
+    }
+    for (int k = count; k < ESCAPE_JIT_PINNED; k++)
+        loaded[k] = -1;
+}
+
+/* Bits de z (parte real o imaginaria) en un registro entero. */
+static void loadZBits(EscapeJitCompiler *compiler, int gpr, int imaginary)
+{
+    jitMovqToGpr(&compiler->buffer, gpr, compiler->pinned[ESCAPE_REGISTER_Z] + imaginary);
+}
+
+static int compileScalarLoop(const EscapeProgram *program, JitCode *code)
+{
+    EscapeJitCompiler compiler;
+    initJitBuffer(&compiler.buffer);
+    JitBuffer *buffer = &compiler.buffer;
+    int loaded[ESCAPE_JIT_PINNED];
+    allocatePinned(&compiler, program, loaded, ESCAPE_JIT_PINNED);
+
+    /* Los registros en xmm se cargan una vez; los que calcula el loop se sobrescriben antes de leerse. */
+    for (int k = 0; k < ESCAPE_JIT_PINNED && loaded[k] >= 0; k++)
+    {
+        jitSseMemory(buffer, JIT_SD, JIT_MOVSD_LOAD, compiler.pinned[loaded[k]], REGISTERS, registerOffset(loaded[k], 0));
+        jitSseMemory(buffer, JIT_SD, JIT_MOVSD_LOAD, compiler.pinned[loaded[k]] + 1, REGISTERS,
+                     registerOffset(loaded[k], 1));
+    }
+    jitXor32(buffer, ITER, ITER);
+    if (program->periodicity)
+    {
+        jitXor32(buffer, STEPS, STEPS);
+        jitMovImmediate32(buffer, POWER, 1);
+        loadZBits(&compiler, CHECK_RE, 0);
+        loadZBits(&compiler, CHECK_IM, 1);
+    }
+
+    size_t top = buffer->length;
+    jitCmp32(buffer, ITER, MAX_ITER);
+    size_t exits[3];
+    int exitCount = 0;
+    exits[exitCount++] = jitJumpIf(buffer, JIT_JGE);
+
+    if (program->hasUntil)
+    {
+        emitCode(&compiler, &program->until);
+        /* Se corta si la parte real del resultado es distinta de 0.0 (NaN incluido). */
+        loadPart(&compiler, 0, program->until.result, 0);
+        zero(&compiler, 1);
+        jitSse(buffer, JIT_PD, JIT_UCOMISD, 0, 1);
+        exits[exitCount++] = jitJumpIf(buffer, JIT_JP);
+        exits[exitCount++] = jitJumpIf(buffer, JIT_JNE);
+    }
+
+    if (program->hasStep)
+    {
+        emitCode(&compiler, &program->step);
+        loadPart(&compiler, 0, program->step.result, 0);
+        loadPart(&compiler, 1, program->step.result, 1);
+        store(&compiler, ESCAPE_REGISTER_Z, 0, 1);
+        jitInc32(buffer, ITER);
+
+        if (program->periodicity)
+        {
+            /* Brent: si z repite bit a bit el valor guardado, la órbita es periódica y no escapa. */
+            loadZBits(&compiler, JIT_RAX, 0);
+            jitCmp64(buffer, JIT_RAX, CHECK_RE);
+            size_t different = jitJumpIf(buffer, JIT_JNE);
+            loadZBits(&compiler, JIT_RAX, 1);
+            jitCmp64(buffer, JIT_RAX, CHECK_IM);
+            size_t differentIm = jitJumpIf(buffer, JIT_JNE);
+            jitMov32(buffer, JIT_RAX, MAX_ITER);
+            jitRet(buffer);
+            jitPatch(buffer, different);
+            jitPatch(buffer, differentIm);
+            jitInc32(buffer, STEPS);
+            jitCmp32(buffer, STEPS, POWER);
+            jitJumpIfTo(buffer, JIT_JNE, top);
+            loadZBits(&compiler, CHECK_RE, 0);
+            loadZBits(&compiler, CHECK_IM, 1);
+            jitXor32(buffer, STEPS, STEPS);
+            jitAdd32(buffer, POWER, POWER);
+        }
+        jitJumpTo(buffer, top);
+    }
+
+    for (int k = 0; k < exitCount; k++)
+        jitPatch(buffer, exits[k]);
+    jitMov32(buffer, JIT_RAX, ITER);
+    jitRet(buffer);
+    return finishJitCode(buffer, code);
+}
+
+/*
+ * El loop vectorial usa ymm0 a ymm7 como temporales, ymm8 a ymm13 para tres
+ * registros complejos del programa, ymm14 para la máscara de lanes activos y
+ * ymm15 para el contador de iteraciones.
+ */
+#define ESCAPE_JIT_LANE_PINNED 3
+#define ACTIVE 14
+#define COUNTER 15
+#define LANES JIT_RDI
+
+static int32_t laneOffset(int reg, int imaginary)
+{
+    return (int32_t)(offsetof(EscapeJitLanes, r) + reg * sizeof(EscapeJitVector) +
+                     (imaginary ? offsetof(EscapeJitVector, im) : offsetof(EscapeJitVector, re)));
+}
+
+static void avx(EscapeJitCompiler *compiler, uint8_t opcode, int dst, int a, int b)
+{
+    jitAvx(&compiler->buffer, opcode, dst, a, b);
+}
+
+/* El ymm con la parte pedida de un registro: el suyo si vive en uno, si no el temporal ymm, cargado. */
+static int lanePart(EscapeJitCompiler *compiler, int ymm, int reg, int imaginary)
+{
+    if (compiler->pinned[reg] >= 0)
+        return compiler->pinned[reg] + imaginary;
+    jitAvxMemory(&compiler->buffer, JIT_MOVUPD_LOAD, ymm, 0, LANES, laneOffset(reg, imaginary));
+    return ymm;
+}
+
+static void storeLanePart(EscapeJitCompiler *compiler, int reg, int imaginary, int ymm)
+{
+    if (compiler->pinned[reg] >= 0)
+        avx(compiler, JIT_MOVAPD, compiler->pinned[reg] + imaginary, 0, ymm);
+    else
+        jitAvxMemory(&compiler->buffer, JIT_MOVUPD_STORE, ymm, 0, LANES, laneOffset(reg, imaginary));
+}
+
+/* ymm = ymm & one: las máscaras de las comparaciones pasan a 1.0 y 0.0. */
+static void maskToOne(EscapeJitCompiler *compiler, int ymm, int mask)
+{
+    jitAvxMemory(&compiler->buffer, JIT_AND, ymm, mask, LANES, (int32_t)offsetof(EscapeJitLanes, one));
+}
+
+/* Los registros destino nunca son operandos de la misma instrucción, así que se escriben apenas se calculan. */
+static void emitLaneInstruction(EscapeJitCompiler *compiler, const EscapeInstruction *instruction)
+{
+    int a = instruction->a;
+    int b = instruction->opcode == ESCAPE_OP_SQUARE ? instruction->a : instruction->b;
+    int dst = instruction->dst;
+    int ar = lanePart(compiler, 0, a, 0);
+    int ai = lanePart(compiler, 1, a, 1);
+    int br = lanePart(compiler, 2, b, 0);
+    int bi = lanePart(compiler, 3, b, 1);
+    switch (instruction->opcode)
+    {
+    case ESCAPE_OP_ADD:
+    case ESCAPE_OP_SUB:
+    {
+        uint8_t opcode = instruction->opcode == ESCAPE_OP_ADD ? JIT_ADD : JIT_SUB;
+        avx(compiler, opcode, 4, ar, br);
+        avx(compiler, opcode, 5, ai, bi);
+        storeLanePart(compiler, dst, 0, 4);
+        storeLanePart(compiler, dst, 1, 5);
+        break;
+    }
+
+    case ESCAPE_OP_MUL:
+    case ESCAPE_OP_SQUARE:
+        avx(compiler, JIT_MUL, 4, ar, br);
+        avx(compiler, JIT_MUL, 5, ai, bi);
+        avx(compiler, JIT_SUB, 4, 4, 5);
+        avx(compiler, JIT_MUL, 6, ar, bi);
+        avx(compiler, JIT_MUL, 7, ai, br);
+        avx(compiler, JIT_ADD, 5, 6, 7);
+        storeLanePart(compiler, dst, 0, 4);
+        storeLanePart(compiler, dst, 1, 5);
+        break;
+
+    case ESCAPE_OP_DIV:
+        /* den en ymm4 y la máscara de den != 0.0 (verdadera con NaN) en ymm6. */
+        avx(compiler, JIT_MUL, 4, br, br);
+        avx(compiler, JIT_MUL, 5, bi, bi);
+        avx(compiler, JIT_ADD, 4, 4, 5);
+        avx(compiler, JIT_XOR, 5, 5, 5);
+        jitAvxCompare(&compiler->buffer, 6, 4, 5, JIT_CMP_NEQ);
+        avx(compiler, JIT_MUL, 5, ar, br);
+        avx(compiler, JIT_MUL, 7, ai, bi);
+        avx(compiler, JIT_ADD, 5, 5, 7);
+        avx(compiler, JIT_DIV, 5, 5, 4);
+        avx(compiler, JIT_AND, 5, 5, 6);
+        storeLanePart(compiler, dst, 0, 5);
+        avx(compiler, JIT_MUL, 5, ai, br);
+        avx(compiler, JIT_MUL, 7, ar, bi);
+        avx(compiler, JIT_SUB, 5, 5, 7);
+        avx(compiler, JIT_DIV, 5, 5, 4);
+        avx(compiler, JIT_AND, 5, 5, 6);
+        storeLanePart(compiler, dst, 1, 5);
+        break;
+
+    case ESCAPE_OP_ABS:
+        avx(compiler, JIT_MUL, 4, ar, ar);
+        avx(compiler, JIT_MUL, 5, ai, ai);
+        avx(compiler, JIT_ADD, 4, 4, 5);
+        avx(compiler, JIT_SQRT, 4, 0, 4);
+        avx(compiler, JIT_XOR, 5, 5, 5);
+        storeLanePart(compiler, dst, 0, 4);
+        storeLanePart(compiler, dst, 1, 5);
+        break;
+
+    case ESCAPE_OP_LT:
+    case ESCAPE_OP_GT:
+        if (instruction->opcode == ESCAPE_OP_LT)
+            jitAvxCompare(&compiler->buffer, 4, ar, br, JIT_CMP_LT);
+        else
+            jitAvxCompare(&compiler->buffer, 4, br, ar, JIT_CMP_LT);
+        maskToOne(compiler, 4, 4);
+        avx(compiler, JIT_XOR, 5, 5, 5);
+        storeLanePart(compiler, dst, 0, 4);
+        storeLanePart(compiler, dst, 1, 5);
+        break;
+
+    case ESCAPE_OP_NORM_GT:
+    case ESCAPE_OP_NORM_LT:
+        avx(compiler, JIT_MUL, 4, ar, ar);
+        avx(compiler, JIT_MUL, 5, ai, ai);
+        avx(compiler, JIT_ADD, 4, 4, 5);
+        if (instruction->opcode == ESCAPE_OP_NORM_GT)
+            jitAvxCompare(&compiler->buffer, 4, br, 4, JIT_CMP_LT);
+        else
+            jitAvxCompare(&compiler->buffer, 4, 4, br, JIT_CMP_LT);
+        maskToOne(compiler, 4, 4);
+        avx(compiler, JIT_XOR, 5, 5, 5);
+        storeLanePart(compiler, dst, 0, 4);
+        storeLanePart(compiler, dst, 1, 5);
+        break;
+
+    case ESCAPE_OP_MAKE:
+        storeLanePart(compiler, dst, 0, ar);
+        storeLanePart(compiler, dst, 1, br);
+        break;
+
+    default:
+        avx(compiler, JIT_XOR, 4, 4, 4);
+        storeLanePart(compiler, dst, 0, 4);
+        storeLanePart(compiler, dst, 1, 4);
+        break;
+    }
+}
+
+static void emitLaneCode(EscapeJitCompiler *compiler, const EscapeCode *code)
+{
+    for (int k = 0; k < code->length; k++)
+        emitLaneInstruction(compiler, &code->instructions[k]);
+}
+
+/*
+ * Una vuelta es la del loop escalar en cuatro lanes a la vez: el "until",
+ * la máscara de los lanes que terminaron y, si no terminó ninguno, el paso.
+ * Al terminar alguno se guardan los registros y se vuelve, para que el que
+ * llamó lo recargue; los demás repiten el "until" en la próxima llamada, que
+ * da lo mismo.
+ */
+static int compileLaneLoop(const EscapeProgram *program, JitCode *code)
+{
+    EscapeJitCompiler compiler;
+    initJitBuffer(&compiler.buffer);
+    JitBuffer *buffer = &compiler.buffer;
+    int loaded[ESCAPE_JIT_PINNED];
+    allocatePinned(&compiler, program, loaded, ESCAPE_JIT_LANE_PINNED);
+
+    for (int k = 0; k < ESCAPE_JIT_LANE_PINNED && loaded[k] >= 0; k++)
+    {
+        jitAvxMemory(buffer, JIT_MOVUPD_LOAD, compiler.pinned[loaded[k]], 0, LANES, laneOffset(loaded[k], 0));
+        jitAvxMemory(buffer, JIT_MOVUPD_LOAD, compiler.pinned[loaded[k]] + 1, 0, LANES, laneOffset(loaded[k], 1));
+    }
+    jitAvxMemory(buffer, JIT_MOVUPD_LOAD, ACTIVE, 0, LANES, (int32_t)offsetof(EscapeJitLanes, active));
+    jitAvxMemory(buffer, JIT_MOVUPD_LOAD, COUNTER, 0, LANES, (int32_t)offsetof(EscapeJitLanes, iter));
+
+    size_t top = buffer->length;
+    if (program->hasUntil)
+        emitLaneCode(&compiler, &program->until);
+    /* done = (iter >= maxIter | until != 0.0) & active */
+    jitAvxCompareMemory(buffer, 0, COUNTER, LANES, (int32_t)offsetof(EscapeJitLanes, limit), JIT_CMP_GE);
+    if (program->hasUntil)
+    {
+        int until = lanePart(&compiler, 1, program->until.result, 0);
+        avx(&compiler, JIT_XOR, 2, 2, 2);
+        jitAvxCompare(buffer, 1, until, 2, JIT_CMP_NEQ);
+        avx(&compiler, JIT_OR, 0, 0, 1);
+    }
+    avx(&compiler, JIT_AND, 0, 0, ACTIVE);
+    jitAvxMovemask(buffer, JIT_RAX, 0);
+    jitTest32(buffer, JIT_RAX, JIT_RAX);
+    size_t exit = jitJumpIf(buffer, JIT_JNE);
+
+    emitLaneCode(&compiler, &program->step);
+    int re = lanePart(&compiler, 0, program->step.result, 0);
+    int im = lanePart(&compiler, 1, program->step.result, 1);
+    storeLanePart(&compiler, ESCAPE_REGISTER_Z, 0, re);
+    storeLanePart(&compiler, ESCAPE_REGISTER_Z, 1, im);
+    maskToOne(&compiler, 0, ACTIVE);
+    avx(&compiler, JIT_ADD, COUNTER, COUNTER, 0);
+    jitJumpTo(buffer, top);
+
+    jitPatch(buffer, exit);
+    for (int k = 0; k < ESCAPE_JIT_LANE_PINNED && loaded[k] >= 0; k++)
+    {
+        jitAvxMemory(buffer, JIT_MOVUPD_STORE, compiler.pinned[loaded[k]], 0, LANES, laneOffset(loaded[k], 0));
+        jitAvxMemory(buffer, JIT_MOVUPD_STORE, compiler.pinned[loaded[k]] + 1, 0, LANES, laneOffset(loaded[k], 1));
+    }
+    jitAvxMemory(buffer, JIT_MOVUPD_STORE, COUNTER, 0, LANES, (int32_t)offsetof(EscapeJitLanes, iter));
+    jitVzeroupper(buffer);
+    jitRet(buffer);
+    return finishJitCode(buffer, code);
+}
+
+EscapeJit *compileEscapeJit(const EscapeProgram *program)
+{
+    if (!program || !jitAvailable())
+        return NULL;
+
+    EscapeJit *jit = calloc(1, sizeof(EscapeJit));
+    if (!compileScalarLoop(program, &jit->code))
+    {
+        free(jit);
+        return NULL;
+    }
+    jit->iterate = (EscapeJitFunction)jit->code.entry;
+    /* Brent compara z bit a bit en cada lane; eso queda para el loop escalar o el intérprete vectorial. */
+    if (program->hasStep && !program->periodicity && jitAvxAvailable() && compileLaneLoop(program, &jit->laneCode))
+        jit->iterateLanes = (EscapeJitLaneFunction)jit->laneCode.entry;
+    return jit;
+}
+
+void destroyEscapeJit(EscapeJit *jit)
+{
+    if (jit)
+    {
+        releaseJitCode(&jit->code);
+        releaseJitCode(&jit->laneCode);
+        free(jit);
+    }
+}
+
+/* Como loadProgramLane del motor vectorial. */
+static void loadLane(const EscapeProgram *program, Complex *scalar, EscapeJitLanes *lanes, int l, double x, double y)
+{
+    Complex z = escapeInitialValue(program, scalar, x, y);
+    lanes->r[ESCAPE_REGISTER_Z].re[l] = z.re;
+    lanes->r[ESCAPE_REGISTER_Z].im[l] = z.im;
+    lanes->r[ESCAPE_REGISTER_X].re[l] = x;
+    lanes->r[ESCAPE_REGISTER_Y].re[l] = y;
+    for (int k = 0; k < program->pixel.length; k++)
+    {
+        int dst = program->pixel.instructions[k].dst;
+        lanes->r[dst].re[l] = scalar[dst].re;
+        lanes->r[dst].im[l] = scalar[dst].im;
+    }
+    lanes->iter[l] = 0.0;
+    lanes->active[l] = UINT64_MAX;
+}
+
+void iterateEscapeJitLanes(const EscapeJit *jit, const EscapeProgram *program, const double *xs, const double *ys,
+                           int count, int maxIter, int *iterations)
+{
+    EscapeJitLanes lanes;
+    Complex scalar[ESCAPE_MAX_REGISTERS];
+    for (int k = 0; k < program->registerCount; k++)
+    {
+        scalar[k] = program->initialRegisters[k];
+        for (int l = 0; l < ESCAPE_JIT_LANES; l++)
+        {
+            lanes.r[k].re[l] = scalar[k].re;
+            lanes.r[k].im[l] = scalar[k].im;
+        }
+    }
+
+    int pixel[ESCAPE_JIT_LANES];
+    int next = 0;
+    int running = 0;
+    for (int l = 0; l < ESCAPE_JIT_LANES; l++)
+    {
+        lanes.limit[l] = (double)maxIter;
+        lanes.one[l] = 1.0;
+        lanes.iter[l] = 0.0;
+        lanes.active[l] = 0;
+        pixel[l] = -1;
+        if (next < count)
+        {
+            loadLane(program, scalar, &lanes, l, xs[next], ys[next]);
+            pixel[l] = next++;
+            running++;
+        }
+    }
+
+    while (running > 0)
+    {
+        int done = jit->iterateLanes(&lanes);
+        for (int l = 0; l < ESCAPE_JIT_LANES; l++)
+        {
+            if (!(done & (1 << l)))
+                continue;
+            iterations[pixel[l]] = (int)lanes.iter[l];
+            if (next < count)
+            {
+                loadLane(program, scalar, &lanes, l, xs[next], ys[next]);
+                pixel[l] = next++;
+            }
+            else
+            {
+                lanes.iter[l] = 0.0;
+                lanes.active[l] = 0;
+                pixel[l] = -1;
+                running--;
+            }
+        }
+    }
+}
@@ -0,0 +1,77 @@
+#ifndef ESCAPE_JIT_HEADER
+#define ESCAPE_JIT_HEADER
+
+#include "EscapeBytecode.h"
+#include "Jit.h"
+
+/* Iteraciones del loop de un programa, con los registros ya cargados para el píxel. */
+typedef int (*EscapeJitFunction)(Complex *registers, int maxIter);
+
+/* Píxeles que el loop vectorial itera a la vez: los 4 doubles de un registro ymm. */
+#define ESCAPE_JIT_LANES 4
+
+typedef struct
+{
+    double re[ESCAPE_JIT_LANES];
+    double im[ESCAPE_JIT_LANES];
+} EscapeJitVector;
+
+/** Estado de los lanes entre llamadas al loop vectorial. */
+typedef struct
+{
+    EscapeJitVector r[ESCAPE_MAX_REGISTERS];
+    double iter[ESCAPE_JIT_LANES];
+    /* Todos los bits en 1 en los lanes con un píxel cargado. */
+    uint64_t active[ESCAPE_JIT_LANES];
+    double limit[ESCAPE_JIT_LANES];
+    double one[ESCAPE_JIT_LANES];
+} EscapeJitLanes;
+
+/*
+ * Itera los lanes activos hasta que alguno termina y devuelve la máscara de
+ * los que terminaron (bit l para el lane l).
+ */
+typedef int (*EscapeJitLaneFunction)(EscapeJitLanes *lanes);
+
+/**
+ * El loop de iteración de un programa de escape ("until:", el paso y la
+ * detección de ciclos) compilado a x86-64. z y los registros más usados del
+ * loop viven en registros xmm durante todo el píxel; el resto se lee del
+ * banco de registros del worker. Cada operación hace las mismas operaciones
+ * de double que applyEscapeOpcode, así que las iteraciones son exactamente
+ * las del intérprete.
+ */
+typedef struct
+{
+    JitCode code;
+    EscapeJitFunction iterate;
+    /* El mismo loop en AVX, de a ESCAPE_JIT_LANES píxeles; NULL sin AVX o con periodicity. */
+    JitCode laneCode;
+    EscapeJitLaneFunction iterateLanes;
+} EscapeJit;
+
+/**
+ * Compila el loop del programa (con su periodicity actual). Devuelve NULL si
+ * el proceso no puede generar código nativo: se sigue con el intérprete.
+ */
+EscapeJit *compileEscapeJit(const EscapeProgram *program);
+
+void destroyEscapeJit(EscapeJit *jit);
+
+/** Igual que iterateEscapeProgram, con el loop compilado. */
+static inline int iterateEscapeJit(const EscapeJit *jit, const EscapeProgram *program, Complex *registers, double x,
+                                   double y, int maxIter)
+{
+    registers[ESCAPE_REGISTER_Z] = escapeInitialValue(program, registers, x, y);
+    return jit->iterate(registers, maxIter);
+}
+
+/**
+ * Igual que iterateEscapeSimd con el programa, con el loop vectorial
+ * compilado: los lanes que terminan se recargan acá, entre llamadas, y el
+ * resto sigue en registros. Requiere jit->iterateLanes.
+ */
+void iterateEscapeJitLanes(const EscapeJit *jit, const EscapeProgram *program, const double *xs, const double *ys,
+                           int count, int maxIter, int *iterations);
+
+#endif
@@ -0,0 +1,281 @@
+#include "EscapeKernels.h"
+#include "EscapeExpression.h"
+#include <math.h>
+#include <string.h>
+
+static EscapeFactor *factorOf(EscapeExpression *expr)
+{
+    expr = unwrapEscapeExpression(expr);
+    if (!expr || expr->type != FACTOR)
+        return NULL;
+    return expr->factor;
+}
+
+static int isEscapeVariable(EscapeExpression *expr, Escape *escape)
+{
+    EscapeFactor *factor = factorOf(expr);
+    return factor && factor->type == VARIABLE && escape->variable &&
+           strcmp(factor->variable->name, escape->variable->name) == 0;
+}
+
+/* z*z, con ambos operandos iguales a la variable del escape. */
+static int isSquare(EscapeExpression *expr, Escape *escape)
+{
+    expr = unwrapEscapeExpression(expr);
+    return expr && expr->type == MULTIPLICATION &&
+           isEscapeVariable(expr->leftExpression, escape) &&
+           isEscapeVariable(expr->rightExpression, escape);
+}
+
+/* Valor real que es una constante, un parámetro de la regla o una coordenada. */
+static int matchComponent(EscapeExpression *expr, Escape *escape, RenderContext *ctx,
+                          EscapeSource *source, double *value)
+{
+    EscapeFactor *factor = factorOf(expr);
+    if (!factor)
+        return 0;
+
+    *source = ESCAPE_SOURCE_CONSTANT;
+    *value = 0.0;
+    switch (factor->type)
+    {
+    case CONSTANT:
+        *value = (double)factor->constant->value;
+        return 1;
+    case DOUBLE_CONSTANT:
+        *value = factor->doubleConstant->value;
+        return 1;
+    case VARIABLE:
+        if (isEscapeVariable(expr, escape))
+            return 0;
+        *value = getVariableValue(ctx, factor->variable);
+        return 1;
+    case X_COORD_FACTOR:
+        *source = ESCAPE_SOURCE_X;
+        return 1;
+    case Y_COORD_FACTOR:
+        *source = ESCAPE_SOURCE_Y;
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+/* Un valor real (parte imaginaria nula) o un rango [re, im] de componentes. */
+static int matchOperand(EscapeExpression *expr, Escape *escape, RenderContext *ctx, EscapeOperand *operand)
+{
+    EscapeFactor *factor = factorOf(expr);
+    if (factor && factor->type == RANGE)
+    {
+        return factor->range &&
+               matchComponent(factor->range->start, escape, ctx, &operand->reSource, &operand->re) &&
+               matchComponent(factor->range->end, escape, ctx, &operand->imSource, &operand->im);
+    }
+    operand->imSource = ESCAPE_SOURCE_CONSTANT;
+    operand->im = 0.0;
+    return matchComponent(expr, escape, ctx, &operand->reSource, &operand->re);
+}
+
+static int matchConstant(EscapeExpression *expr, Escape *escape, RenderContext *ctx, double *value)
+{
+    EscapeSource source;
+    return matchComponent(expr, escape, ctx, &source, value) && source == ESCAPE_SOURCE_CONSTANT;
+}
+
+static int isMagnitude(EscapeExpression *expr, Escape *escape)
+{
+    expr = unwrapEscapeExpression(expr);
+    return expr && expr->type == ABSOLUTE_VALUE && isEscapeVariable(expr->leftExpression, escape);
+}
+
+/* |z| > k, o su forma simétrica k < |z|. */
+static int matchBailout(EscapeExpression *expr, Escape *escape, RenderContext *ctx, double *bailout)
+{
+    expr = unwrapEscapeExpression(expr);
+    if (!expr)
+        return 0;
+    if (expr->type == GREATER_THAN_OP)
+        return isMagnitude(expr->leftExpression, escape) &&
+               matchConstant(expr->rightExpression, escape, ctx, bailout);
+    if (expr->type == LOWER_THAN_OP)
+        return isMagnitude(expr->rightExpression, escape) &&
+               matchConstant(expr->leftExpression, escape, ctx, bailout);
+    return 0;
+}
+
+/* z*z + c, o c + z*z (la suma de doubles es conmutativa). */
+static int matchQuadraticStep(EscapeExpression *expr, Escape *escape, RenderContext *ctx, EscapeOperand *c)
+{
+    expr = unwrapEscapeExpression(expr);
+    if (!expr || expr->type != ADDITION)
+        return 0;
+    if (isSquare(expr->leftExpression, escape))
+        return matchOperand(expr->rightExpression, escape, ctx, c);
+    if (isSquare(expr->rightExpression, escape))
+        return matchOperand(expr->leftExpression, escape, ctx, c);
+    return 0;
+}
+
+static int dependsOnPixel(const EscapeOperand *operand)
+{
+    return operand->reSource != ESCAPE_SOURCE_CONSTANT || operand->imSource != ESCAPE_SOURCE_CONSTANT;
+}
+
+EscapeKernel matchEscapeKernel(Escape *escape, RenderContext *ctx)
+{
+    EscapeKernel kernel;
+    memset(&kernel, 0, sizeof(kernel));
+    kernel.type = ESCAPE_KERNEL_NONE;
+
+    if (!escape || !escape->variable || !escape->recursiveAssigment || !escape->untilCondition)
+        return kernel;
+
+    EscapeOperand initial = {ESCAPE_SOURCE_CONSTANT, ESCAPE_SOURCE_CONSTANT, 0.0, 0.0};
+    EscapeOperand c;
+    double bailout;
+
+    if (escape->initialValue && !matchOperand(escape->initialValue, escape, ctx, &initial))
+        return kernel;
+    if (!matchQuadraticStep(escape->recursiveAssigment, escape, ctx, &c))
+        return kernel;
+    if (!matchBailout(escape->untilCondition, escape, ctx, &bailout))
+        return kernel;
+
+    kernel.type = dependsOnPixel(&c) ? ESCAPE_KERNEL_MANDELBROT : ESCAPE_KERNEL_JULIA;
+    kernel.initial = initial;
+    kernel.c = c;
+    kernel.bailout = bailout;
+    kernel.threshold = complexAbsAboveThreshold(bailout);
+    kernel.periodicity = 0;
+    kernel.interior = 0;
+    return kernel;
+}
+
+int supportsInteriorCheck(const EscapeKernel *kernel)
+{
+    const EscapeOperand *initial = &kernel->initial;
+    return kernel->type == ESCAPE_KERNEL_MANDELBROT &&
+           initial->reSource == ESCAPE_SOURCE_CONSTANT && initial->re == 0.0 &&
+           initial->imSource == ESCAPE_SOURCE_CONSTANT && initial->im == 0.0 &&
+           kernel->bailout >= 2.0;
+}
+
+int isEscapeKernelInterior(const EscapeKernel *kernel, double x, double y)
+{
+    Complex c = evaluateEscapeOperand(&kernel->c, x, y);
+    double re = c.re - 0.25;
+    double im2 = c.im * c.im;
+    double q = re * re + im2;
+    if (q * (q + re) <= 0.25 * im2)
+        return 1;
+    double bulb = c.re + 1.0;
+    return bulb * bulb + im2 <= 0.0625;
+}
+
+const char *escapeKernelName(EscapeKernelType type)
+{
+    switch (type)
+    {
+    case ESCAPE_KERNEL_MANDELBROT:
+        return "mandelbrot";
+    case ESCAPE_KERNEL_JULIA:
+        return "julia";
+    default:
+        return "ninguno";
+    }
+}
+
+static inline double sourceValue(EscapeSource source, double constant, double x, double y)
+{
+    if (source == ESCAPE_SOURCE_X)
+        return x;
+    if (source == ESCAPE_SOURCE_Y)
+        return y;
+    return constant;
+}
+
+Complex evaluateEscapeOperand(const EscapeOperand *operand, double x, double y)
+{
+    return makeComplex(sourceValue(operand->reSource, operand->re, x, y),
+                       sourceValue(operand->imSource, operand->im, x, y));
+}
+
+/*
+ * Loop de z = z*z + c con re/im en registros. Las operaciones (y su orden) son
+ * exactamente las de complexMul/complexAdd, y la norma se compara contra el
+ * umbral exacto de |z| > bailout, así que el resultado es idéntico al del
+ * evaluador genérico. zr*zr y zi*zi se comparten entre la norma y el paso.
+ */
+static inline int iterateQuadratic(double zr, double zi, double cr, double ci, double threshold, int maxIter,
+                                   double *norm)
+{
+    int iter = 0;
+    while (iter < maxIter)
+    {
+        double rr = zr * zr;
+        double ii = zi * zi;
+        if (rr + ii > threshold)
+        {
+            if (norm)
+                *norm = rr + ii;
+            break;
+        }
+        double re = (rr - ii) + cr;
+        double im = (zr * zi + zi * zr) + ci;
+        zr = re;
+        zi = im;
+        iter++;
+    }
+    return iter;
+}
+
+/*
+ * Igual que iterateQuadratic, con detección de ciclos de Brent: se guarda z
+ * en potencias de 2 y, si la órbita vuelve a pasar exactamente (bit a bit)
+ * por el z guardado, se repetirá para siempre sin escapar.
+ */
+static inline int iterateQuadraticPeriodic(double zr, double zi, double cr, double ci, double threshold,
+                                           int maxIter, double *norm)
+{
+    Complex check = makeComplex(zr, zi);
+    int steps = 0;
+    int power = 1;
+    int iter = 0;
+    while (iter < maxIter)
+    {
+        double rr = zr * zr;
+        double ii = zi * zi;
+        if (rr + ii > threshold)
+        {
+            if (norm)
+                *norm = rr + ii;
+            break;
+        }
+        double re = (rr - ii) + cr;
+        double im = (zr * zi + zi * zr) + ci;
+        zr = re;
+        zi = im;
+        iter++;
+        if (complexSameBits(makeComplex(zr, zi), check))
+            return maxIter;
+        if (++steps == power)
+        {
+            check = makeComplex(zr, zi);
+            steps = 0;
+            power <<= 1;
+        }
+    }
+    return iter;
+}
+
+int iterateEscapeKernel(const EscapeKernel *kernel, double x, double y, int maxIter, double *norm)
+{
+    if (kernel->interior && isEscapeKernelInterior(kernel, x, y))
+        return maxIter;
+
+    Complex z = evaluateEscapeOperand(&kernel->initial, x, y);
+    Complex c = evaluateEscapeOperand(&kernel->c, x, y);
+    if (kernel->periodicity)
+        return iterateQuadraticPeriodic(z.re, z.im, c.re, c.im, kernel->threshold, maxIter, norm);
+    return iterateQuadratic(z.re, z.im, c.re, c.im, kernel->threshold, maxIter, norm);
+}
@@ -0,0 +1,89 @@
+#ifndef ESCAPE_KERNELS_HEADER
+#define ESCAPE_KERNELS_HEADER
+
+#include "../../frontend/syntactic-analysis/AbstractSyntaxTree.h"
+#include "Complex.h"
+#include "RenderContext.h"
+
+/** Origen de una componente (real o imaginaria) de un operando de un kernel. */
+typedef enum
+{
+    ESCAPE_SOURCE_CONSTANT,
+    ESCAPE_SOURCE_X,
+    ESCAPE_SOURCE_Y
+} EscapeSource;
+
+/** Operando complejo cuyas componentes son constantes o coordenadas del píxel. */
+typedef struct
+{
+    EscapeSource reSource;
+    EscapeSource imSource;
+    double re;
+    double im;
+} EscapeOperand;
+
+typedef enum
+{
+    ESCAPE_KERNEL_NONE,
+    /* z = z*z + c, con c dependiente del píxel (ej: [:y:,:x:]). */
+    ESCAPE_KERNEL_MANDELBROT,
+    /* z = z*z + c, con c constante y z inicial dependiente del píxel. */
+    ESCAPE_KERNEL_JULIA
+} EscapeKernelType;
+
+/**
+ * Forma reconocida de un escape: "escape: z0 z=z*z+c until: |z|>bailout".
+ * Si type es ESCAPE_KERNEL_NONE, la fórmula debe evaluarse con el bytecode.
+ */
+typedef struct
+{
+    EscapeKernelType type;
+    EscapeOperand initial;
+    EscapeOperand c;
+    double bailout;
+    /* |z| > bailout equivale a |z|^2 > threshold (ver complexAbsAboveThreshold). */
+    double threshold;
+    /* Salidas tempranas opcionales; las activa el renderer. */
+    int periodicity;
+    int interior;
+} EscapeKernel;
+
+/**
+ * Reconoce en el AST del escape alguna de las formas con kernel nativo. La
+ * comparación es estructural: los paréntesis, los espacios y el orden de los
+ * sumandos de "z*z+c" no importan. Los parámetros de la regla se resuelven con
+ * los valores del contexto.
+ */
+EscapeKernel matchEscapeKernel(Escape *escape, RenderContext *ctx);
+
+/**
+ * Si el test analítico de interior (cardioide principal y bulbo de período 2)
+ * es válido para el kernel: es Mandelbrot, z arranca en 0 y bailout >= 2, así
+ * que ningún punto del conjunto puede escapar.
+ */
+int supportsInteriorCheck(const EscapeKernel *kernel);
+
+/**
+ * Si el píxel (x, y) está dentro de la cardioide principal o del bulbo de
+ * período 2, en cuyo caso no escapa nunca y se puede pintar como si hubiese
+ * llegado a maxIter sin iterar.
+ */
+int isEscapeKernelInterior(const EscapeKernel *kernel, double x, double y);
+
+/** Nombre legible del kernel (para el log). */
+const char *escapeKernelName(EscapeKernelType type);
+
+/** Valor de un operando del kernel en el píxel de coordenadas (x, y). */
+Complex evaluateEscapeOperand(const EscapeOperand *operand, double x, double y);
+
+/**
+ * Itera el kernel para un píxel con coordenadas (x, y) y devuelve la cantidad
+ * de iteraciones realizadas, idéntica a la del evaluador genérico. Si la
+ * órbita entra en un ciclo exacto (periodicity) o el píxel es interior
+ * (interior), devuelve maxIter sin terminar de iterar. Si norm no es NULL y
+ * el píxel escapó, deja en *norm el |z|^2 con el que escapó (para el coloreo
+ * suave).
+ */
+int iterateEscapeKernel(const EscapeKernel *kernel, double x, double y, int maxIter, double *norm);
+
+#endif
@@ -0,0 +1,65 @@
+#include "EscapePrecision.h"
+#include <float.h>
+#include <math.h>
+
+/* Ulps de margen entre píxeles vecinos en double y en double-double. */
+#define ESCAPE_PRECISION_ULPS 1024.0
+
+EscapePrecision requiredEscapePrecision(const DeepZoomView *view, int width, int height, int maxIter)
+{
+    if (width <= 0 || height <= 0)
+        return ESCAPE_PRECISION_DOUBLE;
+    double stepX = fabs(fixedToDouble(fixedSub(view->maxX, view->minX))) / width;
+    double stepY = fabs(fixedToDouble(fixedSub(view->maxY, view->minY))) / height;
+    double step = fmin(stepX, stepY);
+    double magnitude = fmax(fmax(fabs(fixedToDouble(view->minX)), fabs(fixedToDouble(view->maxX))),
+                            fmax(fabs(fixedToDouble(view->minY)), fabs(fixedToDouble(view->maxY))));
+    if (step <= 0.0)
+        return ESCAPE_PRECISION_DOUBLE;
+    if (step >= magnitude * DBL_EPSILON * ESCAPE_PRECISION_ULPS)
+        return ESCAPE_PRECISION_DOUBLE;
+    /*
+     * Cerca del conjunto el error relativo de la órbita crece con cada
+     * iteración, y en los views que necesitan double-double las órbitas son
+     * largas: el margen se escala con maxIter para que la perturbación (que
+     * itera diferencias, con error relativo a la distancia a la referencia)
+     * tome los views donde double-double no alcanzaría.
+     */
+    if (step >= magnitude * DOUBLE_DOUBLE_EPSILON * ESCAPE_PRECISION_ULPS * maxIter)
+        return ESCAPE_PRECISION_DOUBLE_DOUBLE;
+    return ESCAPE_PRECISION_PERTURBATION;
+}
+
+const char *escapePrecisionName(EscapePrecision precision)
+{
+    switch (precision)
+    {
+    case ESCAPE_PRECISION_FLOAT:
+        return "float";
+    case ESCAPE_PRECISION_DOUBLE:
+        return "double";
+    case ESCAPE_PRECISION_DOUBLE_DOUBLE:
+        return "double-double";
+    case ESCAPE_PRECISION_PERTURBATION:
+        return "perturbación";
+    default:
+        return "desconocida";
+    }
+}
+
+DoubleDouble fixedToDoubleDouble(FixedPoint value)
+{
+    double hi = fixedToDouble(value);
+    double lo = fixedToDouble(fixedSub(value, fixedFromDouble(hi)));
+    return ddQuickTwoSum(hi, lo);
+}
+
+DoubleDoubleGrid loadDoubleDoubleGrid(const DeepZoomView *view, int width, int height)
+{
+    DoubleDoubleGrid grid;
+    grid.minX = fixedToDoubleDouble(view->minX);
+    grid.minY = fixedToDoubleDouble(view->minY);
+    grid.stepX = fixedToDoubleDouble(fixedDiv(fixedSub(view->maxX, view->minX), fixedFromInt(width > 0 ? width : 1)));
+    grid.stepY = fixedToDoubleDouble(fixedDiv(fixedSub(view->maxY, view->minY), fixedFromInt(height > 0 ? height : 1)));
+    return grid;
+}
@@ -0,0 +1,48 @@
+#ifndef ESCAPE_PRECISION_HEADER
+#define ESCAPE_PRECISION_HEADER
+
+#include "DoubleDouble.h"
+#include "EscapeDeepZoom.h"
+#include "FixedPoint.h"
+
+/** Aritmética con la que se itera un escape, de la más barata a la más precisa. */
+typedef enum
+{
+    /* Órbita en float con SIMD: el doble de lanes por registro. */
+    ESCAPE_PRECISION_FLOAT,
+    ESCAPE_PRECISION_DOUBLE,
+    /* Órbita y coordenadas en double-double (unos 106 bits), de a un píxel. */
+    ESCAPE_PRECISION_DOUBLE_DOUBLE,
+    /* Órbita de referencia en punto fijo y diferencias en double (EscapeDeepZoom). */
+    ESCAPE_PRECISION_PERTURBATION
+} EscapePrecision;
+
+/** Coordenadas de los píxeles en double-double: x = minX + px * stepX. */
+typedef struct
+{
+    DoubleDouble minX;
+    DoubleDouble minY;
+    DoubleDouble stepX;
+    DoubleDouble stepY;
+} DoubleDoubleGrid;
+
+/**
+ * La aritmética más barata cuya resolución alcanza para el view: se compara
+ * la separación entre píxeles vecinos con el ulp de las coordenadas en cada
+ * precisión, dejando margen para el error que acumula la órbita. Nunca elige
+ * float, que cambia las cuentas de los píxeles del borde respecto de double
+ * (con fórmulas que no son z*z + c, incluso en views anchos y con pocas
+ * iteraciones): float sólo se usa si se pide con --precision=float.
+ */
+EscapePrecision requiredEscapePrecision(const DeepZoomView *view, int width, int height, int maxIter);
+
+/** Nombre legible de la precisión (para el log). */
+const char *escapePrecisionName(EscapePrecision precision);
+
+/** El double-double más cercano al valor (hi es el double más cercano y lo, el resto). */
+DoubleDouble fixedToDoubleDouble(FixedPoint value);
+
+/** Origen y separación de los píxeles del view, calculados en punto fijo. */
+DoubleDoubleGrid loadDoubleDoubleGrid(const DeepZoomView *view, int width, int height);
+
+#endif
@@ -0,0 +1,1208 @@
+#include "EscapeRenderer.h"
+#include "Complex.h"
+#include "EscapeBytecode.h"
+#include "EscapeCache.h"
+#include "EscapeDeepZoom.h"
+#include "EscapeJit.h"
+#include "EscapeKernels.h"
+#include "EscapePrecision.h"
+#include "EscapeSimd.h"
+#include "EscapeSymmetry.h"
+#include "Palette.h"
+#include <math.h>
+#include <string.h>
+
+/* Lado (en píxeles) de los tiles que se reparten entre los workers. */
+#define ESCAPE_TILE_SIZE 32
+
+/* Con la subdivisión, los rectángulos de menos de este lado se iteran enteros. */
+#define ESCAPE_SUBDIVISION_MIN_SIZE 4
+
+/* Lado máximo de la grilla de muestras de un píxel de borde. */
+#define ESCAPE_SUPERSAMPLING_MAX 16
+
+/* Render progresivo: la primera pasada itera un píxel de cada tantos por eje (divide a ESCAPE_TILE_SIZE). */
+#define ESCAPE_PROGRESSIVE_STEP 16
+
+static Logger *_logger = NULL;
+
+/**
+ * Trabajo compartido por todos los workers de un escape. Sólo nextTile se
+ * modifica durante el render, y siempre de forma atómica.
+ */
+typedef struct
+{
+    Escape *escape;
+    RenderContext *ctx;
+    EscapeKernel kernel;
+    EscapeProgram *program;
+    /* El loop del programa compilado a código nativo, o NULL. */
+    EscapeJit *jit;
+    /* Lanes del motor vectorial, o 0 para iterar de a un píxel. */
+    int lanes;
+    /* Float (sólo con SIMD), double o double-double (sólo con bytecode). */
+    EscapePrecision precision;
+    /* Coordenadas de los píxeles, para double-double. */
+    DoubleDoubleGrid grid;
+    /* Detección de ciclos de Brent en el evaluador del árbol. */
+    int periodicity;
+    /* Mariani-Silver: sólo se iteran los bordes de cada rectángulo. */
+    int subdivision;
+    /* Lado de la grilla de muestras de los píxeles de borde, o 0 sin supersampling. */
+    int supersampling;
+    /* Iteraciones de cada píxel (con supersampling, para buscar los bordes, y para el cache). */
+    int *counts;
+    /* Parte fraccionaria de las iteraciones de cada píxel (cache con coloreo suave). */
+    float *fractions;
+    /* Colores de "color:" por iteración, armados una vez por escape. */
+    Palette *palette;
+    /* Coloreo suave: los iteradores devuelven el |z|^2 con el que escapó cada píxel. */
+    int smooth;
+    /* 0 mientras se itera una muestra por píxel, 1 mientras se supersamplean los bordes. */
+    int phase;
+    /* Render progresivo: paso de la grilla de la pasada actual, o 0 para iterar todo de una vez. */
+    int step;
+    /* Espejo de la imagen; sólo se itera [left, right) x [top, bottom) y el resto se copia. */
+    EscapeSymmetry symmetry;
+    int left;
+    int top;
+    int right;
+    int bottom;
+    int maxIter;
+    int tilesX;
+    int tileCount;
+    int nextTile;
+    /* Estadísticas de la subdivisión y del supersampling, acumuladas de forma atómica. */
+    long iterated;
+    long filled;
+    long edges;
+} EscapeJob;
+
+/** Estado privado de cada worker. */
+typedef struct
+{
+    EscapeJob *job;
+    RenderContext ctx;
+    Complex registers[ESCAPE_MAX_REGISTERS];
+    DoubleDoubleComplex ddRegisters[ESCAPE_MAX_REGISTERS];
+    double xs[ESCAPE_TILE_SIZE * ESCAPE_TILE_SIZE];
+    double ys[ESCAPE_TILE_SIZE * ESCAPE_TILE_SIZE];
+    int iterations[ESCAPE_TILE_SIZE * ESCAPE_TILE_SIZE];
+    double norms[ESCAPE_TILE_SIZE * ESCAPE_TILE_SIZE];
+    /* Subdivisión: iteraciones de cada píxel del tile (-1 si falta calcularla). */
+    int cells[ESCAPE_TILE_SIZE * ESCAPE_TILE_SIZE];
+    double cellNorms[ESCAPE_TILE_SIZE * ESCAPE_TILE_SIZE];
+    int pending[ESCAPE_TILE_SIZE * ESCAPE_TILE_SIZE];
+    int pendingCount;
+    int tileX;
+    int tileY;
+    long iterated;
+    long filled;
+    long edges;
+} EscapeWorker;
+
+void _shutdownEscapeRendererModule()
+{
+    if (_logger != NULL)
+    {
+        destroyLogger(_logger);
+        _logger = NULL;
+    }
+}
+
+ModuleDestructor initializeEscapeRendererModule()
+{
+    _logger = createLogger("EscapeRenderer");
+    return _shutdownEscapeRendererModule;
+}
+
+static Complex evaluateEscapeExpression(EscapeExpression *expr,
+                                        RenderContext *ctx,
+                                        Escape *escape,
+                                        Complex currentZ);
+
+static Complex evaluateEscapeFactor(EscapeFactor *factor,
+                                    RenderContext *ctx,
+                                    Escape *escape,
+                                    Complex currentZ)
+{
+    if (!factor)
+        return makeComplex(0.0, 0.0);
+
+    switch (factor->type)
+    {
+    case CONSTANT:
+        return makeComplex((double)factor->constant->value, 0.0);
+
+    case DOUBLE_CONSTANT:
+        return makeComplex(factor->doubleConstant->value, 0.0);
+
+    case VARIABLE:
+        /* Si es la variable del escape (ej: "z"), devolvemos el z actual */
+        if (escape && escape->variable &&
+            strcmp(factor->variable->name, escape->variable->name) == 0)
+        {
+            return currentZ;
+        }
+        else
+        {
+            double v = getVariableValue(ctx, factor->variable);
+            return makeComplex(v, 0.0);
+        }
+
+    case EXPRESSION:
+        return evaluateEscapeExpression(factor->expression, ctx, escape, currentZ);
+
+    case X_COORD_FACTOR:
+        return makeComplex(ctx->currentPixelX, 0.0);
+
+    case Y_COORD_FACTOR:
+        return makeComplex(ctx->currentPixelY, 0.0);
+
+    case RANGE:
+        /* [expr1, expr2] => expr1 + i*expr2 */
+        if (factor->range)
+        {
+            Complex a = evaluateEscapeExpression(factor->range->start, ctx, escape, currentZ);
+            Complex b = evaluateEscapeExpression(factor->range->end, ctx, escape, currentZ);
+            return makeComplex(a.re, b.re);
+        }
+        return makeComplex(0.0, 0.0);
+
+    default:
+        return makeComplex(0.0, 0.0);
+    }
+}
+
+static Complex evaluateEscapeExpression(EscapeExpression *expr,
+                                        RenderContext *ctx,
+                                        Escape *escape,
+                                        Complex currentZ)
+{
+    if (!expr)
+        return makeComplex(0.0, 0.0);
+
+    if (expr->type == FACTOR)
+    {
+        return evaluateEscapeFactor(expr->factor, ctx, escape, currentZ);
+    }
+
+    if (expr->type == ABSOLUTE_VALUE)
+    {
+        Complex inner = evaluateEscapeExpression(expr->leftExpression, ctx, escape, currentZ);
+        double mag = complexAbs(inner);
+        return makeComplex(mag, 0.0);
+    }
+
+    Complex left = evaluateEscapeExpression(expr->leftExpression, ctx, escape, currentZ);
+    Complex right = evaluateEscapeExpression(expr->rightExpression, ctx, escape, currentZ);
+
+    switch (expr->type)
+    {
+    case ADDITION:
+        return complexAdd(left, right);
+    case SUBTRACTION:
+        return complexSub(left, right);
+    case MULTIPLICATION:
+        return complexMul(left, right);
+    case DIVISION:
+        return complexDiv(left, right);
+
+    case LOWER_THAN_OP:
+    {
+        double r = (left.re < right.re) ? 1.0 : 0.0;
+        return makeComplex(r, 0.0);
+    }
+    case GREATER_THAN_OP:
+    {
+        double r = (left.re > right.re) ? 1.0 : 0.0;
+        return makeComplex(r, 0.0);
+    }
+
+    default:
+        return makeComplex(0.0, 0.0);
+    }
+}
+
+/* Las coordenadas de píxel pueden ser fraccionarias (las muestras del supersampling). */
+static inline double pixelX(const RenderContext *ctx, double px)
+{
+    return ctx->minX + (px * (ctx->maxX - ctx->minX) / (double)ctx->width);
+}
+
+static inline double pixelY(const RenderContext *ctx, double py)
+{
+    return ctx->minY + (py * (ctx->maxY - ctx->minY) / (double)ctx->height);
+}
+
+/**
+ * Itera la fórmula de escape para el píxel (px, py) y devuelve la cantidad de
+ * iteraciones realizadas (maxIter si el punto no escapó). Con el kernel nativo
+ * deja en *norm el |z|^2 con el que escapó.
+ */
+static int escapeIterations(EscapeWorker *worker, double px, double py, double *norm)
+{
+    Escape *escape = worker->job->escape;
+    RenderContext *ctx = &worker->ctx;
+    int maxIter = worker->job->maxIter;
+
+    if (worker->job->precision == ESCAPE_PRECISION_DOUBLE_DOUBLE)
+    {
+        const DoubleDoubleGrid *grid = &worker->job->grid;
+        return iterateEscapeProgramDoubleDouble(worker->job->program, worker->ddRegisters,
+                                                ddAdd(grid->minX, ddMulDouble(grid->stepX, px)),
+                                                ddAdd(grid->minY, ddMulDouble(grid->stepY, py)), maxIter);
+    }
+
+    double x0 = pixelX(ctx, px);
+    double y0 = pixelY(ctx, py);
+
+    if (worker->job->kernel.type != ESCAPE_KERNEL_NONE)
+    {
+        return iterateEscapeKernel(&worker->job->kernel, x0, y0, maxIter, norm);
+    }
+    if (worker->job->jit)
+    {
+        return iterateEscapeJit(worker->job->jit, worker->job->program, worker->registers, x0, y0, maxIter);
+    }
+    if (worker->job->program)
+    {
+        return iterateEscapeProgram(worker->job->program, worker->registers, x0, y0, maxIter);
+    }
+
+    ctx->currentPixelX = x0;
+    ctx->currentPixelY = y0;
+
+    Complex z = makeComplex(0.0, 0.0);
+    if (escape->initialValue)
+    {
+        z = evaluateEscapeExpression(escape->initialValue, ctx, escape, z);
+    }
+
+    Complex check = z;
+    int steps = 0;
+    int power = 1;
+    int iter = 0;
+    while (iter < maxIter)
+    {
+
+        if (escape->untilCondition)
+        {
+            Complex cond = evaluateEscapeExpression(escape->untilCondition, ctx, escape, z);
+            if (cond.re != 0.0)
+            {
+                break;
+            }
+        }
+
+        if (!escape->recursiveAssigment)
+        {
+            break;
+        }
+
+        z = evaluateEscapeExpression(escape->recursiveAssigment, ctx, escape, z);
+        iter++;
+
+        if (worker->job->periodicity)
+        {
+            if (complexSameBits(z, check))
+                return maxIter;
+            if (++steps == power)
+            {
+                check = z;
+                steps = 0;
+                power <<= 1;
+            }
+        }
+    }
+    return iter;
+}
+
+static inline RGBColor escapeColor(const EscapeJob *job, int iter, double norm)
+{
+    if (job->smooth)
+        return paletteSmoothColor(job->palette, iter, norm);
+    return paletteColor(job->palette, iter);
+}
+
+/* Pinta un píxel y guarda sus iteraciones, si hacen falta para los bordes o el cache. */
+static void storePixel(EscapeWorker *worker, int px, int py, int iter, double norm)
+{
+    RenderContext *ctx = &worker->ctx;
+    EscapeJob *job = worker->job;
+    size_t index = (size_t)py * ctx->width + px;
+    if (job->smooth && iter < job->maxIter)
+    {
+        double nu = paletteSmoothIteration(job->palette, iter, norm);
+        setPixel(ctx->bmp, px, py, paletteIterationColor(job->palette, nu));
+        if (job->fractions)
+            job->fractions[index] = (float)(nu - iter);
+    }
+    else
+    {
+        setPixel(ctx->bmp, px, py, paletteColor(job->palette, iter));
+        if (job->fractions)
+            job->fractions[index] = 0.0f;
+    }
+    if (job->counts)
+        job->counts[index] = iter;
+}
+
+/* Itera con SIMD los "count" píxeles cargados en xs e ys del worker. */
+static void iterateLanes(EscapeWorker *worker, int count)
+{
+    EscapeJob *job = worker->job;
+    double *norms = job->smooth ? worker->norms : NULL;
+    if (job->precision == ESCAPE_PRECISION_FLOAT)
+        iterateEscapeSimdFloat(job->lanes, &job->kernel, job->program, worker->xs, worker->ys, count, job->maxIter,
+                               worker->iterations, norms);
+    else if (job->jit && job->jit->iterateLanes)
+        iterateEscapeJitLanes(job->jit, job->program, worker->xs, worker->ys, count, job->maxIter, worker->iterations);
+    else
+        iterateEscapeSimd(job->lanes, &job->kernel, job->program, worker->xs, worker->ys, count, job->maxIter,
+                          worker->iterations, norms);
+}
+
+/* Encola un píxel del tile para calcularlo, si todavía no se calculó. */
+static void queueCell(EscapeWorker *worker, int lx, int ly)
+{
+    int cell = ly * ESCAPE_TILE_SIZE + lx;
+    if (worker->cells[cell] != -1)
+        return;
+    worker->cells[cell] = -2;
+    worker->pending[worker->pendingCount++] = cell;
+}
+
+/* Itera los píxeles encolados, con SIMD si está disponible. */
+static void resolveCells(EscapeWorker *worker)
+{
+    RenderContext *ctx = &worker->ctx;
+    int count = worker->pendingCount;
+    if (worker->job->lanes > 0)
+    {
+        for (int k = 0; k < count; k++)
+        {
+            worker->xs[k] = pixelX(ctx, worker->tileX + worker->pending[k] % ESCAPE_TILE_SIZE);
+            worker->ys[k] = pixelY(ctx, worker->tileY + worker->pending[k] / ESCAPE_TILE_SIZE);
+        }
+        iterateLanes(worker, count);
+        for (int k = 0; k < count; k++)
+        {
+            worker->cells[worker->pending[k]] = worker->iterations[k];
+            worker->cellNorms[worker->pending[k]] = worker->norms[k];
+        }
+    }
+    else
+    {
+        for (int k = 0; k < count; k++)
+        {
+            int cell = worker->pending[k];
+            worker->cells[cell] = escapeIterations(worker, worker->tileX + cell % ESCAPE_TILE_SIZE,
+                                                   worker->tileY + cell / ESCAPE_TILE_SIZE, &worker->cellNorms[cell]);
+        }
+    }
+    worker->iterated += count;
+    worker->pendingCount = 0;
+}
+
+/*
+ * Antes de rellenar, subdivideCells itera también la fila y la columna del
+ * medio del interior, y sólo rellena si tienen las mismas iteraciones que el
+ * borde: atrapa las islas y los filamentos que cruzan el rectángulo sin tocar
+ * el borde, a un costo proporcional al perímetro y no al área.
+ */
+static int crossUniform(EscapeWorker *worker, int x0, int y0, int x1, int y1, int value)
+{
+    int middleX = (x0 + x1) / 2, middleY = (y0 + y1) / 2;
+    for (int x = x0 + 1; x < x1; x++)
+        queueCell(worker, x, middleY);
+    for (int y = y0 + 1; y < y1; y++)
+        queueCell(worker, middleX, y);
+    resolveCells(worker);
+    int *cells = worker->cells;
+    for (int x = x0 + 1; x < x1; x++)
+        if (cells[middleY * ESCAPE_TILE_SIZE + x] != value)
+            return 0;
+    for (int y = y0 + 1; y < y1; y++)
+        if (cells[y * ESCAPE_TILE_SIZE + middleX] != value)
+            return 0;
+    return 1;
+}
+
+/*
+ * Mariani-Silver sobre el rectángulo [x0, x1] x [y0, y1] (coordenadas del
+ * tile, bordes incluidos). Se calcula el borde; si todo el borde (y la cruz
+ * del medio, ver crossUniform) tiene las mismas iteraciones, el interior se
+ * rellena con ese valor. Si no, se parte al medio por el lado más largo (la
+ * línea de corte es borde de las dos mitades y se calcula una sola vez) y se
+ * repite. El resultado es aproximado: un detalle que no toca ningún píxel
+ * muestreado queda tapado por el relleno, y eso pasa incluso con conjuntos
+ * conexos como el de Mandelbrot, a la resolución de un píxel. Con coloreo suave
+ * los píxeles de una misma banda tienen colores distintos, así que sólo se
+ * rellena el interior (maxIter).
+ */
+static void subdivideCells(EscapeWorker *worker, int x0, int y0, int x1, int y1)
+{
+    for (int x = x0; x <= x1; x++)
+    {
+        queueCell(worker, x, y0);
+        queueCell(worker, x, y1);
+    }
+    for (int y = y0 + 1; y < y1; y++)
+    {
+        queueCell(worker, x0, y);
+        queueCell(worker, x1, y);
+    }
+    resolveCells(worker);
+    if (x1 - x0 < 2 || y1 - y0 < 2)
+        return;
+
+    int *cells = worker->cells;
+    int first = cells[y0 * ESCAPE_TILE_SIZE + x0];
+    int uniform = 1;
+    for (int x = x0; x <= x1 && uniform; x++)
+        uniform = cells[y0 * ESCAPE_TILE_SIZE + x] == first && cells[y1 * ESCAPE_TILE_SIZE + x] == first;
+    for (int y = y0 + 1; y < y1 && uniform; y++)
+        uniform = cells[y * ESCAPE_TILE_SIZE + x0] == first && cells[y * ESCAPE_TILE_SIZE + x1] == first;
+
+    if (uniform && (!worker->job->smooth || first == worker->job->maxIter))
+        uniform = crossUniform(worker, x0, y0, x1, y1, first);
+    if (uniform && (!worker->job->smooth || first == worker->job->maxIter))
+    {
+        for (int y = y0 + 1; y < y1; y++)
+            for (int x = x0 + 1; x < x1; x++)
+                cells[y * ESCAPE_TILE_SIZE + x] = first;
+        worker->filled += (long)(x1 - x0 - 1) * (y1 - y0 - 1);
+    }
+    else if (x1 - x0 < ESCAPE_SUBDIVISION_MIN_SIZE || y1 - y0 < ESCAPE_SUBDIVISION_MIN_SIZE)
+    {
+        for (int y = y0 + 1; y < y1; y++)
+            for (int x = x0 + 1; x < x1; x++)
+                queueCell(worker, x, y);
+        resolveCells(worker);
+    }
+    else if (x1 - x0 >= y1 - y0)
+    {
+        int middle = (x0 + x1) / 2;
+        subdivideCells(worker, x0, y0, middle, y1);
+        subdivideCells(worker, middle, y0, x1, y1);
+    }
+    else
+    {
+        int middle = (y0 + y1) / 2;
+        subdivideCells(worker, x0, y0, x1, middle);
+        subdivideCells(worker, x0, middle, x1, y1);
+    }
+}
+
+static void renderTileSubdivided(EscapeWorker *worker, int x0, int y0, int x1, int y1)
+{
+    worker->tileX = x0;
+    worker->tileY = y0;
+    worker->pendingCount = 0;
+    for (int k = 0; k < ESCAPE_TILE_SIZE * ESCAPE_TILE_SIZE; k++)
+        worker->cells[k] = -1;
+
+    subdivideCells(worker, 0, 0, x1 - x0 - 1, y1 - y0 - 1);
+
+    for (int py = y0; py < y1; py++)
+    {
+        for (int px = x0; px < x1; px++)
+        {
+            int cell = (py - y0) * ESCAPE_TILE_SIZE + (px - x0);
+            storePixel(worker, px, py, worker->cells[cell], worker->cellNorms[cell]);
+        }
+    }
+}
+
+/* Rectángulo [x0, x1) x [y0, y1) del tile, en una grilla de tiles de lado "side" sobre la zona que se itera. */
+static void tileBounds(const EscapeJob *job, int tile, int side, int *x0, int *y0, int *x1, int *y1)
+{
+    *x0 = job->left + (tile % job->tilesX) * side;
+    *y0 = job->top + (tile / job->tilesX) * side;
+    *x1 = *x0 + side < job->right ? *x0 + side : job->right;
+    *y1 = *y0 + side < job->bottom ? *y0 + side : job->bottom;
+}
+
+/*
+ * Una pasada del render progresivo: se itera la grilla de paso job->step,
+ * salvo los píxeles que ya calculó la pasada anterior (los de la grilla del
+ * doble de paso), y cada uno se pinta como un bloque de step x step que las
+ * pasadas siguientes van reemplazando. Los tiles de la pasada miden
+ * ESCAPE_TILE_SIZE * step, así que siempre tienen a lo sumo
+ * ESCAPE_TILE_SIZE x ESCAPE_TILE_SIZE píxeles para iterar.
+ */
+static void renderTilePass(EscapeWorker *worker, int tile)
+{
+    RenderContext *ctx = &worker->ctx;
+    EscapeJob *job = worker->job;
+    int step = job->step;
+    int x0, y0, x1, y1;
+    tileBounds(job, tile, ESCAPE_TILE_SIZE * step, &x0, &y0, &x1, &y1);
+    int coarse = step < ESCAPE_PROGRESSIVE_STEP ? 2 * step : 0;
+    int count = 0;
+    for (int py = y0; py < y1; py += step)
+    {
+        for (int px = x0; px < x1; px += step)
+        {
+            if (coarse && (px - job->left) % coarse == 0 && (py - job->top) % coarse == 0)
+                continue;
+            if (job->lanes > 0)
+            {
+                worker->xs[count] = pixelX(ctx, px);
+                worker->ys[count] = pixelY(ctx, py);
+            }
+            else
+            {
+                worker->iterations[count] = escapeIterations(worker, px, py, &worker->norms[count]);
+            }
+            worker->pending[count++] = ((py - y0) / step) * ESCAPE_TILE_SIZE + (px - x0) / step;
+        }
+    }
+    if (job->lanes > 0)
+        iterateLanes(worker, count);
+
+    for (int k = 0; k < count; k++)
+    {
+        int px = x0 + (worker->pending[k] % ESCAPE_TILE_SIZE) * step;
+        int py = y0 + (worker->pending[k] / ESCAPE_TILE_SIZE) * step;
+        storePixel(worker, px, py, worker->iterations[k], worker->norms[k]);
+        if (step == 1)
+            continue;
+        RGBColor *pixels = ctx->bmp->pixels;
+        RGBColor color = pixels[(size_t)py * ctx->width + px];
+        int width = px + step < x1 ? step : x1 - px;
+        for (int y = py; y < py + step && y < y1; y++)
+        {
+            RGBColor *row = pixels + (size_t)y * ctx->width + px;
+            for (int x = 0; x < width; x++)
+                row[x] = color;
+        }
+    }
+    worker->iterated += count;
+}
+
+static void renderTile(EscapeWorker *worker, int tile)
+{
+    RenderContext *ctx = &worker->ctx;
+    int x0, y0, x1, y1;
+    tileBounds(worker->job, tile, ESCAPE_TILE_SIZE, &x0, &y0, &x1, &y1);
+
+    if (worker->job->step > 0)
+    {
+        renderTilePass(worker, tile);
+        return;
+    }
+    if (worker->job->subdivision)
+    {
+        renderTileSubdivided(worker, x0, y0, x1, y1);
+        return;
+    }
+    if (worker->job->lanes > 0)
+    {
+        int count = 0;
+        for (int py = y0; py < y1; py++)
+        {
+            for (int px = x0; px < x1; px++)
+            {
+                worker->xs[count] = pixelX(ctx, px);
+                worker->ys[count] = pixelY(ctx, py);
+                count++;
+            }
+        }
+        iterateLanes(worker, count);
+        count = 0;
+        for (int py = y0; py < y1; py++)
+        {
+            for (int px = x0; px < x1; px++)
+            {
+                storePixel(worker, px, py, worker->iterations[count], worker->norms[count]);
+                count++;
+            }
+        }
+        return;
+    }
+
+    for (int py = y0; py < y1; py++)
+    {
+        for (int px = x0; px < x1; px++)
+        {
+            double norm = 0.0;
+            int iter = escapeIterations(worker, px, py, &norm);
+            storePixel(worker, px, py, iter, norm);
+        }
+    }
+}
+
+/* Si las iteraciones del píxel difieren de las de alguno de sus 8 vecinos. */
+static int isEdgePixel(const EscapeJob *job, int px, int py)
+{
+    const RenderContext *ctx = job->ctx;
+    int iter = job->counts[py * ctx->width + px];
+    for (int y = py - 1; y <= py + 1; y++)
+    {
+        for (int x = px - 1; x <= px + 1; x++)
+        {
+            if (x >= 0 && y >= 0 && x < ctx->width && y < ctx->height && job->counts[y * ctx->width + x] != iter)
+                return 1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Itera una grilla de n x n muestras alrededor de cada uno de los "count"
+ * píxeles de worker->pending (índices de la imagen) y pinta cada píxel con el
+ * promedio de los colores de sus muestras. La muestra original queda en el
+ * centro de la grilla, así que con n impar se vuelve a calcular.
+ */
+static void supersamplePixels(EscapeWorker *worker, int count)
+{
+    RenderContext *ctx = &worker->ctx;
+    EscapeJob *job = worker->job;
+    int n = job->supersampling;
+    int samples = n * n;
+    int total = 0;
+    for (int k = 0; k < count; k++)
+    {
+        int px = worker->pending[k] % ctx->width;
+        int py = worker->pending[k] / ctx->width;
+        for (int j = 0; j < n; j++)
+        {
+            for (int i = 0; i < n; i++)
+            {
+                double sx = px + (i + 0.5) / n - 0.5;
+                double sy = py + (j + 0.5) / n - 0.5;
+                if (job->lanes > 0)
+                {
+                    worker->xs[total] = pixelX(ctx, sx);
+                    worker->ys[total] = pixelY(ctx, sy);
+                }
+                else
+                {
+                    worker->iterations[total] = escapeIterations(worker, sx, sy, &worker->norms[total]);
+                }
+                total++;
+            }
+        }
+    }
+    if (job->lanes > 0)
+        iterateLanes(worker, total);
+
+    for (int k = 0; k < count; k++)
+    {
+        int r = 0, g = 0, b = 0;
+        for (int m = 0; m < samples; m++)
+        {
+            RGBColor color = escapeColor(job, worker->iterations[k * samples + m], worker->norms[k * samples + m]);
+            r += color.r;
+            g += color.g;
+            b += color.b;
+        }
+        RGBColor average;
+        average.r = (uint8_t)((r + samples / 2) / samples);
+        average.g = (uint8_t)((g + samples / 2) / samples);
+        average.b = (uint8_t)((b + samples / 2) / samples);
+        setPixel(ctx->bmp, worker->pending[k] % ctx->width, worker->pending[k] / ctx->width, average);
+    }
+    worker->iterated += total;
+    worker->edges += count;
+}
+
+/* Supersamplea los píxeles de borde del tile, de a tantos como entren en los buffers del worker. */
+static void supersampleTile(EscapeWorker *worker, int tile)
+{
+    RenderContext *ctx = &worker->ctx;
+    EscapeJob *job = worker->job;
+    int x0, y0, x1, y1;
+    tileBounds(job, tile, ESCAPE_TILE_SIZE, &x0, &y0, &x1, &y1);
+    int capacity = (ESCAPE_TILE_SIZE * ESCAPE_TILE_SIZE) / (job->supersampling * job->supersampling);
+    int count = 0;
+    for (int py = y0; py < y1; py++)
+    {
+        for (int px = x0; px < x1; px++)
+        {
+            if (!isEdgePixel(job, px, py))
+                continue;
+            worker->pending[count++] = py * ctx->width + px;
+            if (count == capacity)
+            {
+                supersamplePixels(worker, count);
+                count = 0;
+            }
+        }
+    }
+    if (count > 0)
+        supersamplePixels(worker, count);
+}
+
+static void *escapeWorkerMain(void *argument)
+{
+    EscapeWorker *worker = argument;
+    EscapeJob *job = worker->job;
+    int tile;
+    while ((tile = __atomic_fetch_add(&job->nextTile, 1, __ATOMIC_RELAXED)) < job->tileCount)
+    {
+        if (job->phase == 0)
+            renderTile(worker, tile);
+        else
+            supersampleTile(worker, tile);
+    }
+    __atomic_fetch_add(&job->iterated, worker->iterated, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&job->filled, worker->filled, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&job->edges, worker->edges, __ATOMIC_RELAXED);
+    worker->iterated = 0;
+    worker->filled = 0;
+    worker->edges = 0;
+    return NULL;
+}
+
+/*
+ * Reparte los tiles de la fase actual entre los workers (el thread llamador
+ * es el worker 0) y después copia la parte reflejada de la imagen.
+ */
+static void runEscapeWorkers(EscapeJob *job, EscapeWorker *workers, int threads)
+{
+    job->nextTile = 0;
+    runRenderThreads(escapeWorkerMain, workers, sizeof(EscapeWorker), threads);
+    mirrorEscape(&job->symmetry, job->ctx, job->counts, job->fractions);
+}
+
+static int resolveThreadCount(const RenderOptions *options, int tileCount)
+{
+    int threads = renderThreadCount(options);
+    if (threads > tileCount)
+        threads = tileCount;
+    return threads < 1 ? 1 : threads;
+}
+
+/*
+ * Render progresivo: pasadas de paso ESCAPE_PROGRESSIVE_STEP, la mitad, ...,
+ * hasta 1, escribiendo una vista previa después de cada una salvo la última
+ * (la imagen final la guarda el intérprete). Devuelve 0 si el presupuesto de
+ * tiempo cortó el refinamiento antes de la última pasada.
+ */
+static int renderProgressive(EscapeJob *job, EscapeWorker *workers, int threads)
+{
+    RenderContext *ctx = job->ctx;
+    int tilesX = job->tilesX;
+    int tileCount = job->tileCount;
+    int complete = 1;
+    for (job->step = ESCAPE_PROGRESSIVE_STEP; job->step > 1; job->step /= 2)
+    {
+        int side = ESCAPE_TILE_SIZE * job->step;
+        job->tilesX = (job->right - job->left + side - 1) / side;
+        job->tileCount = job->tilesX * ((job->bottom - job->top + side - 1) / side);
+        runEscapeWorkers(job, workers, threads);
+        flushRenderPreview(ctx);
+        logDebugging(_logger, "Vista previa de la pasada 1/%d a los %.0f ms.", job->step,
+                     renderClock() - ctx->startTime);
+        if (renderBudgetSpent(ctx))
+        {
+            logInformation(_logger, "Presupuesto de tiempo agotado: el escape queda en la pasada 1/%d.", job->step);
+            complete = 0;
+            break;
+        }
+    }
+    job->tilesX = tilesX;
+    job->tileCount = tileCount;
+    if (complete)
+        runEscapeWorkers(job, workers, threads);
+    job->step = 0;
+    return complete;
+}
+
+/*
+ * Colorea la imagen con las iteraciones que guardó una corrida anterior, sin
+ * iterar. El archivo viene del disco y puede estar viejo, cortado o ser de
+ * otra clave con el mismo hash: si alguna cuenta pasa de maxIter, o alguna
+ * fracción no es finita, no se toca el bitmap y devuelve 0, como si no
+ * estuviera.
+ */
+static int recolorEscape(EscapeJob *job, const EscapeCache *cache)
+{
+    RenderContext *ctx = job->ctx;
+    size_t pixels = (size_t)ctx->width * ctx->height;
+    for (size_t k = 0; k < pixels; k++)
+    {
+        if (cache->counts[k] > (uint32_t)job->maxIter || (cache->fractions && !isfinite(cache->fractions[k])))
+            return 0;
+    }
+
+    int smooth = cache->fractions && enableSmoothPalette(job->palette, job->kernel.threshold);
+    for (int py = 0; py < ctx->height; py++)
+    {
+        const uint32_t *counts = cache->counts + (size_t)py * ctx->width;
+        for (int px = 0; px < ctx->width; px++)
+        {
+            int iter = (int)counts[px];
+            if (smooth && iter < job->maxIter)
+                setPixel(ctx->bmp, px, py,
+                         paletteIterationColor(job->palette, iter + cache->fractions[(size_t)py * ctx->width + px]));
+            else
+                setPixel(ctx->bmp, px, py, paletteColor(job->palette, iter));
+        }
+    }
+    return 1;
+}
+
+/* Guarda las iteraciones de todos los píxeles para volver a colorearlas sin iterar. */
+static void saveIterations(EscapeJob *job, uint64_t key, const int *counts, const float *fractions)
+{
+    RenderContext *ctx = job->ctx;
+    char *path = escapeCachePath(ctx, key);
+    if (saveEscapeCache(path, key, ctx->width, ctx->height, job->maxIter, counts, fractions))
+        logDebugging(_logger, "Iteraciones guardadas en %s.", path);
+    else
+        logWarning(_logger, "No se pudieron guardar las iteraciones en %s.", path);
+    free(path);
+}
+
+/*
+ * Render por perturbación, para views más angostos que la precisión de double.
+ * Itera toda la imagen de una vez (las referencias se comparten entre tiles).
+ */
+static void renderDeepZoom(EscapeJob *job, const DeepZoomView *view, int cache, uint64_t key)
+{
+    RenderContext *ctx = job->ctx;
+    int *iterations = malloc((size_t)ctx->width * ctx->height * sizeof(int));
+    int threads = resolveThreadCount(ctx->options, ctx->width * ctx->height);
+    DeepZoomStats stats = iterateDeepZoom(&job->kernel, view, ctx->width, ctx->height, job->maxIter, threads,
+                                          iterations);
+    for (int py = 0; py < ctx->height; py++)
+    {
+        for (int px = 0; px < ctx->width; px++)
+        {
+            setPixel(ctx->bmp, px, py, paletteColor(job->palette, iterations[py * ctx->width + px]));
+        }
+    }
+    if (cache)
+        saveIterations(job, key, iterations, NULL);
+    free(iterations);
+    logInformation(_logger, "Zoom profundo: %d referencias, %d iteraciones salteadas con la serie, %ld píxeles re-iterados por glitch.",
+                   stats.references, stats.skipped, stats.glitches);
+    if (stats.unresolved > 0)
+    {
+        logWarning(_logger, "Quedaron %ld píxeles con glitch al agotar las referencias.", stats.unresolved);
+    }
+}
+
+void executeEscape(Escape *escape, RenderContext *ctx)
+{
+    if (!escape)
+        return;
+
+    EscapeJob job;
+    job.escape = escape;
+    job.ctx = ctx;
+    job.maxIter = 1000;
+    if (escape->maxIterations)
+    {
+        job.maxIter = escape->maxIterations->value;
+    }
+    job.nextTile = 0;
+    job.iterated = 0;
+    job.filled = 0;
+    job.edges = 0;
+    job.counts = NULL;
+    job.fractions = NULL;
+    job.step = 0;
+    job.symmetry.axis = ESCAPE_SYMMETRY_NONE;
+    job.subdivision = ctx->options && ctx->options->subdivision;
+    job.kernel = matchEscapeKernel(escape, ctx);
+    job.program = NULL;
+    job.jit = NULL;
+    job.palette = createPalette(ctx, job.maxIter);
+    job.smooth = 0;
+
+    /* Las muestras del supersampling no se guardan: con él, el cache no alcanza para recolorear. */
+    int cache = ctx->options && ctx->options->iterationCache && ctx->options->supersampling <= 1;
+    uint64_t key = 0;
+    if (cache)
+    {
+        key = escapeCacheKey(escape, ctx, job.maxIter);
+        char *path = escapeCachePath(ctx, key);
+        EscapeCache saved;
+        int found = openEscapeCache(path, key, ctx->width, ctx->height, job.maxIter, &saved);
+        if (found)
+        {
+            found = recolorEscape(&job, &saved);
+            closeEscapeCache(&saved);
+            if (found)
+                logInformation(_logger, "Escape recoloreado con las iteraciones de %s, sin iterar.", path);
+            else
+                logWarning(_logger, "Las iteraciones de %s están fuera de rango: se vuelve a iterar.", path);
+        }
+        free(path);
+        if (found)
+        {
+            destroyPalette(job.palette);
+            return;
+        }
+    }
+    else if (ctx->options && ctx->options->iterationCache)
+    {
+        logWarning(_logger, "El cache de iteraciones no se usa con supersampling.");
+    }
+
+    /*
+     * Más allá de double, z = z*z + c se itera por perturbación aunque
+     * double-double alcance: con la serie saltea la mayor parte de las
+     * iteraciones y resulta varias veces más rápida. Double-double queda para
+     * las fórmulas que la perturbación no admite.
+     */
+    DeepZoomView view = loadDeepZoomView(ctx);
+    RenderPrecision option = ctx->options ? ctx->options->precision : RENDER_PRECISION_AUTO;
+    job.precision = requiredEscapePrecision(&view, ctx->width, ctx->height, job.maxIter);
+    if (option == RENDER_PRECISION_AUTO && job.precision >= ESCAPE_PRECISION_DOUBLE_DOUBLE)
+    {
+        if ((!ctx->options || ctx->options->deepZoom) && supportsDeepZoom(&job.kernel))
+        {
+            logInformation(_logger, "El view es más angosto que la precisión de double: se itera por perturbación.");
+            if (ctx->options && ctx->options->supersampling > 1)
+            {
+                logWarning(_logger, "El supersampling no se aplica a los renders por perturbación.");
+            }
+            if (ctx->options && ctx->options->smooth)
+            {
+                logWarning(_logger, "El coloreo suave no se aplica a los renders por perturbación.");
+            }
+            renderDeepZoom(&job, &view, cache, key);
+            destroyPalette(job.palette);
+            return;
+        }
+        if (job.precision == ESCAPE_PRECISION_PERTURBATION)
+        {
+            logWarning(_logger, "El view es más angosto que la precisión de double-double, pero sólo z = z*z + c (|z| > k, k <= 1024) admite perturbación.");
+            job.precision = ESCAPE_PRECISION_DOUBLE_DOUBLE;
+        }
+    }
+    switch (option)
+    {
+    case RENDER_PRECISION_FLOAT:
+        job.precision = ESCAPE_PRECISION_FLOAT;
+        break;
+    case RENDER_PRECISION_DOUBLE:
+        job.precision = ESCAPE_PRECISION_DOUBLE;
+        break;
+    case RENDER_PRECISION_DOUBLE_DOUBLE:
+        job.precision = ESCAPE_PRECISION_DOUBLE_DOUBLE;
+        break;
+    default:
+        break;
+    }
+
+    if (job.kernel.type != ESCAPE_KERNEL_NONE)
+    {
+        logInformation(_logger, "Escape reconocido como %s (z = z*z + c, |z| > %g): se usa el kernel nativo.",
+                       escapeKernelName(job.kernel.type), job.kernel.bailout);
+    }
+    else if ((job.program = compileEscapeProgram(escape, ctx)) != NULL)
+    {
+        logInformation(_logger, "Escape sin kernel nativo, compilado a bytecode: %d registros, %d instrucciones por píxel y %d por iteración.",
+                       job.program->registerCount, job.program->pixel.length + job.program->initial.length,
+                       job.program->step.length + job.program->until.length);
+    }
+    else
+    {
+        logWarning(_logger, "El escape no entra en %d registros, se usa el evaluador del árbol.", ESCAPE_MAX_REGISTERS);
+    }
+
+    /* Double-double sólo existe en el intérprete de bytecode: los kernels también se compilan. */
+    if (job.precision == ESCAPE_PRECISION_DOUBLE_DOUBLE && !job.program &&
+        (job.kernel.type == ESCAPE_KERNEL_NONE || (job.program = compileEscapeProgram(escape, ctx)) == NULL))
+    {
+        logWarning(_logger, "El evaluador del árbol no admite double-double, se itera en double.");
+        job.precision = ESCAPE_PRECISION_DOUBLE;
+    }
+    if (job.precision == ESCAPE_PRECISION_DOUBLE_DOUBLE)
+    {
+        job.grid = loadDoubleDoubleGrid(&view, ctx->width, ctx->height);
+    }
+
+    /* Las dos salidas tempranas devuelven maxIter, así que el color es el de "max:". */
+    job.periodicity = ctx->options && ctx->options->periodicity;
+    job.kernel.periodicity = job.periodicity;
+    job.kernel.interior = ctx->options && ctx->options->interior && supportsInteriorCheck(&job.kernel);
+    if (job.program)
+        job.program->periodicity = job.periodicity;
+    if (job.program && job.precision != ESCAPE_PRECISION_DOUBLE_DOUBLE && (!ctx->options || ctx->options->jit))
+    {
+        job.jit = compileEscapeJit(job.program);
+        if (job.jit)
+            logInformation(_logger, "Loop del escape compilado a x86-64: %zu bytes de código nativo (%zu en AVX).",
+                           job.jit->code.length, job.jit->laneCode.length);
+        else
+            logWarning(_logger, "No se pudo generar código nativo, se usa el intérprete de bytecode.");
+    }
+    if (job.periodicity)
+    {
+        logInformation(_logger, "Detección de ciclos activada: las órbitas que se repiten se cortan en maxIter.");
+    }
+    if (job.kernel.interior)
+    {
+        logInformation(_logger, "Los píxeles del cardioide principal y del bulbo de período 2 no se iteran.");
+    }
+    else if (ctx->options && ctx->options->interior)
+    {
+        logDebugging(_logger, "El chequeo de interior solo aplica a z = z*z + c con z0 = 0 y |z| > k, k >= 2.");
+    }
+
+    job.lanes = 0;
+    if ((!ctx->options || ctx->options->simd) && (job.kernel.type != ESCAPE_KERNEL_NONE || job.program) &&
+        job.precision != ESCAPE_PRECISION_DOUBLE_DOUBLE)
+    {
+        job.lanes = escapeSimdLanes();
+    }
+    /* Float sólo existe en el motor vectorial, y cuenta las iteraciones de forma exacta hasta 2^24. */
+    if (job.precision == ESCAPE_PRECISION_FLOAT && (job.lanes == 0 || job.maxIter > (1 << 24)))
+    {
+        job.precision = ESCAPE_PRECISION_DOUBLE;
+    }
+    logInformation(_logger, "Iterando en %s.", escapePrecisionName(job.precision));
+    if (job.lanes > 0 && job.precision == ESCAPE_PRECISION_DOUBLE && job.jit && job.jit->iterateLanes)
+    {
+        logDebugging(_logger, "Iterando de a %d píxeles con el loop nativo en AVX.", ESCAPE_JIT_LANES);
+    }
+    else if (job.lanes > 0)
+    {
+        logDebugging(_logger, "Iterando de a %d píxeles con SIMD.",
+                     job.precision == ESCAPE_PRECISION_FLOAT ? 2 * job.lanes : job.lanes);
+    }
+
+    /* La fórmula del coloreo suave es la de z = z*z + c, y sólo los iteradores en float o double devuelven |z|. */
+    if (ctx->options && ctx->options->smooth)
+    {
+        if (job.kernel.type != ESCAPE_KERNEL_NONE && job.precision != ESCAPE_PRECISION_DOUBLE_DOUBLE &&
+            enableSmoothPalette(job.palette, job.kernel.threshold))
+        {
+            job.smooth = 1;
+            logInformation(_logger, "Coloreo suave con %d muestras del gradiente.", job.palette->smoothCount);
+        }
+        else
+        {
+            logDebugging(_logger, "El coloreo suave solo aplica a z = z*z + c con |z| > k, k > 1, iterado en float o double.");
+        }
+    }
+
+    job.supersampling = 0;
+    if (ctx->options && ctx->options->supersampling > 1)
+    {
+        job.supersampling = ctx->options->supersampling < ESCAPE_SUPERSAMPLING_MAX ? ctx->options->supersampling
+                                                                                  : ESCAPE_SUPERSAMPLING_MAX;
+    }
+    if (job.supersampling || cache)
+    {
+        job.counts = malloc((size_t)ctx->width * ctx->height * sizeof(int));
+    }
+    if (cache && job.smooth)
+    {
+        job.fractions = malloc((size_t)ctx->width * ctx->height * sizeof(float));
+    }
+
+    /* Las coordenadas en double-double salen del view en punto fijo, no del view en double que se desplaza. */
+    RenderContext frame = *ctx;
+    job.left = 0;
+    job.top = 0;
+    job.right = ctx->width;
+    job.bottom = ctx->height;
+    if (ctx->options && ctx->options->symmetry && job.precision != ESCAPE_PRECISION_DOUBLE_DOUBLE)
+    {
+        job.symmetry = findEscapeSymmetry(escape, ctx);
+    }
+    if (job.symmetry.axis == ESCAPE_SYMMETRY_COLUMNS)
+    {
+        frame.minX += job.symmetry.shift;
+        frame.maxX += job.symmetry.shift;
+        if (job.symmetry.first == 0)
+            job.left = job.symmetry.last + 1;
+        else
+            job.right = job.symmetry.first;
+    }
+    else if (job.symmetry.axis == ESCAPE_SYMMETRY_ROWS)
+    {
+        frame.minY += job.symmetry.shift;
+        frame.maxY += job.symmetry.shift;
+        if (job.symmetry.first == 0)
+            job.top = job.symmetry.last + 1;
+        else
+            job.bottom = job.symmetry.first;
+    }
+    if (job.symmetry.axis != ESCAPE_SYMMETRY_NONE)
+    {
+        int columns = job.symmetry.axis == ESCAPE_SYMMETRY_COLUMNS;
+        double spacing = columns ? (ctx->maxX - ctx->minX) / ctx->width : (ctx->maxY - ctx->minY) / ctx->height;
+        logInformation(_logger, "Escape simétrico respecto de %s = 0: %s %d a %d se copian en vez de iterarse (view desplazado %.2f píxeles).",
+                       columns ? "x" : "y", columns ? "las columnas" : "las filas", job.symmetry.first,
+                       job.symmetry.last, job.symmetry.shift / spacing);
+    }
+    else if (ctx->options && ctx->options->symmetry)
+    {
+        logDebugging(_logger, "No se encontró una simetría del escape que cruce el view.");
+    }
+    job.tilesX = (job.right - job.left + ESCAPE_TILE_SIZE - 1) / ESCAPE_TILE_SIZE;
+    job.tileCount = job.tilesX * ((job.bottom - job.top + ESCAPE_TILE_SIZE - 1) / ESCAPE_TILE_SIZE);
+
+    int threads = resolveThreadCount(ctx->options, job.tileCount);
+    logDebugging(_logger, "Renderizando escape %dx%d en %d tiles con %d threads.",
+                 ctx->width, ctx->height, job.tileCount, threads);
+
+    EscapeWorker *workers = calloc(threads, sizeof(EscapeWorker));
+    for (int k = 0; k < threads; k++)
+    {
+        workers[k].job = &job;
+        workers[k].ctx = frame;
+        if (job.program)
+        {
+            memcpy(workers[k].registers, job.program->initialRegisters,
+                   job.program->registerCount * sizeof(Complex));
+            loadEscapeRegistersDoubleDouble(job.program, workers[k].ddRegisters);
+        }
+    }
+
+    /* Los bordes se buscan con todas las iteraciones calculadas: un tile necesita los píxeles de sus vecinos. */
+    job.phase = 0;
+    int complete = 1;
+    if (ctx->options && ctx->options->progressive)
+    {
+        if (job.subdivision)
+        {
+            logDebugging(_logger, "La subdivisión no se usa en los renders progresivos.");
+            job.subdivision = 0;
+        }
+        complete = renderProgressive(&job, workers, threads);
+    }
+    else
+    {
+        runEscapeWorkers(&job, workers, threads);
+    }
+    /* Si el presupuesto cortó el render, faltan iteraciones: no hay cache ni bordes que supersamplear. */
+    if (cache && complete)
+    {
+        saveIterations(&job, key, job.counts, job.fractions);
+    }
+    if (job.supersampling && complete)
+    {
+        long sampled = job.iterated;
+        job.phase = 1;
+        runEscapeWorkers(&job, workers, threads);
+        long pixels = (long)ctx->width * ctx->height;
+        logInformation(_logger, "Supersampling: %ld píxeles de borde (%.1f%% de %ld) con %dx%d muestras, %ld iteraciones de píxel extra.",
+                       job.edges, pixels > 0 ? 100.0 * job.edges / pixels : 0.0, pixels, job.supersampling,
+                       job.supersampling, job.iterated - sampled);
+        job.iterated = sampled;
+    }
+    free(job.counts);
+    free(job.fractions);
+    free(workers);
+    destroyEscapeJit(job.jit);
+    destroyEscapeProgram(job.program);
+    destroyPalette(job.palette);
+
+    if (job.subdivision)
+    {
+        long total = job.iterated + job.filled;
+        logInformation(_logger, "Subdivisión: %ld píxeles iterados y %ld rellenados sin iterar (%.1f%% de %ld).",
+                       job.iterated, job.filled, total > 0 ? 100.0 * job.filled / total : 0.0, total);
+    }
+}
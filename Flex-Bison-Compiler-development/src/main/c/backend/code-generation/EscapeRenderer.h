@@ -0,0 +1,19 @@
+#ifndef ESCAPE_RENDERER_HEADER
+#define ESCAPE_RENDERER_HEADER
+
+#include "../../frontend/syntactic-analysis/AbstractSyntaxTree.h"
+#include "../../support/logging/Logger.h"
+#include "../../support/type/ModuleDestructor.h"
+#include "RenderContext.h"
+
+/** Inicializa el módulo */
+ModuleDestructor initializeEscapeRendererModule();
+
+/**
+ * Renderiza una sentencia "escape:" sobre todo el bitmap del contexto.
+ * La imagen se divide en tiles que los workers toman dinámicamente, cada uno
+ * con su propia copia del RenderContext.
+ */
+void executeEscape(Escape *escape, RenderContext *ctx);
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef ESCAPE_SIMD_HEADER
+#define ESCAPE_SIMD_HEADER
+
+#include "EscapeBytecode.h"
+#include "EscapeKernels.h"
+
+/**
+ * Cantidad de píxeles que el motor vectorial itera a la vez en este
+ * procesador: 8 si soporta AVX2 y 4 si no (SSE2 es parte de x86-64).
+ */
+int escapeSimdLanes(void);
+
+/**
+ * Itera "count" píxeles de coordenadas (xs[k], ys[k]) de a "lanes" por vez y
+ * deja en iterations[k] exactamente lo que devolvería el evaluador escalar.
+ * Cuando un lane termina se recarga con el siguiente píxel pendiente, así los
+ * píxeles lentos no dejan lanes ociosos. Si el kernel no es ESCAPE_KERNEL_NONE
+ * se itera el kernel; si no, el programa. Con el kernel y norms distinto de
+ * NULL, norms[k] recibe el |z|^2 con el que escapó cada píxel (ver
+ * iterateEscapeKernel); el programa no lo calcula.
+ */
+void iterateEscapeSimd(int lanes, const EscapeKernel *kernel, const EscapeProgram *program,
+                       const double *xs, const double *ys, int count, int maxIter, int *iterations, double *norms);
+
+/**
+ * Igual que iterateEscapeSimd, pero iterando la órbita en float: con los
+ * mismos "lanes" (el valor de escapeSimdLanes) entran el doble de píxeles en
+ * cada registro. Las iteraciones ya no son exactamente las del evaluador
+ * escalar, así que sólo conviene en views donde la diferencia no se ve (ver
+ * selectEscapePrecision).
+ */
+void iterateEscapeSimdFloat(int lanes, const EscapeKernel *kernel, const EscapeProgram *program,
+                            const double *xs, const double *ys, int count, int maxIter, int *iterations,
+                            double *norms);
+
+#endif
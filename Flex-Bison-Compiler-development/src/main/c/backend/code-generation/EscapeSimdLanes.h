@@ -0,0 +1,429 @@
+/*
+ * Plantilla del motor vectorial. EscapeSimd.c la incluye una vez por cada
+ * conjunto de instrucciones, con estas macros definidas:
+ *
+ *   ESCAPE_SIMD_REAL        tipo de cada lane (double, o float).
+ *   ESCAPE_SIMD_INTEGER     entero del mismo tamaño, para las máscaras.
+ *   ESCAPE_SIMD_WIDTH       lanes por registro vectorial (2 SSE2, 4 AVX2 en double).
+ *   ESCAPE_SIMD_GROUPS      registros independientes iterados a la vez.
+ *   ESCAPE_SIMD_NAME(name)  agrega el sufijo del conjunto a cada símbolo.
+ *   ESCAPE_SIMD_SQRT(v)     raíz empaquetada (opcional).
+ *   ESCAPE_SIMD_ANY(mask)   si algún lane de la máscara está prendido (opcional).
+ *
+ * Por eso no tiene include guard. Cada operación vectorial repite, lane por
+ * lane, las operaciones escalares de Complex.h en el mismo orden, de modo que
+ * en double el resultado es bit a bit igual. En float la órbita se itera con
+ * 24 bits de mantisa (el píxel y sus valores iniciales se calculan en double).
+ */
+
+#define VECTOR ESCAPE_SIMD_NAME(EscapeVector)
+#define MASK ESCAPE_SIMD_NAME(EscapeMask)
+#define VECTOR_COMPLEX ESCAPE_SIMD_NAME(EscapeVectorComplex)
+#define CYCLE ESCAPE_SIMD_NAME(EscapeCycle)
+
+typedef ESCAPE_SIMD_REAL VECTOR __attribute__((vector_size(ESCAPE_SIMD_WIDTH * sizeof(ESCAPE_SIMD_REAL))));
+typedef ESCAPE_SIMD_INTEGER MASK __attribute__((vector_size(ESCAPE_SIMD_WIDTH * sizeof(ESCAPE_SIMD_INTEGER))));
+
+typedef struct
+{
+    VECTOR re;
+    VECTOR im;
+} VECTOR_COMPLEX;
+
+/* Se copia lane por lane para conservar el bit de signo de -0.0. */
+static inline VECTOR ESCAPE_SIMD_NAME(broadcast)(double value)
+{
+    VECTOR v;
+    for (int l = 0; l < ESCAPE_SIMD_WIDTH; l++)
+        v[l] = value;
+    return v;
+}
+
+static inline VECTOR ESCAPE_SIMD_NAME(sqrt)(VECTOR v)
+{
+#ifdef ESCAPE_SIMD_SQRT
+    return ESCAPE_SIMD_SQRT(v);
+#else
+    for (int l = 0; l < ESCAPE_SIMD_WIDTH; l++)
+        v[l] = sqrt(v[l]);
+    return v;
+#endif
+}
+
+static inline VECTOR ESCAPE_SIMD_NAME(select)(MASK mask, VECTOR a, VECTOR b)
+{
+    return (VECTOR)((mask & (MASK)a) | (~mask & (MASK)b));
+}
+
+static inline int ESCAPE_SIMD_NAME(any)(MASK mask)
+{
+#ifdef ESCAPE_SIMD_ANY
+    return ESCAPE_SIMD_ANY(mask);
+#else
+    ESCAPE_SIMD_INTEGER bits = 0;
+    for (int l = 0; l < ESCAPE_SIMD_WIDTH; l++)
+        bits |= mask[l];
+    return bits != 0;
+#endif
+}
+
+/* Estado de la detección de ciclos de Brent de cada lane de un grupo. */
+typedef struct
+{
+    VECTOR re;
+    VECTOR im;
+    VECTOR steps;
+    VECTOR power;
+} CYCLE;
+
+static inline void ESCAPE_SIMD_NAME(resetCycleLane)(CYCLE *cycle, int l, double re, double im)
+{
+    cycle->re[l] = re;
+    cycle->im[l] = im;
+    cycle->steps[l] = 0.0;
+    cycle->power[l] = 1.0;
+}
+
+/*
+ * Versión vectorial del chequeo de iterateQuadraticPeriodic (EscapeKernels.c)
+ * para los lanes que acaban de avanzar a (re, im). Se comparan los bits, no
+ * los valores: los lanes que repiten el z guardado pasan directo a "limit".
+ */
+static inline VECTOR ESCAPE_SIMD_NAME(detectCycles)(CYCLE *cycle, MASK advance, VECTOR re, VECTOR im,
+                                                    VECTOR iter, VECTOR limit)
+{
+    const VECTOR zero = {0};
+    const MASK one = (MASK)ESCAPE_SIMD_NAME(broadcast)(1.0);
+    MASK repeated = advance & ((MASK)re == (MASK)cycle->re) & ((MASK)im == (MASK)cycle->im);
+    cycle->steps += (VECTOR)(advance & one);
+    MASK checkpoint = advance & (cycle->steps == cycle->power);
+    cycle->re = ESCAPE_SIMD_NAME(select)(checkpoint, re, cycle->re);
+    cycle->im = ESCAPE_SIMD_NAME(select)(checkpoint, im, cycle->im);
+    cycle->steps = ESCAPE_SIMD_NAME(select)(checkpoint, zero, cycle->steps);
+    cycle->power = ESCAPE_SIMD_NAME(select)(checkpoint, cycle->power + cycle->power, cycle->power);
+    return ESCAPE_SIMD_NAME(select)(repeated, limit, iter);
+}
+
+/* Versión vectorial de runEscapeCode (EscapeBytecode.c), un grupo por vez. */
+static inline void ESCAPE_SIMD_NAME(runCode)(const EscapeCode *code, VECTOR_COMPLEX r[][ESCAPE_MAX_REGISTERS])
+{
+    const VECTOR zero = {0};
+    const MASK one = (MASK)ESCAPE_SIMD_NAME(broadcast)(1.0);
+    const EscapeInstruction *instruction = code->instructions;
+    const EscapeInstruction *end = instruction + code->length;
+    for (; instruction < end; instruction++)
+    {
+        for (int g = 0; g < ESCAPE_SIMD_GROUPS; g++)
+        {
+            VECTOR_COMPLEX a = r[g][instruction->a];
+            VECTOR_COMPLEX b = r[g][instruction->b];
+            VECTOR_COMPLEX *dst = &r[g][instruction->dst];
+            switch (instruction->opcode)
+            {
+            case ESCAPE_OP_ADD:
+                dst->re = a.re + b.re;
+                dst->im = a.im + b.im;
+                break;
+            case ESCAPE_OP_SUB:
+                dst->re = a.re - b.re;
+                dst->im = a.im - b.im;
+                break;
+            case ESCAPE_OP_MUL:
+                dst->re = a.re * b.re - a.im * b.im;
+                dst->im = a.re * b.im + a.im * b.re;
+                break;
+            case ESCAPE_OP_DIV:
+            {
+                VECTOR den = b.re * b.re + b.im * b.im;
+                MASK nonZero = den != zero;
+                dst->re = (VECTOR)(nonZero & (MASK)((a.re * b.re + a.im * b.im) / den));
+                dst->im = (VECTOR)(nonZero & (MASK)((a.im * b.re - a.re * b.im) / den));
+                break;
+            }
+            case ESCAPE_OP_ABS:
+                dst->re = ESCAPE_SIMD_NAME(sqrt)(a.re * a.re + a.im * a.im);
+                dst->im = zero;
+                break;
+            case ESCAPE_OP_LT:
+                dst->re = (VECTOR)((a.re < b.re) & one);
+                dst->im = zero;
+                break;
+            case ESCAPE_OP_GT:
+                dst->re = (VECTOR)((a.re > b.re) & one);
+                dst->im = zero;
+                break;
+            case ESCAPE_OP_MAKE:
+                dst->re = a.re;
+                dst->im = b.re;
+                break;
+            case ESCAPE_OP_SQUARE:
+                dst->re = a.re * a.re - a.im * a.im;
+                dst->im = a.re * a.im + a.im * a.re;
+                break;
+            case ESCAPE_OP_NORM_GT:
+                dst->re = (VECTOR)(((a.re * a.re + a.im * a.im) > b.re) & one);
+                dst->im = zero;
+                break;
+            case ESCAPE_OP_NORM_LT:
+                dst->re = (VECTOR)(((a.re * a.re + a.im * a.im) < b.re) & one);
+                dst->im = zero;
+                break;
+            }
+        }
+    }
+}
+
+static inline void ESCAPE_SIMD_NAME(loadProgramLane)(const EscapeProgram *program, Complex *scalar,
+                                                     VECTOR_COMPLEX *r, int l, double x, double y)
+{
+    Complex z = escapeInitialValue(program, scalar, x, y);
+    r[ESCAPE_REGISTER_Z].re[l] = z.re;
+    r[ESCAPE_REGISTER_Z].im[l] = z.im;
+    r[ESCAPE_REGISTER_X].re[l] = x;
+    r[ESCAPE_REGISTER_Y].re[l] = y;
+    /* Los valores por píxel se calcularon en escalar: se copian al lane. */
+    for (int k = 0; k < program->pixel.length; k++)
+    {
+        int dst = program->pixel.instructions[k].dst;
+        r[dst].re[l] = scalar[dst].re;
+        r[dst].im[l] = scalar[dst].im;
+    }
+}
+
+/*
+ * En cada vuelta se evalúa el "until" de todos los lanes; los que terminaron
+ * (o llegaron a maxIter) se guardan y se recargan con el próximo píxel. Los
+ * lanes recién cargados no avanzan en esa vuelta: primero se evalúa su
+ * condición, igual que en el loop escalar. Las iteraciones se cuentan en el
+ * mismo tipo que los lanes, que se compara con una sola instrucción también
+ * en SSE2 (en float son exactas hasta 2^24).
+ */
+static void ESCAPE_SIMD_NAME(iterateProgram)(const EscapeProgram *program, const double *xs, const double *ys,
+                                             int count, int maxIter, int *iterations)
+{
+    VECTOR_COMPLEX r[ESCAPE_SIMD_GROUPS][ESCAPE_MAX_REGISTERS];
+    Complex scalar[ESCAPE_MAX_REGISTERS];
+    for (int k = 0; k < program->registerCount; k++)
+    {
+        scalar[k] = program->initialRegisters[k];
+        for (int g = 0; g < ESCAPE_SIMD_GROUPS; g++)
+        {
+            r[g][k].re = ESCAPE_SIMD_NAME(broadcast)(scalar[k].re);
+            r[g][k].im = ESCAPE_SIMD_NAME(broadcast)(scalar[k].im);
+        }
+    }
+
+    const VECTOR zero = {0};
+    const VECTOR limit = ESCAPE_SIMD_NAME(broadcast)((double)maxIter);
+    const MASK one = (MASK)ESCAPE_SIMD_NAME(broadcast)(1.0);
+    VECTOR iter[ESCAPE_SIMD_GROUPS];
+    CYCLE cycle[ESCAPE_SIMD_GROUPS];
+    MASK active[ESCAPE_SIMD_GROUPS];
+    MASK done[ESCAPE_SIMD_GROUPS];
+    int pixel[ESCAPE_SIMD_GROUPS][ESCAPE_SIMD_WIDTH];
+    int next = 0;
+    int running = 0;
+    for (int g = 0; g < ESCAPE_SIMD_GROUPS; g++)
+    {
+        iter[g] = zero;
+        cycle[g] = (CYCLE){zero, zero, zero, zero};
+        active[g] = (MASK){0};
+        for (int l = 0; l < ESCAPE_SIMD_WIDTH; l++)
+        {
+            pixel[g][l] = -1;
+            if (next < count)
+            {
+                ESCAPE_SIMD_NAME(loadProgramLane)(program, scalar, r[g], l, xs[next], ys[next]);
+                ESCAPE_SIMD_NAME(resetCycleLane)(&cycle[g], l, r[g][ESCAPE_REGISTER_Z].re[l],
+                                                 r[g][ESCAPE_REGISTER_Z].im[l]);
+                pixel[g][l] = next++;
+                active[g][l] = -1;
+                running++;
+            }
+        }
+    }
+
+    while (running > 0)
+    {
+        if (program->hasUntil)
+            ESCAPE_SIMD_NAME(runCode)(&program->until, r);
+
+        MASK pending = {0};
+        for (int g = 0; g < ESCAPE_SIMD_GROUPS; g++)
+        {
+            done[g] = iter[g] >= limit;
+            if (program->hasUntil)
+                done[g] |= r[g][program->until.result].re != zero;
+            if (!program->hasStep)
+                done[g] = active[g];
+            done[g] &= active[g];
+            pending |= done[g];
+        }
+
+        if (ESCAPE_SIMD_NAME(any)(pending))
+        {
+            for (int g = 0; g < ESCAPE_SIMD_GROUPS; g++)
+            {
+                for (int l = 0; l < ESCAPE_SIMD_WIDTH; l++)
+                {
+                    if (!done[g][l])
+                        continue;
+                    iterations[pixel[g][l]] = (int)iter[g][l];
+                    iter[g][l] = 0.0;
+                    if (next < count)
+                    {
+                        ESCAPE_SIMD_NAME(loadProgramLane)(program, scalar, r[g], l, xs[next], ys[next]);
+                        ESCAPE_SIMD_NAME(resetCycleLane)(&cycle[g], l, r[g][ESCAPE_REGISTER_Z].re[l],
+                                                         r[g][ESCAPE_REGISTER_Z].im[l]);
+                        pixel[g][l] = next++;
+                    }
+                    else
+                    {
+                        pixel[g][l] = -1;
+                        active[g][l] = 0;
+                        running--;
+                    }
+                }
+            }
+            if (running == 0)
+                break;
+        }
+
+        ESCAPE_SIMD_NAME(runCode)(&program->step, r);
+        for (int g = 0; g < ESCAPE_SIMD_GROUPS; g++)
+        {
+            MASK advance = active[g] & ~done[g];
+            VECTOR_COMPLEX z = r[g][program->step.result];
+            r[g][ESCAPE_REGISTER_Z].re = ESCAPE_SIMD_NAME(select)(advance, z.re, r[g][ESCAPE_REGISTER_Z].re);
+            r[g][ESCAPE_REGISTER_Z].im = ESCAPE_SIMD_NAME(select)(advance, z.im, r[g][ESCAPE_REGISTER_Z].im);
+            iter[g] += (VECTOR)(advance & one);
+            if (program->periodicity)
+                iter[g] = ESCAPE_SIMD_NAME(detectCycles)(&cycle[g], advance, r[g][ESCAPE_REGISTER_Z].re,
+                                                         r[g][ESCAPE_REGISTER_Z].im, iter[g], limit);
+        }
+    }
+}
+
+static inline void ESCAPE_SIMD_NAME(loadKernelLane)(const EscapeKernel *kernel, VECTOR *zr, VECTOR *zi,
+                                                    VECTOR *cr, VECTOR *ci, int l, double x, double y)
+{
+    Complex z = evaluateEscapeOperand(&kernel->initial, x, y);
+    Complex c = evaluateEscapeOperand(&kernel->c, x, y);
+    (*zr)[l] = z.re;
+    (*zi)[l] = z.im;
+    (*cr)[l] = c.re;
+    (*ci)[l] = c.im;
+}
+
+/*
+ * Próximo píxel a cargar en un lane, o -1 si no quedan. Los que caen en el
+ * interior (ver isEscapeKernelInterior) se resuelven acá sin ocupar un lane.
+ */
+static inline int ESCAPE_SIMD_NAME(nextKernelPixel)(const EscapeKernel *kernel, const double *xs, const double *ys,
+                                                    int count, int *next, int maxIter, int *iterations)
+{
+    while (*next < count)
+    {
+        int k = (*next)++;
+        if (!kernel->interior || !isEscapeKernelInterior(kernel, xs[k], ys[k]))
+            return k;
+        iterations[k] = maxIter;
+    }
+    return -1;
+}
+
+/* Igual que iterateProgram, pero con el paso de iterateQuadratic. */
+static void ESCAPE_SIMD_NAME(iterateKernel)(const EscapeKernel *kernel, const double *xs, const double *ys,
+                                            int count, int maxIter, int *iterations, double *norms)
+{
+    const VECTOR zero = {0};
+    const VECTOR threshold = ESCAPE_SIMD_NAME(broadcast)(kernel->threshold);
+    const VECTOR limit = ESCAPE_SIMD_NAME(broadcast)((double)maxIter);
+    const MASK one = (MASK)ESCAPE_SIMD_NAME(broadcast)(1.0);
+    VECTOR zr[ESCAPE_SIMD_GROUPS], zi[ESCAPE_SIMD_GROUPS];
+    VECTOR cr[ESCAPE_SIMD_GROUPS], ci[ESCAPE_SIMD_GROUPS];
+    VECTOR iter[ESCAPE_SIMD_GROUPS];
+    VECTOR norm[ESCAPE_SIMD_GROUPS];
+    CYCLE cycle[ESCAPE_SIMD_GROUPS];
+    MASK active[ESCAPE_SIMD_GROUPS];
+    MASK done[ESCAPE_SIMD_GROUPS];
+    int pixel[ESCAPE_SIMD_GROUPS][ESCAPE_SIMD_WIDTH];
+    int next = 0;
+    int running = 0;
+    for (int g = 0; g < ESCAPE_SIMD_GROUPS; g++)
+    {
+        zr[g] = zi[g] = cr[g] = ci[g] = iter[g] = zero;
+        cycle[g] = (CYCLE){zero, zero, zero, zero};
+        active[g] = (MASK){0};
+        for (int l = 0; l < ESCAPE_SIMD_WIDTH; l++)
+        {
+            int k = ESCAPE_SIMD_NAME(nextKernelPixel)(kernel, xs, ys, count, &next, maxIter, iterations);
+            pixel[g][l] = k;
+            if (k >= 0)
+            {
+                ESCAPE_SIMD_NAME(loadKernelLane)(kernel, &zr[g], &zi[g], &cr[g], &ci[g], l, xs[k], ys[k]);
+                ESCAPE_SIMD_NAME(resetCycleLane)(&cycle[g], l, zr[g][l], zi[g][l]);
+                active[g][l] = -1;
+                running++;
+            }
+        }
+    }
+
+    while (running > 0)
+    {
+        MASK pending = {0};
+        for (int g = 0; g < ESCAPE_SIMD_GROUPS; g++)
+        {
+            norm[g] = zr[g] * zr[g] + zi[g] * zi[g];
+            done[g] = ((iter[g] >= limit) | (norm[g] > threshold)) & active[g];
+            pending |= done[g];
+        }
+
+        if (ESCAPE_SIMD_NAME(any)(pending))
+        {
+            for (int g = 0; g < ESCAPE_SIMD_GROUPS; g++)
+            {
+                for (int l = 0; l < ESCAPE_SIMD_WIDTH; l++)
+                {
+                    if (!done[g][l])
+                        continue;
+                    iterations[pixel[g][l]] = (int)iter[g][l];
+                    if (norms)
+                        norms[pixel[g][l]] = norm[g][l];
+                    iter[g][l] = 0.0;
+                    int k = ESCAPE_SIMD_NAME(nextKernelPixel)(kernel, xs, ys, count, &next, maxIter, iterations);
+                    pixel[g][l] = k;
+                    if (k >= 0)
+                    {
+                        ESCAPE_SIMD_NAME(loadKernelLane)(kernel, &zr[g], &zi[g], &cr[g], &ci[g], l, xs[k], ys[k]);
+                        ESCAPE_SIMD_NAME(resetCycleLane)(&cycle[g], l, zr[g][l], zi[g][l]);
+                    }
+                    else
+                    {
+                        active[g][l] = 0;
+                        running--;
+                    }
+                }
+            }
+            if (running == 0)
+                break;
+        }
+
+        for (int g = 0; g < ESCAPE_SIMD_GROUPS; g++)
+        {
+            MASK advance = active[g] & ~done[g];
+            VECTOR re = (zr[g] * zr[g] - zi[g] * zi[g]) + cr[g];
+            VECTOR im = (zr[g] * zi[g] + zi[g] * zr[g]) + ci[g];
+            zr[g] = ESCAPE_SIMD_NAME(select)(advance, re, zr[g]);
+            zi[g] = ESCAPE_SIMD_NAME(select)(advance, im, zi[g]);
+            iter[g] += (VECTOR)(advance & one);
+            if (kernel->periodicity)
+                iter[g] = ESCAPE_SIMD_NAME(detectCycles)(&cycle[g], advance, zr[g], zi[g], iter[g], limit);
+        }
+    }
+}
+
+#undef VECTOR
+#undef MASK
+#undef VECTOR_COMPLEX
+#undef CYCLE
@@ -0,0 +1,184 @@
+#include "EscapeSymmetry.h"
+#include <math.h>
+#include <string.h>
+
+/*
+ * Cómo cambia el valor de una subexpresión al cambiar el signo de la
+ * coordenada del eje: PARITY_EVEN si se conjuga, PARITY_ODD si se conjuga y
+ * cambia de signo (como la coordenada misma), PARITY_NONE si no se sabe.
+ */
+typedef enum
+{
+    PARITY_NONE,
+    PARITY_EVEN,
+    PARITY_ODD
+} Parity;
+
+static Parity expressionParity(EscapeExpression *expr, FactorType odd);
+
+static Parity factorParity(EscapeFactor *factor, FactorType odd)
+{
+    if (!factor)
+        return PARITY_EVEN;
+
+    switch (factor->type)
+    {
+    case CONSTANT:
+    case DOUBLE_CONSTANT:
+        return PARITY_EVEN;
+
+    case VARIABLE:
+        /* Los parámetros son reales; la variable del escape se supone conjugada (y se prueba con la fórmula). */
+        return PARITY_EVEN;
+
+    case EXPRESSION:
+        return expressionParity(factor->expression, odd);
+
+    case X_COORD_FACTOR:
+    case Y_COORD_FACTOR:
+        return factor->type == odd ? PARITY_ODD : PARITY_EVEN;
+
+    case RANGE:
+    {
+        /* [a, b] = re(a) + i re(b): la parte real no tiene que cambiar y la imaginaria tiene que cambiar de signo. */
+        if (!factor->range)
+            return PARITY_EVEN;
+        Parity re = expressionParity(factor->range->start, odd);
+        Parity im = expressionParity(factor->range->end, odd);
+        if (re == PARITY_EVEN && im == PARITY_ODD)
+            return PARITY_EVEN;
+        if (re == PARITY_ODD && im == PARITY_EVEN)
+            return PARITY_ODD;
+        return PARITY_NONE;
+    }
+
+    default:
+        return PARITY_NONE;
+    }
+}
+
+static Parity expressionParity(EscapeExpression *expr, FactorType odd)
+{
+    if (!expr)
+        return PARITY_EVEN;
+
+    if (expr->type == FACTOR)
+        return factorParity(expr->factor, odd);
+    if (expr->type == ABSOLUTE_VALUE)
+        return expressionParity(expr->leftExpression, odd) == PARITY_NONE ? PARITY_NONE : PARITY_EVEN;
+
+    Parity left = expressionParity(expr->leftExpression, odd);
+    Parity right = expressionParity(expr->rightExpression, odd);
+    if (left == PARITY_NONE || right == PARITY_NONE)
+        return PARITY_NONE;
+
+    switch (expr->type)
+    {
+    case ADDITION:
+    case SUBTRACTION:
+        return left == right ? left : PARITY_NONE;
+
+    case MULTIPLICATION:
+    case DIVISION:
+        return left == right ? PARITY_EVEN : PARITY_ODD;
+
+    case LOWER_THAN_OP:
+    case GREATER_THAN_OP:
+        /* Se comparan partes reales, que sólo se conservan si ningún lado cambia de signo. */
+        return left == PARITY_EVEN && right == PARITY_EVEN ? PARITY_EVEN : PARITY_NONE;
+
+    default:
+        return PARITY_NONE;
+    }
+}
+
+/* Si z0, el paso y la condición conservan la conjugación, también la conservan las iteraciones. */
+static int isConjugateSymmetric(Escape *escape, FactorType odd)
+{
+    return expressionParity(escape->initialValue, odd) == PARITY_EVEN &&
+           expressionParity(escape->recursiveAssigment, odd) == PARITY_EVEN &&
+           expressionParity(escape->untilCondition, odd) == PARITY_EVEN;
+}
+
+/*
+ * Ubica el espejo de [min, max] repartido en size píxeles: el píxel k está en
+ * min + k * step y su reflejo, en mirror - k. Devuelve 0 si ningún píxel tiene
+ * su reflejo dentro de la imagen.
+ */
+static int locateMirror(EscapeSymmetry *symmetry, double min, double max, int size)
+{
+    double step = (max - min) / size;
+    if (!(step != 0.0) || !isfinite(step))
+        return 0;
+    double position = -2.0 * min / step;
+    if (!(position >= 1.0 && position <= 2.0 * size - 3.0))
+        return 0;
+
+    long mirror = lround(position);
+    symmetry->mirror = (int)mirror;
+    symmetry->shift = -0.5 * mirror * step - min;
+    if (mirror <= size - 1)
+    {
+        /* El eje está en la primera mitad: se copia la banda del principio. */
+        symmetry->first = 0;
+        symmetry->last = (int)((mirror + 1) / 2 - 1);
+    }
+    else
+    {
+        symmetry->first = (int)(mirror / 2 + 1);
+        symmetry->last = size - 1;
+    }
+    return 1;
+}
+
+EscapeSymmetry findEscapeSymmetry(Escape *escape, const RenderContext *ctx)
+{
+    EscapeSymmetry symmetry;
+    memset(&symmetry, 0, sizeof(symmetry));
+    symmetry.axis = ESCAPE_SYMMETRY_NONE;
+    if (!escape || ctx->width <= 0 || ctx->height <= 0)
+        return symmetry;
+
+    if (isConjugateSymmetric(escape, X_COORD_FACTOR) && locateMirror(&symmetry, ctx->minX, ctx->maxX, ctx->width))
+        symmetry.axis = ESCAPE_SYMMETRY_COLUMNS;
+    else if (isConjugateSymmetric(escape, Y_COORD_FACTOR) &&
+             locateMirror(&symmetry, ctx->minY, ctx->maxY, ctx->height))
+        symmetry.axis = ESCAPE_SYMMETRY_ROWS;
+    return symmetry;
+}
+
+void mirrorEscape(const EscapeSymmetry *symmetry, RenderContext *ctx, int *counts, float *fractions)
+{
+    int width = ctx->width;
+    RGBColor *pixels = ctx->bmp->pixels;
+    if (symmetry->axis == ESCAPE_SYMMETRY_COLUMNS)
+    {
+        for (int py = 0; py < ctx->height; py++)
+        {
+            size_t row = (size_t)py * width;
+            for (int px = symmetry->first; px <= symmetry->last; px++)
+            {
+                size_t target = row + px;
+                size_t source = row + (symmetry->mirror - px);
+                pixels[target] = pixels[source];
+                if (counts)
+                    counts[target] = counts[source];
+                if (fractions)
+                    fractions[target] = fractions[source];
+            }
+        }
+    }
+    else if (symmetry->axis == ESCAPE_SYMMETRY_ROWS)
+    {
+        for (int py = symmetry->first; py <= symmetry->last; py++)
+        {
+            size_t target = (size_t)py * width;
+            size_t source = (size_t)(symmetry->mirror - py) * width;
+            memcpy(pixels + target, pixels + source, width * sizeof(RGBColor));
+            if (counts)
+                memcpy(counts + target, counts + source, width * sizeof(int));
+            if (fractions)
+                memcpy(fractions + target, fractions + source, width * sizeof(float));
+        }
+    }
+}
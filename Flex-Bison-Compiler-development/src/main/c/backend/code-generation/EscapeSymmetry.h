@@ -0,0 +1,51 @@
+#ifndef ESCAPE_SYMMETRY_HEADER
+#define ESCAPE_SYMMETRY_HEADER
+
+#include "../../frontend/syntactic-analysis/AbstractSyntaxTree.h"
+#include "RenderContext.h"
+
+/** Eje del espejo de un escape. */
+typedef enum
+{
+    ESCAPE_SYMMETRY_NONE,
+    /* La imagen es simétrica respecto de x = 0: se copian columnas. */
+    ESCAPE_SYMMETRY_COLUMNS,
+    /* La imagen es simétrica respecto de y = 0: se copian filas. */
+    ESCAPE_SYMMETRY_ROWS
+} EscapeSymmetryAxis;
+
+/**
+ * Simetría de un escape en el view: la columna (o fila) k tiene las mismas
+ * iteraciones que mirror - k, así que las de [first, last] se copian en vez
+ * de iterarse. La banda copiada siempre toca un borde de la imagen, así que
+ * lo que se itera es un rectángulo.
+ */
+typedef struct
+{
+    EscapeSymmetryAxis axis;
+    int mirror;
+    int first;
+    int last;
+    /*
+     * Desplazamiento del view sobre el eje (menos de un cuarto de píxel) para
+     * que el espejo caiga sobre la grilla de píxeles.
+     */
+    double shift;
+} EscapeSymmetry;
+
+/**
+ * Busca una simetría conjugada: si la fórmula sólo usa constantes reales y
+ * la coordenada del eje aparece únicamente como parte imaginaria (como en
+ * z*z + [:y:,:x:]), cambiar el signo de esa coordenada conjuga toda la
+ * órbita, y |z| y las comparaciones de partes reales no cambian. Devuelve
+ * ESCAPE_SYMMETRY_NONE si no se puede probar o si el view no cruza el eje.
+ */
+EscapeSymmetry findEscapeSymmetry(Escape *escape, const RenderContext *ctx);
+
+/**
+ * Copia la banda reflejada de la imagen y, si no son NULL, de las
+ * iteraciones y sus partes fraccionarias (arreglos de width * height).
+ */
+void mirrorEscape(const EscapeSymmetry *symmetry, RenderContext *ctx, int *counts, float *fractions);
+
+#endif
@@ -0,0 +1,272 @@
+#include "ExpressionJit.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* Parámetros distintos que puede leer una expresión compilada. */
+#define EXPRESSION_JIT_VARIABLES 64
+
+/* El nodo a profundidad d se calcula en xmm d, y la división usa uno más para el 0.0. */
+#define EXPRESSION_JIT_DEPTH 13
+
+/* rbx (que se preserva entre llamadas) guarda el RenderContext. */
+#define CONTEXT JIT_RBX
+
+typedef struct
+{
+    JitBuffer buffer;
+    /* Los lugares del frame de los parámetros, que se copian una vez al entrar a [rsp + 8 * k]. */
+    int slots[EXPRESSION_JIT_VARIABLES];
+    int variableCount;
+    int failed;
+} ExpressionJitCompiler;
+
+static int variableSlot(ExpressionJitCompiler *compiler, int slot)
+{
+    for (int k = 0; k < compiler->variableCount; k++)
+    {
+        if (compiler->slots[k] == slot)
+            return k;
+    }
+    if (compiler->variableCount == EXPRESSION_JIT_VARIABLES)
+    {
+        compiler->failed = 1;
+        return 0;
+    }
+    compiler->slots[compiler->variableCount] = slot;
+    return compiler->variableCount++;
+}
+
+static void collectVariables(ExpressionJitCompiler *compiler, const Expression *expr)
+{
+    if (!expr)
+        return;
+    if (expr->type != FACTOR)
+    {
+        collectVariables(compiler, expr->leftExpression);
+        if (expr->type != ABSOLUTE_VALUE)
+            collectVariables(compiler, expr->rightExpression);
+        return;
+    }
+    Factor *factor = expr->factor;
+    /* Las variables de quien llamó se buscan por nombre en la pila: quedan para el intérprete. */
+    if (factor && factor->type == VARIABLE && factor->variable->slot == CALLER_VARIABLE_SLOT)
+        compiler->failed = 1;
+    else if (factor && factor->type == VARIABLE && factor->variable->slot >= 0)
+        variableSlot(compiler, factor->variable->slot);
+    else if (factor && factor->type == EXPRESSION)
+        collectVariables(compiler, factor->expression);
+}
+
+static void emitExpression(ExpressionJitCompiler *compiler, const Expression *expr, int xmm);
+
+static void emitFactor(ExpressionJitCompiler *compiler, const Factor *factor, int xmm)
+{
+    JitBuffer *buffer = &compiler->buffer;
+    switch (factor ? factor->type : RANGE)
+    {
+    case CONSTANT:
+        jitLoadDouble(buffer, xmm, (double)factor->constant->value);
+        break;
+    case DOUBLE_CONSTANT:
+        jitLoadDouble(buffer, xmm, factor->doubleConstant->value);
+        break;
+    case VARIABLE:
+        /* Como getVariableValue, lo que no es un parámetro vale 0.0. */
+        if (factor->variable->slot < 0)
+            jitLoadDouble(buffer, xmm, 0.0);
+        else
+            jitSseMemory(buffer, JIT_SD, JIT_MOVSD_LOAD, xmm, JIT_RSP,
+                         8 * variableSlot(compiler, factor->variable->slot));
+        break;
+    case EXPRESSION:
+        emitExpression(compiler, factor->expression, xmm);
+        break;
+    case X_COORD_FACTOR:
+        jitSseMemory(buffer, JIT_SD, JIT_MOVSD_LOAD, xmm, CONTEXT, (int32_t)offsetof(RenderContext, currentPixelX));
+        break;
+    case Y_COORD_FACTOR:
+        jitSseMemory(buffer, JIT_SD, JIT_MOVSD_LOAD, xmm, CONTEXT, (int32_t)offsetof(RenderContext, currentPixelY));
+        break;
+    default:
+        jitLoadDouble(buffer, xmm, 0.0);
+        break;
+    }
+}
+
+/* xmm = 1.0 si la comparación ya hecha con ucomisd dio "above", 0.0 si no (NaN incluido). */
+static void emitAboveFlag(JitBuffer *buffer, int xmm)
+{
+    jitSse(buffer, JIT_PD, JIT_XOR, xmm, xmm);
+    size_t skip = jitJumpIf(buffer, JIT_JBE);
+    jitLoadDouble(buffer, xmm, 1.0);
+    jitPatch(buffer, skip);
+}
+
+/* Deja en xmm el valor de la expresión; los xmm mayores quedan para las subexpresiones de la derecha. */
+static void emitExpression(ExpressionJitCompiler *compiler, const Expression *expr, int xmm)
+{
+    JitBuffer *buffer = &compiler->buffer;
+    if (xmm > EXPRESSION_JIT_DEPTH)
+    {
+        compiler->failed = 1;
+        return;
+    }
+    if (!expr)
+    {
+        jitLoadDouble(buffer, xmm, 0.0);
+        return;
+    }
+    if (expr->type == FACTOR)
+    {
+        emitFactor(compiler, expr->factor, xmm);
+        return;
+    }
+    if (expr->type == ABSOLUTE_VALUE)
+    {
+        /* fabs: se borra el bit de signo. */
+        emitExpression(compiler, expr->leftExpression, xmm);
+        jitMovImmediate64(buffer, JIT_RAX, UINT64_MAX >> 1);
+        jitMovqToXmm(buffer, xmm + 1, JIT_RAX);
+        jitSse(buffer, JIT_PD, JIT_AND, xmm, xmm + 1);
+        return;
+    }
+
+    emitExpression(compiler, expr->leftExpression, xmm);
+    emitExpression(compiler, expr->rightExpression, xmm + 1);
+    switch (expr->type)
+    {
+    case ADDITION:
+        jitSse(buffer, JIT_SD, JIT_ADD, xmm, xmm + 1);
+        break;
+    case SUBTRACTION:
+        jitSse(buffer, JIT_SD, JIT_SUB, xmm, xmm + 1);
+        break;
+    case MULTIPLICATION:
+        jitSse(buffer, JIT_SD, JIT_MUL, xmm, xmm + 1);
+        break;
+    case DIVISION:
+    {
+        /* Da 0.0 sólo si el divisor es 0.0; con NaN se divide, como en el árbol. */
+        jitSse(buffer, JIT_PD, JIT_XOR, xmm + 2, xmm + 2);
+        jitSse(buffer, JIT_PD, JIT_UCOMISD, xmm + 1, xmm + 2);
+        size_t unordered = jitJumpIf(buffer, JIT_JP);
+        size_t nonZero = jitJumpIf(buffer, JIT_JNE);
+        jitSse(buffer, JIT_PD, JIT_XOR, xmm, xmm);
+        size_t done = jitJump(buffer);
+        jitPatch(buffer, unordered);
+        jitPatch(buffer, nonZero);
+        jitSse(buffer, JIT_SD, JIT_DIV, xmm, xmm + 1);
+        jitPatch(buffer, done);
+        break;
+    }
+    case LOWER_THAN_OP:
+        jitSse(buffer, JIT_PD, JIT_UCOMISD, xmm + 1, xmm);
+        emitAboveFlag(buffer, xmm);
+        break;
+    case GREATER_THAN_OP:
+        jitSse(buffer, JIT_PD, JIT_UCOMISD, xmm, xmm + 1);
+        emitAboveFlag(buffer, xmm);
+        break;
+    default:
+        jitLoadDouble(buffer, xmm, 0.0);
+        break;
+    }
+}
+
+/*
+ * double f(RenderContext *ctx): guarda rbx, reserva los lugares de los
+ * parámetros (la pila queda alineada a 16 para la llamada), los copia del
+ * frame actual y calcula el árbol en xmm0.
+ */
+static int compileExpression(const Expression *expression, JitCode *code)
+{
+    ExpressionJitCompiler compiler;
+    memset(&compiler, 0, sizeof(compiler));
+    initJitBuffer(&compiler.buffer);
+    JitBuffer *buffer = &compiler.buffer;
+    collectVariables(&compiler, expression);
+    int32_t frame = (int32_t)((8 * compiler.variableCount + 15) / 16 * 16);
+
+    jitPush(buffer, CONTEXT);
+    jitMov64(buffer, CONTEXT, JIT_RDI);
+    if (frame > 0)
+        jitAddImmediate64(buffer, JIT_RSP, -frame);
+    if (compiler.variableCount > 0)
+    {
+        jitMov64(buffer, JIT_RDI, CONTEXT);
+        jitMovImmediate64(buffer, JIT_RAX, (uint64_t)(uintptr_t)currentFrameValues);
+        jitCall(buffer, JIT_RAX);
+    }
+    for (int k = 0; k < compiler.variableCount; k++)
+    {
+        jitSseMemory(buffer, JIT_SD, JIT_MOVSD_LOAD, 0, JIT_RAX, 8 * compiler.slots[k]);
+        jitSseMemory(buffer, JIT_SD, JIT_MOVSD_STORE, 0, JIT_RSP, 8 * k);
+    }
+    emitExpression(&compiler, expression, 0);
+    if (frame > 0)
+        jitAddImmediate64(buffer, JIT_RSP, frame);
+    jitPop(buffer, CONTEXT);
+    jitRet(buffer);
+
+    if (compiler.failed)
+    {
+        freeJitBuffer(buffer);
+        return 0;
+    }
+    return finishJitCode(buffer, code);
+}
+
+ExpressionJitCache *createExpressionJitCache(void)
+{
+    if (!jitAvailable())
+        return NULL;
+    return calloc(1, sizeof(ExpressionJitCache));
+}
+
+void destroyExpressionJitCache(ExpressionJitCache *cache)
+{
+    if (!cache)
+        return;
+    for (int k = 0; k < EXPRESSION_JIT_BUCKETS; k++)
+    {
+        ExpressionJitEntry *entry = cache->buckets[k];
+        while (entry)
+        {
+            ExpressionJitEntry *next = entry->next;
+            releaseJitCode(&entry->code);
+            free(entry);
+            entry = next;
+        }
+    }
+    free(cache);
+}
+
+ExpressionJitFunction findExpressionJit(ExpressionJitCache *cache, const Expression *expression)
+{
+    /* Una hoja se lee más rápido que lo que cuesta la llamada. */
+    if (!expression || expression->type == FACTOR)
+        return NULL;
+
+    size_t bucket = ((uintptr_t)expression >> 4) & (EXPRESSION_JIT_BUCKETS - 1);
+    ExpressionJitEntry *entry = cache->buckets[bucket];
+    while (entry && entry->expression != expression)
+        entry = entry->next;
+    if (!entry)
+    {
+        entry = calloc(1, sizeof(ExpressionJitEntry));
+        entry->expression = expression;
+        entry->next = cache->buckets[bucket];
+        cache->buckets[bucket] = entry;
+    }
+
+    /* evaluations queda en -1 una vez que se intentó compilar, haya salido o no. */
+    if (entry->evaluations < 0 || ++entry->evaluations < EXPRESSION_JIT_THRESHOLD)
+        return entry->function;
+    entry->evaluations = -1;
+    if (compileExpression(expression, &entry->code))
+    {
+        entry->function = (ExpressionJitFunction)entry->code.entry;
+        cache->compiled++;
+    }
+    return entry->function;
+}
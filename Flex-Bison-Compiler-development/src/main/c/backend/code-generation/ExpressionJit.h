@@ -0,0 +1,52 @@
+#ifndef EXPRESSION_JIT_HEADER
+#define EXPRESSION_JIT_HEADER
+
+#include "../../frontend/syntactic-analysis/AbstractSyntaxTree.h"
+#include "Jit.h"
+#include "RenderContext.h"
+
+/* Evaluaciones de una misma expresión a partir de las cuales se compila. */
+#define EXPRESSION_JIT_THRESHOLD 64
+
+/* Valor de una expresión compilada, con los parámetros y el píxel de ctx. */
+typedef double (*ExpressionJitFunction)(RenderContext *ctx);
+
+typedef struct ExpressionJitEntry
+{
+    const Expression *expression;
+    int evaluations;
+    /* NULL mientras no se compiló, o si no se puede compilar. */
+    ExpressionJitFunction function;
+    JitCode code;
+    struct ExpressionJitEntry *next;
+} ExpressionJitEntry;
+
+#define EXPRESSION_JIT_BUCKETS 256
+
+/**
+ * Expresiones del intérprete (puntos de los polígonos, argumentos de las
+ * llamadas, condiciones de "if:") que se evaluaron muchas veces, compiladas a
+ * x86-64. Cada expresión se cuenta por su nodo del AST y, al llegar a
+ * EXPRESSION_JIT_THRESHOLD evaluaciones, se compila a una función que lee los
+ * parámetros una vez y calcula el árbol en registros xmm, con las mismas
+ * operaciones de double que evaluateExpression.
+ */
+typedef struct ExpressionJitCache
+{
+    ExpressionJitEntry *buckets[EXPRESSION_JIT_BUCKETS];
+    int compiled;
+} ExpressionJitCache;
+
+/** Devuelve NULL si el proceso no puede generar código nativo: se evalúa el árbol. */
+ExpressionJitCache *createExpressionJitCache(void);
+
+void destroyExpressionJitCache(ExpressionJitCache *cache);
+
+/**
+ * Cuenta una evaluación de la expresión y devuelve su función compilada, o
+ * NULL si hay que evaluarla recorriendo el árbol (todavía no es caliente, es
+ * una hoja o no entra en los registros).
+ */
+ExpressionJitFunction findExpressionJit(ExpressionJitCache *cache, const Expression *expression);
+
+#endif
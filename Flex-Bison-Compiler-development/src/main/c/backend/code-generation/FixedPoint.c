@@ -0,0 +1,222 @@
+#include "FixedPoint.h"
+#include <ctype.h>
+#include <math.h>
+#include <string.h>
+
+/* Palabras de fracción: todas menos la parte entera. */
+#define FIXED_POINT_FRACTION (FIXED_POINT_LIMBS - 1)
+
+static int isNegative(const FixedPoint *value)
+{
+    return (int32_t)value->limbs[FIXED_POINT_LIMBS - 1] < 0;
+}
+
+static int isZero(const FixedPoint *value)
+{
+    for (int k = 0; k < FIXED_POINT_LIMBS; k++)
+    {
+        if (value->limbs[k] != 0)
+            return 0;
+    }
+    return 1;
+}
+
+/* Divide un valor no negativo por un entero chico, de la palabra más alta a la más baja. */
+static void divideSmall(FixedPoint *value, uint32_t divisor)
+{
+    uint64_t remainder = 0;
+    for (int k = FIXED_POINT_LIMBS - 1; k >= 0; k--)
+    {
+        uint64_t current = (remainder << 32) | value->limbs[k];
+        value->limbs[k] = (uint32_t)(current / divisor);
+        remainder = current % divisor;
+    }
+}
+
+FixedPoint fixedFromInt(int value)
+{
+    FixedPoint result;
+    memset(&result, 0, sizeof(result));
+    result.limbs[FIXED_POINT_LIMBS - 1] = (uint32_t)value;
+    return result;
+}
+
+FixedPoint fixedFromDouble(double value)
+{
+    FixedPoint result;
+    memset(&result, 0, sizeof(result));
+    double magnitude = fabs(value);
+    double integer = floor(magnitude);
+    double fraction = magnitude - integer;
+    result.limbs[FIXED_POINT_LIMBS - 1] = (uint32_t)integer;
+    for (int k = FIXED_POINT_LIMBS - 2; k >= 0 && fraction != 0.0; k--)
+    {
+        /* Cada paso es exacto: sólo se corre el exponente y se quita la parte entera. */
+        fraction *= 4294967296.0;
+        double limb = floor(fraction);
+        result.limbs[k] = (uint32_t)limb;
+        fraction -= limb;
+    }
+    return value < 0.0 ? fixedNegate(result) : result;
+}
+
+FixedPoint fixedFromDecimal(const char *text)
+{
+    FixedPoint result;
+    memset(&result, 0, sizeof(result));
+    int negative = *text == '-';
+    if (*text == '-' || *text == '+')
+        text++;
+
+    uint32_t integer = 0;
+    for (; isdigit((unsigned char)*text); text++)
+        integer = integer * 10 + (uint32_t)(*text - '0');
+
+    if (*text == '.')
+    {
+        const char *first = ++text;
+        while (isdigit((unsigned char)*text))
+            text++;
+        /* Se arma la fracción de atrás para adelante: f = (f + d) / 10. */
+        for (const char *digit = text - 1; digit >= first; digit--)
+        {
+            result.limbs[FIXED_POINT_LIMBS - 1] += (uint32_t)(*digit - '0');
+            divideSmall(&result, 10);
+        }
+    }
+    result.limbs[FIXED_POINT_LIMBS - 1] = integer;
+    return negative ? fixedNegate(result) : result;
+}
+
+double fixedToDouble(FixedPoint value)
+{
+    int negative = isNegative(&value);
+    if (negative)
+        value = fixedNegate(value);
+    double result = 0.0;
+    for (int k = 0; k < FIXED_POINT_LIMBS; k++)
+    {
+        result += ldexp((double)value.limbs[k], 32 * (k - FIXED_POINT_FRACTION));
+    }
+    return negative ? -result : result;
+}
+
+FixedPoint fixedAdd(FixedPoint a, FixedPoint b)
+{
+    FixedPoint result;
+    uint64_t carry = 0;
+    for (int k = 0; k < FIXED_POINT_LIMBS; k++)
+    {
+        uint64_t sum = (uint64_t)a.limbs[k] + b.limbs[k] + carry;
+        result.limbs[k] = (uint32_t)sum;
+        carry = sum >> 32;
+    }
+    return result;
+}
+
+FixedPoint fixedNegate(FixedPoint value)
+{
+    FixedPoint result;
+    uint64_t carry = 1;
+    for (int k = 0; k < FIXED_POINT_LIMBS; k++)
+    {
+        uint64_t sum = (uint64_t)(uint32_t)~value.limbs[k] + carry;
+        result.limbs[k] = (uint32_t)sum;
+        carry = sum >> 32;
+    }
+    return result;
+}
+
+FixedPoint fixedSub(FixedPoint a, FixedPoint b)
+{
+    return fixedAdd(a, fixedNegate(b));
+}
+
+FixedPoint fixedAbs(FixedPoint value)
+{
+    return isNegative(&value) ? fixedNegate(value) : value;
+}
+
+FixedPoint fixedMul(FixedPoint a, FixedPoint b)
+{
+    int negative = isNegative(&a) != isNegative(&b);
+    a = fixedAbs(a);
+    b = fixedAbs(b);
+
+    uint32_t product[2 * FIXED_POINT_LIMBS];
+    memset(product, 0, sizeof(product));
+    for (int i = 0; i < FIXED_POINT_LIMBS; i++)
+    {
+        if (a.limbs[i] == 0)
+            continue;
+        uint64_t carry = 0;
+        for (int j = 0; j < FIXED_POINT_LIMBS; j++)
+        {
+            uint64_t current = (uint64_t)a.limbs[i] * b.limbs[j] + product[i + j] + carry;
+            product[i + j] = (uint32_t)current;
+            carry = current >> 32;
+        }
+        product[i + FIXED_POINT_LIMBS] = (uint32_t)carry;
+    }
+
+    FixedPoint result;
+    memcpy(result.limbs, product + FIXED_POINT_FRACTION, sizeof(result.limbs));
+    return negative ? fixedNegate(result) : result;
+}
+
+FixedPoint fixedDiv(FixedPoint a, FixedPoint b)
+{
+    if (isZero(&b))
+        return fixedFromInt(0);
+    int negative = isNegative(&a) != isNegative(&b);
+    a = fixedAbs(a);
+    b = fixedAbs(b);
+
+    /* División larga bit a bit de (a << bits de fracción) por b. */
+    uint32_t remainder[FIXED_POINT_LIMBS + 1];
+    memset(remainder, 0, sizeof(remainder));
+    FixedPoint quotient;
+    memset(&quotient, 0, sizeof(quotient));
+    int bits = 32 * (FIXED_POINT_LIMBS + FIXED_POINT_FRACTION);
+    for (int bit = bits - 1; bit >= 0; bit--)
+    {
+        int index = bit - 32 * FIXED_POINT_FRACTION;
+        uint32_t next = index >= 0 ? (a.limbs[index / 32] >> (index % 32)) & 1u : 0u;
+        for (int k = FIXED_POINT_LIMBS; k > 0; k--)
+            remainder[k] = (remainder[k] << 1) | (remainder[k - 1] >> 31);
+        remainder[0] = (remainder[0] << 1) | next;
+
+        int greater = remainder[FIXED_POINT_LIMBS] != 0;
+        for (int k = FIXED_POINT_LIMBS - 1; k >= 0 && !greater; k--)
+        {
+            if (remainder[k] != b.limbs[k])
+            {
+                greater = remainder[k] > b.limbs[k];
+                break;
+            }
+            if (k == 0)
+                greater = 1;
+        }
+        if (!greater)
+            continue;
+
+        int64_t borrow = 0;
+        for (int k = 0; k <= FIXED_POINT_LIMBS; k++)
+        {
+            int64_t difference = (int64_t)remainder[k] - (k < FIXED_POINT_LIMBS ? b.limbs[k] : 0) - borrow;
+            borrow = difference < 0;
+            remainder[k] = (uint32_t)difference;
+        }
+        if (bit < 32 * FIXED_POINT_LIMBS)
+            quotient.limbs[bit / 32] |= 1u << (bit % 32);
+    }
+    return negative ? fixedNegate(quotient) : quotient;
+}
+
+int fixedCompare(FixedPoint a, FixedPoint b)
+{
+    FixedPoint difference = fixedSub(a, b);
+    if (isNegative(&difference))
+        return -1;
+    return isZero(&difference) ? 0 : 1;
+}
@@ -0,0 +1,46 @@
+#ifndef FIXED_POINT_HEADER
+#define FIXED_POINT_HEADER
+
+#include <stdint.h>
+
+/*
+ * Palabras de 32 bits por número: la más significativa es la parte entera
+ * (con signo) y el resto son 480 bits de fracción, alrededor de 1e-144.
+ */
+#define FIXED_POINT_LIMBS 16
+
+/**
+ * Real de punto fijo en complemento a dos, con la palabra menos significativa
+ * primero. Alcanza para los views de un zoom profundo y la órbita de
+ * referencia de la perturbación, que nunca salen de |x| < 2^31.
+ */
+typedef struct
+{
+    uint32_t limbs[FIXED_POINT_LIMBS];
+} FixedPoint;
+
+FixedPoint fixedFromInt(int value);
+
+/** Conversión exacta (los bits de un double entran en la fracción). */
+FixedPoint fixedFromDouble(double value);
+
+/** Lee un literal decimal ("-0.7436438870371587047521915") sin pasar por double. */
+FixedPoint fixedFromDecimal(const char *text);
+
+/** El double más cercano (salvo el último bit). */
+double fixedToDouble(FixedPoint value);
+
+FixedPoint fixedAdd(FixedPoint a, FixedPoint b);
+FixedPoint fixedSub(FixedPoint a, FixedPoint b);
+FixedPoint fixedMul(FixedPoint a, FixedPoint b);
+
+/** a / b, o cero si b es cero (como la división del intérprete). */
+FixedPoint fixedDiv(FixedPoint a, FixedPoint b);
+
+FixedPoint fixedNegate(FixedPoint value);
+FixedPoint fixedAbs(FixedPoint value);
+
+/** -1, 0 o 1 según a sea menor, igual o mayor que b. */
+int fixedCompare(FixedPoint a, FixedPoint b);
+
+#endif
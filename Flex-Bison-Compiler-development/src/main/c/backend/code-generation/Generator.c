@@ -1,5 +1,7 @@
 #include "Generator.h"
+#include "EscapeRenderer.h"
 #include "Interpreter.h"
+#include "NativeProgram.h"
 
 
 static Logger * _logger = NULL;
@@ -30,13 +32,19 @@ void executeGenerator(CompilerState * compilerState) {
     }
 
     
+    ModuleDestructor renderContextDestructor = initializeRenderContextModule();
     ModuleDestructor interpreterDestructor = initializeInterpreterModule();
+    ModuleDestructor escapeRendererDestructor = initializeEscapeRendererModule();
+    ModuleDestructor nativeProgramDestructor = initializeNativeProgramModule();
 
 
-    generateFractal(compilerState->abstractSyntaxtTree, compilerState->outputImageName);
+    generateFractal(compilerState->abstractSyntaxtTree, compilerState->outputImageName, &compilerState->renderOptions);
 
     
+    nativeProgramDestructor();
+    escapeRendererDestructor();
     interpreterDestructor();
+    renderContextDestructor();
     
     logDebugging(_logger, "Generación finalizada. Revisa el archivo de salida (ej. output.bmp).");
 }
\ No newline at end of file
@@ -0,0 +1,112 @@
+#include "InstanceCache.h"
+#include <stdint.h>
+#include <string.h>
+
+/* Tabla de direccionamiento abierto, con la capacidad en potencias de 2 y a lo sumo llena hasta la mitad. */
+struct InstanceCache
+{
+    RuleInstance **slots;
+    size_t capacity;
+    size_t count;
+    /* Búsquedas que encontraron una instancia que ya estaba. */
+    size_t hits;
+};
+
+/* FNV-1a de 64 bits de la regla y los valores. */
+static uint64_t hashInstance(const Rule *rule, const double *values)
+{
+    uint64_t hash = 14695981039346656037ull;
+    const unsigned char *bytes = (const unsigned char *)&rule;
+    for (size_t k = 0; k < sizeof(rule); k++)
+    {
+        hash ^= bytes[k];
+        hash *= 1099511628211ull;
+    }
+    bytes = (const unsigned char *)values;
+    for (size_t k = 0; k < rule->parameterCount * sizeof(double); k++)
+    {
+        hash ^= bytes[k];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+InstanceCache *createInstanceCache(void)
+{
+    InstanceCache *cache = calloc(1, sizeof(InstanceCache));
+    cache->capacity = 256;
+    cache->slots = calloc(cache->capacity, sizeof(RuleInstance *));
+    return cache;
+}
+
+void destroyInstanceCache(InstanceCache *cache)
+{
+    if (!cache)
+        return;
+    for (size_t k = 0; k < cache->capacity; k++)
+    {
+        RuleInstance *instance = cache->slots[k];
+        if (!instance)
+            continue;
+        for (int s = 0; s < instance->stepCount; s++)
+            free(instance->steps[s].offsets);
+        free(instance->steps);
+        free(instance->values);
+        free(instance);
+    }
+    free(cache->slots);
+    free(cache);
+}
+
+/* Lugar de la instancia en la tabla, o el lugar vacío donde iría. */
+static size_t probeInstance(const InstanceCache *cache, const Rule *rule, const double *values, uint64_t hash)
+{
+    size_t mask = cache->capacity - 1;
+    size_t k = hash & mask;
+    for (;;)
+    {
+        const RuleInstance *instance = cache->slots[k];
+        if (!instance || (instance->rule == rule && memcmp(instance->values, values, rule->parameterCount * sizeof(double)) == 0))
+            return k;
+        k = (k + 1) & mask;
+    }
+}
+
+static void growInstanceCache(InstanceCache *cache)
+{
+    RuleInstance **old = cache->slots;
+    size_t oldCapacity = cache->capacity;
+    cache->capacity *= 2;
+    cache->slots = calloc(cache->capacity, sizeof(RuleInstance *));
+    for (size_t k = 0; k < oldCapacity; k++)
+    {
+        RuleInstance *instance = old[k];
+        if (instance)
+            cache->slots[probeInstance(cache, instance->rule, instance->values, hashInstance(instance->rule, instance->values))] = instance;
+    }
+    free(old);
+}
+
+RuleInstance *findRuleInstance(InstanceCache *cache, const Rule *rule, const double *values)
+{
+    /* Lleno, y casi sin repeticiones: los valores no se repiten, y buscar sólo cuesta. */
+    if (cache->count == INSTANCE_CACHE_LIMIT && cache->hits < cache->count)
+        return NULL;
+    size_t k = probeInstance(cache, rule, values, hashInstance(rule, values));
+    if (cache->slots[k])
+    {
+        cache->hits++;
+        return cache->slots[k];
+    }
+    if (cache->count == INSTANCE_CACHE_LIMIT)
+        return NULL;
+
+    RuleInstance *instance = calloc(1, sizeof(RuleInstance));
+    instance->rule = rule;
+    instance->values = malloc(rule->parameterCount * sizeof(double));
+    memcpy(instance->values, values, rule->parameterCount * sizeof(double));
+    cache->slots[k] = instance;
+    if (++cache->count * 2 > cache->capacity)
+        growInstanceCache(cache);
+    return instance;
+}
@@ -0,0 +1,56 @@
+#ifndef INSTANCE_CACHE_HEADER
+#define INSTANCE_CACHE_HEADER
+
+#include "../../frontend/syntactic-analysis/AbstractSyntaxTree.h"
+
+/* Instancias distintas que guarda, como mucho, un caché: las de más se interpretan. */
+#define INSTANCE_CACHE_LIMIT 65536
+
+typedef struct RuleInstance RuleInstance;
+
+/**
+ * Una sentencia de una instancia: un polígono de "count" puntos, con sus
+ * desplazamientos en "offsets" (x, y, x, y...), o, si "child" no es NULL, una
+ * llamada a la misma regla desplazada en (dx, dy), con la instancia "child".
+ */
+typedef struct
+{
+    RuleInstance *child;
+    double dx, dy;
+    int count;
+    double *offsets;
+} InstanceStep;
+
+/**
+ * Lo que dibuja una llamada a una regla que se traslada (ver
+ * Rule.translationX), sin contar a quién llama: sus polígonos y sus llamadas,
+ * desplazados desde los parámetros de traslación. Las llamadas con los mismos
+ * valores en los demás parámetros comparten la instancia, que se evalúa una
+ * vez, con los de traslación en 0.
+ */
+struct RuleInstance
+{
+    const Rule *rule;
+    /* Valores de los parámetros, con los de traslación en 0 (la clave en el caché). */
+    double *values;
+    /* 0 si todavía no se evaluó, 1 si "steps" está completo, -1 si no se pudo evaluar. */
+    int ready;
+    int stepCount;
+    InstanceStep *steps;
+};
+
+typedef struct InstanceCache InstanceCache;
+
+InstanceCache *createInstanceCache(void);
+
+void destroyInstanceCache(InstanceCache *cache);
+
+/**
+ * Devuelve la instancia de la regla con esos valores (con los parámetros de
+ * traslación en 0), agregándola sin evaluar si no estaba, o NULL si el caché
+ * está lleno. Un caché que se llenó con menos búsquedas repetidas que
+ * instancias ya no busca más.
+ */
+RuleInstance *findRuleInstance(InstanceCache *cache, const Rule *rule, const double *values);
+
+#endif
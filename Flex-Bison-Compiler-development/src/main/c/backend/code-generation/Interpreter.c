@@ -1,4 +1,11 @@
 #include "Interpreter.h"
+#include "EscapeRenderer.h"
+#include "ExpressionJit.h"
+#include "InstanceCache.h"
+#include "NativeProgram.h"
+#include "SegmentBuffer.h"
+#include "WorkStealing.h"
+#include <pthread.h>
 #include <string.h>
 #include <math.h>
 #include <time.h>
@@ -6,74 +13,6 @@
 
 static Logger *_logger = NULL;
 
-typedef struct VariableEntry
-{
-    char *name;
-    double value;
-    struct VariableEntry *next;
-} VariableEntry;
-
-typedef struct
-{
-    double minX, maxX, minY, maxY;
-    int width, height;
-    Bitmap *bmp;
-    Program *program;
-
-    VariableEntry *variables;
-
-    double currentPixelX;
-    double currentPixelY;
-    int numPoints;
-
-    RGBColor colorStart;
-    RGBColor colorEnd;
-} RenderContext;
-
-typedef struct
-{
-    double re;
-    double im;
-} Complex;
-
-static inline Complex makeComplex(double re, double im)
-{
-    Complex c;
-    c.re = re;
-    c.im = im;
-    return c;
-}
-
-static inline Complex complexAdd(Complex a, Complex b)
-{
-    return makeComplex(a.re + b.re, a.im + b.im);
-}
-
-static inline Complex complexSub(Complex a, Complex b)
-{
-    return makeComplex(a.re - b.re, a.im - b.im);
-}
-
-static inline Complex complexMul(Complex a, Complex b)
-{
-    return makeComplex(a.re * b.re - a.im * b.im,
-                       a.re * b.im + a.im * b.re);
-}
-
-static inline Complex complexDiv(Complex a, Complex b)
-{
-    double den = b.re * b.re + b.im * b.im;
-    if (den == 0.0)
-        return makeComplex(0.0, 0.0);
-    return makeComplex((a.re * b.re + a.im * b.im) / den,
-                       (a.im * b.re - a.re * b.im) / den);
-}
-
-static inline double complexAbs(Complex a)
-{
-    return sqrt(a.re * a.re + a.im * a.im);
-}
-
 void _shutdownInterpreterModule()
 {
     if (_logger != NULL)
@@ -108,67 +47,29 @@ static RGBColor parseHexColor(char *hexStr)
     return color;
 }
 
-// Interpola linealmente entre dos colores (t va de 0.0 a 1.0)
-static RGBColor interpolateColor(RGBColor c1, RGBColor c2, double t)
-{
-    RGBColor res;
-    if (t < 0.0)
-        t = 0.0;
-    if (t > 1.0)
-        t = 1.0;
-
-    res.r = (uint8_t)(c1.r + (c2.r - c1.r) * t);
-    res.g = (uint8_t)(c1.g + (c2.g - c1.g) * t);
-    res.b = (uint8_t)(c1.b + (c2.b - c1.b) * t);
-    return res;
-}
-
-static void pushVariable(RenderContext *ctx, char *name, double value)
-{
-    VariableEntry *v = malloc(sizeof(VariableEntry));
-    v->name = strdup(name);
-    v->value = value;
-    v->next = ctx->variables;
-    ctx->variables = v;
-}
-
-static void popVariable(RenderContext *ctx)
+/* Coordenada del píxel antes de truncarla: mapX y mapY se quedan con la parte entera. */
+static double pixelX(RenderContext *ctx, double x)
 {
-    if (ctx->variables)
-    {
-        VariableEntry *tmp = ctx->variables;
-        ctx->variables = tmp->next;
-        free(tmp->name);
-        free(tmp);
-    }
+    if (ctx->maxX == ctx->minX)
+        return 0.0;
+    return (x - ctx->minX) / (ctx->maxX - ctx->minX) * (ctx->width - 1);
 }
 
-static double getVariableValue(RenderContext *ctx, char *name)
+static double pixelY(RenderContext *ctx, double y)
 {
-    VariableEntry *cur = ctx->variables;
-    while (cur != NULL)
-    {
-        if (strcmp(cur->name, name) == 0)
-        {
-            return cur->value;
-        }
-        cur = cur->next;
-    }
-    return 0.0;
+    if (ctx->maxY == ctx->minY)
+        return 0.0;
+    return (y - ctx->minY) / (ctx->maxY - ctx->minY) * (ctx->height - 1);
 }
 
 static int mapX(RenderContext *ctx, double x)
 {
-    if (ctx->maxX == ctx->minX)
-        return 0;
-    return (int)((x - ctx->minX) / (ctx->maxX - ctx->minX) * (ctx->width - 1));
+    return (int)pixelX(ctx, x);
 }
 
 static int mapY(RenderContext *ctx, double y)
 {
-    if (ctx->maxY == ctx->minY)
-        return 0;
-    return (int)((y - ctx->minY) / (ctx->maxY - ctx->minY) * (ctx->height - 1));
+    return (int)pixelY(ctx, y);
 }
 
 static double evaluateExpression(Expression *expr, RenderContext *ctx);
@@ -184,7 +85,7 @@ static double evaluateFactor(Factor *factor, RenderContext *ctx)
     case DOUBLE_CONSTANT:
         return factor->doubleConstant->value;
     case VARIABLE:
-        return getVariableValue(ctx, factor->variable->name);
+        return getVariableValue(ctx, factor->variable);
     case EXPRESSION:
         return evaluateExpression(factor->expression, ctx);
     case X_COORD_FACTOR:
@@ -229,116 +130,156 @@ static double evaluateExpression(Expression *expr, RenderContext *ctx)
     }
 }
 
-static Complex evaluateEscapeExpression(EscapeExpression *expr,
-                                        RenderContext *ctx,
-                                        Escape *escape,
-                                        Complex currentZ);
-
-static Complex evaluateEscapeFactor(EscapeFactor *factor,
-                                    RenderContext *ctx,
-                                    Escape *escape,
-                                    Complex currentZ)
+/* Como evaluateExpression, con el código nativo de la expresión si ya se compiló. */
+static double evaluateHotExpression(Expression *expr, RenderContext *ctx)
 {
-    if (!factor)
-        return makeComplex(0.0, 0.0);
-
-    switch (factor->type)
-    {
-    case CONSTANT:
-        return makeComplex((double)factor->constant->value, 0.0);
-
-    case DOUBLE_CONSTANT:
-        return makeComplex(factor->doubleConstant->value, 0.0);
-
-    case VARIABLE:
-        /* Si es la variable del escape (ej: "z"), devolvemos el z actual */
-        if (escape && escape->variable &&
-            strcmp(factor->variable->name, escape->variable->name) == 0)
-        {
-            return currentZ;
-        }
-        else
-        {
-            double v = getVariableValue(ctx, factor->variable->name);
-            return makeComplex(v, 0.0);
-        }
+    ExpressionJitFunction function = ctx->expressionJit ? findExpressionJit(ctx->expressionJit, expr) : NULL;
+    return function ? function(ctx) : evaluateExpression(expr, ctx);
+}
 
-    case EXPRESSION:
-        return evaluateEscapeExpression(factor->expression, ctx, escape, currentZ);
+static void runRules(RenderContext *ctx, size_t bottom);
 
-    case X_COORD_FACTOR:
-        return makeComplex(ctx->currentPixelX, 0.0);
+/* Profundidad (desde la regla que empieza la expansión en paralelo) hasta la que cada "call:" es una tarea aparte. */
+#define RULE_TASK_DEPTH 8
 
-    case Y_COORD_FACTOR:
-        return makeComplex(ctx->currentPixelY, 0.0);
+/* Segmentos que junta un contexto (o cada worker de una expansión) antes de rasterizarlos. */
+#define RULE_SEGMENT_BATCH 65536
 
-    case RANGE:
-        /* [expr1, expr2] => expr1 + i*expr2 */
-        if (factor->range)
-        {
-            Complex a = evaluateEscapeExpression(factor->range->start, ctx, escape, currentZ);
-            Complex b = evaluateEscapeExpression(factor->range->end, ctx, escape, currentZ);
-            return makeComplex(a.re, b.re);
-        }
-        return makeComplex(0.0, 0.0);
-
-    default:
-        return makeComplex(0.0, 0.0);
-    }
-}
-
-static Complex evaluateEscapeExpression(EscapeExpression *expr,
-                                        RenderContext *ctx,
-                                        Escape *escape,
-                                        Complex currentZ)
+/* Una llamada pendiente, con los valores de todos los parámetros ya evaluados. */
+typedef struct
 {
-    if (!expr)
-        return makeComplex(0.0, 0.0);
+    const Rule *rule;
+    int depth;
+    double values[];
+} RuleTask;
 
-    if (expr->type == FACTOR)
+typedef struct
+{
+    RenderContext ctx;
+    SegmentBuffer segments;
+} RuleWorker;
+
+/*
+ * Expansión en paralelo de una regla marcada como "parallel" por el
+ * validador: sus llamadas son tareas en las deques de los workers y cada
+ * worker junta sus segmentos en su propio buffer. Todos los segmentos de la
+ * expansión son del color final, así que la imagen no depende del orden en
+ * que se dibujan los buffers.
+ */
+typedef struct RuleExpansion
+{
+    WorkPool pool;
+    RuleWorker *workers;
+    SegmentTileLocks tiles;
+} RuleExpansion;
+
+/*
+ * Rasteriza los segmentos pendientes del contexto. Hay que llamarla antes de
+ * cualquier cosa que lea o escriba el bitmap por otro lado (escape:,
+ * transform:, la poda, guardar la imagen), para que el orden sea el de las
+ * sentencias. Fuera de una expansión el rasterizado se reparte en tiles
+ * entre los ruleThreads threads. Un worker de una expansión, con su buffer
+ * lleno, lo rasteriza en tiles él solo, tomando el mutex de cada tile, a la
+ * vez que los demás workers; lo que les queda al terminar lo junta
+ * expandRule.
+ */
+static void flushSegments(RenderContext *ctx)
+{
+    if (!ctx->segments->count)
+        return;
+    if (!ctx->expansion)
     {
-        return evaluateEscapeFactor(expr->factor, ctx, escape, currentZ);
+        rasterizeSegments(ctx->segments, ctx->bmp, ctx->ruleThreads);
+        return;
     }
+    SegmentTileLocks *tiles = &ctx->expansion->tiles;
+    rasterizeSharedSegments(ctx->segments, ctx->bmp, tiles, tiles->count * ctx->worker / ctx->ruleThreads);
+}
 
-    if (expr->type == ABSOLUTE_VALUE)
+/*
+ * Agrega el segmento a la display list del contexto (ver SegmentBuffer.h),
+ * que se rasteriza cada RULE_SEGMENT_BATCH segmentos. Los que quedan del todo
+ * fuera del bitmap se descartan acá, antes de ocupar lugar; drawLine recorta
+ * el resto.
+ */
+static void drawSegment(RenderContext *ctx, int x0, int y0, int x1, int y1, RGBColor color)
+{
+    if (!lineMayBeVisible(ctx->bmp, x0, y0, x1, y1))
+        return;
+    if (!appendSegment(ctx->segments, x0, y0, x1, y1, color))
     {
-        Complex inner = evaluateEscapeExpression(expr->leftExpression, ctx, escape, currentZ);
-        double mag = complexAbs(inner);
-        return makeComplex(mag, 0.0);
+        flushSegments(ctx);
+        appendSegment(ctx->segments, x0, y0, x1, y1, color);
     }
+    if (ctx->segments->count >= RULE_SEGMENT_BATCH)
+        flushSegments(ctx);
+}
 
-    Complex left = evaluateEscapeExpression(expr->leftExpression, ctx, escape, currentZ);
-    Complex right = evaluateEscapeExpression(expr->rightExpression, ctx, escape, currentZ);
-
-    switch (expr->type)
-    {
-    case ADDITION:
-        return complexAdd(left, right);
-    case SUBTRACTION:
-        return complexSub(left, right);
-    case MULTIPLICATION:
-        return complexMul(left, right);
-    case DIVISION:
-        return complexDiv(left, right);
+/* Lado máximo de las cajas cuyos píxeles se miran en el bitmap antes de podar. */
+#define LOD_FILLED_BOX 8
 
-    case LOWER_THAN_OP:
+/* Si todos los píxeles de la caja que caen en el bitmap ya son del color de los polígonos. */
+static int boxFilled(RenderContext *ctx, const int box[4])
+{
+    flushSegments(ctx);
+    const Bitmap *bmp = ctx->bmp;
+    int x0 = box[0] < 0 ? 0 : box[0], x1 = box[2] >= bmp->width ? bmp->width - 1 : box[2];
+    int y0 = box[1] < 0 ? 0 : box[1], y1 = box[3] >= bmp->height ? bmp->height - 1 : box[3];
+    for (int y = y0; y <= y1; y++)
     {
-        double r = (left.re < right.re) ? 1.0 : 0.0;
-        return makeComplex(r, 0.0);
+        const RGBColor *pixel = bmp->pixels + (size_t)y * bmp->width;
+        for (int x = x0; x <= x1; x++)
+        {
+            if (pixel[x].r != ctx->colorEnd.r || pixel[x].g != ctx->colorEnd.g || pixel[x].b != ctx->colorEnd.b)
+                return 0;
+        }
     }
-    case GREATER_THAN_OP:
+    return 1;
+}
+
+/*
+ * Con la poda activa, el frame de arriba, recién apilado con sus argumentos,
+ * no se ejecuta si su regla escala lo que dibuja (ver Rule.scaleX) y la caja
+ * que contiene todo lo que dibujaría, con sus llamadas, cae fuera del bitmap
+ * o es una caja chica que ya está pintada entera: sólo pintaría del color de
+ * los polígonos adentro de ella. La caja se agranda un poco por el redondeo
+ * de los argumentos a lo largo de la recursión; pixelX y pixelY crecen con
+ * la coordenada también redondeando, así que sus bordes acotan los píxeles
+ * del medio. Con la poda activa las reglas no se expanden en paralelo: los
+ * segmentos de los workers esperan en buffers y el bitmap no estaría al día.
+ */
+static int lodSkipsFrame(RenderContext *ctx)
+{
+    const RuleFrame *frame = topFrame(ctx);
+    const Rule *rule = frame->rule;
+    if (!ctx->lod || rule->scale < 0)
+        return 0;
+    const double *values = ctx->frameValues + frame->base;
+    const double *box = rule->scaleBox;
+    double bounds[4];
+    for (int axis = 0; axis < 2; axis++)
     {
-        double r = (left.re > right.re) ? 1.0 : 0.0;
-        return makeComplex(r, 0.0);
+        double origin = values[axis ? rule->scaleY : rule->scaleX], scale = values[rule->scale];
+        double first = origin + scale * box[axis], last = origin + scale * box[axis + 2];
+        double margin = 1e-9 * (fabs(first) + fabs(last));
+        double low = fmin(first, last), high = fmax(first, last);
+        low = axis ? pixelY(ctx, low - margin) : pixelX(ctx, low - margin);
+        high = axis ? pixelY(ctx, high + margin) : pixelX(ctx, high + margin);
+        if (!isfinite(low) || !isfinite(high))
+            return 0;
+        bounds[axis] = fmin(low, high);
+        bounds[axis + 2] = fmax(low, high);
     }
 
-    default:
-        return makeComplex(0.0, 0.0);
-    }
+    /* Igual que mapX y mapY, un píxel es visible si su coordenada está en (-1, width). */
+    if (bounds[2] <= -1.0 || bounds[3] <= -1.0 || bounds[0] >= ctx->bmp->width || bounds[1] >= ctx->bmp->height)
+        return 1;
+    if (bounds[2] - bounds[0] >= LOD_FILLED_BOX || bounds[3] - bounds[1] >= LOD_FILLED_BOX)
+        return 0;
+    int pixels[4] = {(int)bounds[0], (int)bounds[1], (int)bounds[2], (int)bounds[3]};
+    return boxFilled(ctx, pixels);
 }
 
-static void executeRule(char *ruleName, ExpressionList *args, RenderContext *ctx);
-
 static void drawPolygon(Polygon *polygon, RenderContext *ctx)
 {
     if (!polygon || !polygon->pointList)
@@ -346,8 +287,8 @@ static void drawPolygon(Polygon *polygon, RenderContext *ctx)
     PointList *list = polygon->pointList;
     Point *firstPt = list->point;
 
-    double x1 = evaluateExpression(firstPt->x, ctx);
-    double y1 = evaluateExpression(firstPt->y, ctx);
+    double x1 = evaluateHotExpression(firstPt->x, ctx);
+    double y1 = evaluateHotExpression(firstPt->y, ctx);
     int startPx = mapX(ctx, x1);
     int startPy = mapY(ctx, y1);
     int prevPx = startPx;
@@ -360,99 +301,157 @@ static void drawPolygon(Polygon *polygon, RenderContext *ctx)
     while (list != NULL)
     {
         Point *p = list->point;
-        double x = evaluateExpression(p->x, ctx);
-        double y = evaluateExpression(p->y, ctx);
+        double x = evaluateHotExpression(p->x, ctx);
+        double y = evaluateHotExpression(p->y, ctx);
         int currPx = mapX(ctx, x);
         int currPy = mapY(ctx, y);
-        drawLine(ctx->bmp, prevPx, prevPy, currPx, currPy, color);
+        drawSegment(ctx, prevPx, prevPy, currPx, currPy, color);
         prevPx = currPx;
         prevPy = currPy;
         list = list->next;
     }
-    drawLine(ctx->bmp, prevPx, prevPy, startPx, startPy, color);
+    drawSegment(ctx, prevPx, prevPy, startPx, startPy, color);
 }
 
-static void executeEscape(Escape *escape, RenderContext *ctx)
+/*
+ * Evalúa una vez lo que hace la instancia, con el frame activo (el de una
+ * llamada con esos valores, y los parámetros de traslación en 0): cada punto
+ * y cada argumento de traslación da su desplazamiento, y los "if:" dependen
+ * sólo de los otros parámetros, así que cortan la instancia en el mismo paso
+ * para todas las llamadas que la comparten. Como el validador sólo acepta
+ * "p + d" o "p - d", el desplazamiento evaluado con "p" en 0 es "d" (o "-d") y
+ * "p" más él redondea igual que la expresión.
+ */
+static void buildInstance(RenderContext *ctx, RuleInstance *instance)
 {
-    if (!escape)
-        return;
-
-    int maxIter = 1000;
-    if (escape->maxIterations)
-    {
-        maxIter = escape->maxIterations->value;
-    }
-
-    int w = ctx->width;
-    int h = ctx->height;
-
-    for (int py = 0; py < h; py++)
+    const Rule *rule = instance->rule;
+    int capacity = 0;
+    instance->ready = 1;
+    for (RuleSentenceList *list = rule->ruleSentenceList; list; list = list->next)
     {
-        for (int px = 0; px < w; px++)
+        RuleSentence *rs = list->ruleSentence;
+        if (!rs)
+            continue;
+        if (rs->ruleSentenceType == RULE_SENTENCE_IF)
         {
+            if (evaluateHotExpression(rs->ifStatement->condition, ctx) != 0.0)
+                break;
+            continue;
+        }
 
-            double x0 = ctx->minX + (px * (ctx->maxX - ctx->minX) / (double)w);
-            double y0 = ctx->minY + (py * (ctx->maxY - ctx->minY) / (double)h);
-
-            ctx->currentPixelX = x0;
-            ctx->currentPixelY = y0;
-
-            Complex z = makeComplex(0.0, 0.0);
-            if (escape->initialValue)
-            {
-                z = evaluateEscapeExpression(escape->initialValue, ctx, escape, z);
-            }
-
-            int iter = 0;
-            while (iter < maxIter)
+        if (instance->stepCount == capacity)
+        {
+            capacity = capacity ? 2 * capacity : 4;
+            instance->steps = realloc(instance->steps, capacity * sizeof(InstanceStep));
+        }
+        InstanceStep *step = &instance->steps[instance->stepCount++];
+        memset(step, 0, sizeof(InstanceStep));
+        if (rs->ruleSentenceType == RULE_SENTENCE_POLYGON)
+        {
+            for (PointList *p = rs->polygon->pointList; p; p = p->next)
+                step->count++;
+            step->offsets = malloc(2 * step->count * sizeof(double));
+            int k = 0;
+            for (PointList *p = rs->polygon->pointList; p; p = p->next)
             {
-
-                if (escape->untilCondition)
-                {
-                    Complex cond = evaluateEscapeExpression(escape->untilCondition, ctx, escape, z);
-                    if (cond.re != 0.0)
-                    {
-                        break;
-                    }
-                }
-
-                if (!escape->recursiveAssigment)
-                {
-                    break;
-                }
-
-                z = evaluateEscapeExpression(escape->recursiveAssigment, ctx, escape, z);
-                iter++;
+                step->offsets[k++] = evaluateHotExpression(p->point->x, ctx);
+                step->offsets[k++] = evaluateHotExpression(p->point->y, ctx);
             }
+            continue;
+        }
 
-            if (iter < maxIter)
-            {
-
-                double t = (double)iter / (double)maxIter;
-                t = sqrt(t);
+        double values[rule->parameterCount];
+        ExpressionList *arg = rs->call->expressionList;
+        for (int k = 0; k < rule->parameterCount; k++, arg = arg->next)
+            values[k] = evaluateHotExpression(arg->expression, ctx);
+        step->dx = values[rule->translationX];
+        step->dy = values[rule->translationY];
+        values[rule->translationX] = values[rule->translationY] = 0.0;
+        step->child = findRuleInstance(ctx->instances, rule, values);
+        if (!step->child)
+        {
+            /* El caché está lleno: las llamadas con estos valores se interpretan. */
+            instance->ready = -1;
+            return;
+        }
+    }
+}
 
-                RGBColor color = interpolateColor(ctx->colorStart, ctx->colorEnd, t);
-                setPixel(ctx->bmp, px, py, color);
-            }
-            else
-            {
+/*
+ * Si la regla del frame activo se traslada, el frame pasa a repetir la
+ * instancia de sus valores, que se evalúa la primera vez que se usa.
+ */
+static void attachInstance(RenderContext *ctx)
+{
+    RuleFrame *frame = topFrame(ctx);
+    const Rule *rule = frame->rule;
+    if (!ctx->instances || rule->translationX < 0)
+        return;
+    double *values = ctx->frameValues + frame->base;
+    double x = values[rule->translationX];
+    double y = values[rule->translationY];
+    values[rule->translationX] = values[rule->translationY] = 0.0;
+    RuleInstance *instance = findRuleInstance(ctx->instances, rule, values);
+    if (instance && instance->ready == 0)
+        buildInstance(ctx, instance);
+    values[rule->translationX] = x;
+    values[rule->translationY] = y;
+    if (instance && instance->ready > 0)
+        frame->instance = instance;
+}
 
-                setPixel(ctx->bmp, px, py, ctx->colorEnd);
-            }
-        }
+/* Igual que drawPolygon, con los puntos de la instancia trasladados a (x, y). */
+static void drawInstancePolygon(RenderContext *ctx, const InstanceStep *step, double x, double y)
+{
+    int startPx = mapX(ctx, x + step->offsets[0]);
+    int startPy = mapY(ctx, y + step->offsets[1]);
+    int prevPx = startPx;
+    int prevPy = startPy;
+    for (int k = 1; k < step->count; k++)
+    {
+        int currPx = mapX(ctx, x + step->offsets[2 * k]);
+        int currPy = mapY(ctx, y + step->offsets[2 * k + 1]);
+        drawSegment(ctx, prevPx, prevPy, currPx, currPy, ctx->colorEnd);
+        prevPx = currPx;
+        prevPy = currPy;
     }
+    drawSegment(ctx, prevPx, prevPy, startPx, startPy, ctx->colorEnd);
 }
 
+/* Render progresivo del juego del caos: cada cuántos puntos se mira el presupuesto. */
+#define PROGRESSIVE_POINT_BATCH 1024
+
+/*
+ * En un render progresivo, la imagen se escribe cada vez que se duplica la
+ * cantidad de puntos (desde PROGRESSIVE_POINT_BATCH * 4), y se deja de sumar
+ * puntos si se agotó el presupuesto de tiempo.
+ */
 static void executeTransformation(Transformation *t, RenderContext *ctx)
 {
     (void)t;
     int points = (ctx->numPoints > 0) ? ctx->numPoints : 100000;
     double x = 0.0, y = 0.0;
+    int progressive = ctx->options && ctx->options->progressive;
+    int nextPreview = PROGRESSIVE_POINT_BATCH * 4;
 
     RGBColor color = ctx->colorEnd;
 
     for (int i = 0; i < points; i++)
     {
+        if (progressive && i > 0 && i % PROGRESSIVE_POINT_BATCH == 0)
+        {
+            if (i == nextPreview)
+            {
+                flushRenderPreview(ctx);
+                nextPreview *= 2;
+            }
+            if (renderBudgetSpent(ctx))
+            {
+                logInformation(_logger, "Presupuesto de tiempo agotado: se dibujaron %d de %d puntos.", i, points);
+                break;
+            }
+        }
+
         int r = rand() % 100;
         double nextX, nextY;
 
@@ -485,140 +484,394 @@ static void executeTransformation(Transformation *t, RenderContext *ctx)
     }
 }
 
-static int executeRuleSentences(RuleSentenceList *list, RenderContext *ctx)
+static int hasCalls(const Rule *rule)
 {
-    while (list != NULL)
+    for (RuleSentenceList *list = rule->ruleSentenceList; list; list = list->next)
     {
-        RuleSentence *rs = list->ruleSentence;
-        if (rs)
-        {
-            switch (rs->ruleSentenceType)
-            {
-            case RULE_SENTENCE_POLYGON:
-                drawPolygon(rs->polygon, ctx);
-                break;
-
-            case RULE_SENTENCE_CALL:
-                if (rs->call && rs->call->variable)
-                {
-                    executeRule(rs->call->variable->name, rs->call->expressionList, ctx);
-                }
-                break;
+        if (list->ruleSentence && list->ruleSentence->ruleSentenceType == RULE_SENTENCE_CALL)
+            return 1;
+    }
+    return 0;
+}
 
-            case RULE_SENTENCE_ESCAPE:
-                executeEscape(rs->escape, ctx);
-                break;
+static RuleTask *newRuleTask(const Rule *rule, int depth)
+{
+    RuleTask *task = malloc(sizeof(RuleTask) + rule->parameterCount * sizeof(double));
+    task->rule = rule;
+    task->depth = depth;
+    return task;
+}
 
-            case RULE_SENTENCE_TRANSFORMATION:
-                executeTransformation(rs->transformation, ctx);
-                break;
+/* Apila el frame de la tarea, con sus valores ya evaluados, y lo activa. */
+static void enterRuleTask(RenderContext *ctx, RuleTask *task)
+{
+    double *values = pushFrame(ctx, task->rule);
+    memcpy(values, task->values, task->rule->parameterCount * sizeof(double));
+    topFrame(ctx)->depth = task->depth;
+    enterFrame(ctx);
+    attachInstance(ctx);
+    free(task);
+}
 
-            case RULE_SENTENCE_POINTS_STATEMENT:
-                if (rs->pointsStatement && rs->pointsStatement->numPoints)
-                {
-                    ctx->numPoints = rs->pointsStatement->numPoints->value;
-                }
-                break;
+static void runRuleTask(void *context, int index, void *task)
+{
+    RenderContext *ctx = &((RuleExpansion *)context)->workers[index].ctx;
+    size_t bottom = ctx->frameCount;
+    enterRuleTask(ctx, task);
+    runRules(ctx, bottom);
+}
 
-            case RULE_SENTENCE_IF:
-                if (rs->ifStatement && rs->ifStatement->condition)
-                {
-                    double cond = evaluateExpression(rs->ifStatement->condition, ctx);
-                    if (cond != 0.0)
-                        return 1;
-                }
-                break;
+/*
+ * En una expansión, y hasta RULE_TASK_DEPTH, la llamada se apila como tarea
+ * para que cualquier worker la robe. La regla llamada también es "parallel",
+ * así que recibe todos sus argumentos y no hereda nada del frame actual. Si
+ * la deque está llena, el frame de la tarea queda arriba de la pila para
+ * seguir en este worker. Devuelve 0 si hay que llamarla con callRule.
+ */
+static int spawnRuleTask(Call *call, RenderContext *ctx)
+{
+    if (!ctx->expansion || topFrame(ctx)->depth >= RULE_TASK_DEPTH)
+        return 0;
+    RuleTask *task = newRuleTask(call->rule, topFrame(ctx)->depth + 1);
+    ExpressionList *arg = call->expressionList;
+    for (int k = 0; k < call->rule->parameterCount; k++, arg = arg->next)
+        task->values[k] = evaluateHotExpression(arg->expression, ctx);
+    if (!pushWork(&ctx->expansion->pool, ctx->worker, task))
+        enterRuleTask(ctx, task);
+    return 1;
+}
 
-            default:
-                break;
-            }
-        }
-        list = list->next;
+/*
+ * Ejecuta el próximo paso de la instancia del frame de arriba, trasladado a
+ * sus parámetros, o lo desapila si no quedan. Una llamada apila el frame de
+ * la instancia hija (o su tarea, como spawnRuleTask) sin evaluar nada.
+ */
+static void replayInstanceStep(RenderContext *ctx, RuleFrame *frame)
+{
+    RuleInstance *instance = frame->instance;
+    if (frame->step == instance->stepCount)
+    {
+        popFrame(ctx);
+        return;
     }
-    return 0;
+    const InstanceStep *step = &instance->steps[frame->step++];
+    const Rule *rule = frame->rule;
+    const double *values = ctx->frameValues + frame->base;
+    double x = values[rule->translationX];
+    double y = values[rule->translationY];
+    if (!step->child)
+    {
+        drawInstancePolygon(ctx, step, x, y);
+        return;
+    }
+    RuleInstance *child = step->child;
+    if (ctx->expansion && frame->depth < RULE_TASK_DEPTH)
+    {
+        RuleTask *task = newRuleTask(rule, frame->depth + 1);
+        memcpy(task->values, child->values, rule->parameterCount * sizeof(double));
+        task->values[rule->translationX] = x + step->dx;
+        task->values[rule->translationY] = y + step->dy;
+        if (!pushWork(&ctx->expansion->pool, ctx->worker, task))
+            enterRuleTask(ctx, task);
+        return;
+    }
+    double *childValues = pushFrame(ctx, rule);
+    memcpy(childValues, child->values, rule->parameterCount * sizeof(double));
+    childValues[rule->translationX] = x + step->dx;
+    childValues[rule->translationY] = y + step->dy;
+    enterFrame(ctx);
+    if (lodSkipsFrame(ctx))
+    {
+        popFrame(ctx);
+        return;
+    }
+    if (child->ready > 0)
+        topFrame(ctx)->instance = child;
+    else
+        attachInstance(ctx);
 }
 
-static void executeRule(char *ruleName, ExpressionList *args, RenderContext *ctx)
+/* Ejecuta la regla, con sus parámetros en "values", expandiendo sus llamadas en paralelo. */
+static void expandRule(Rule *rule, const double *values, RenderContext *ctx)
 {
-    SentenceList *sl = ctx->program->sentenceList;
-    Rule *rule = NULL;
-    while (sl != NULL)
+    int threads = ctx->ruleThreads;
+    logDebugging(_logger, "Expandiendo la regla '%s' en paralelo con %d workers.", rule->variable->name, threads);
+    flushSegments(ctx);
+    RuleExpansion expansion;
+    initWorkPool(&expansion.pool, threads, runRuleTask, &expansion);
+    initSegmentTileLocks(&expansion.tiles, ctx->bmp);
+    expansion.workers = calloc(threads, sizeof(RuleWorker));
+    for (int k = 0; k < threads; k++)
     {
-        Sentence *s = sl->sentence;
-        if (s && s->sentenceType == SENTENCE_RULE && s->rule && s->rule->variable)
+        RenderContext *worker = &expansion.workers[k].ctx;
+        *worker = *ctx;
+        resetFrames(worker);
+        worker->expressionJit = ctx->expressionJit ? createExpressionJitCache() : NULL;
+        worker->instances = ctx->instances ? createInstanceCache() : NULL;
+        worker->expansion = &expansion;
+        worker->worker = k;
+        initSegmentBuffer(&expansion.workers[k].segments);
+        worker->segments = &expansion.workers[k].segments;
+    }
+
+    RuleTask *root = newRuleTask(rule, 0);
+    memcpy(root->values, values, rule->parameterCount * sizeof(double));
+    runWorkPool(&expansion.pool, root);
+
+    /*
+     * Los segmentos que les quedan a los workers se juntan en el buffer del
+     * contexto, en el orden de los workers, y se rasterizan en tiles entre
+     * todos los threads.
+     */
+    for (int k = 0; k < threads; k++)
+    {
+        RuleWorker *worker = &expansion.workers[k];
+        if (!appendSegmentBuffer(ctx->segments, &worker->segments))
         {
-            if (strcmp(s->rule->variable->name, ruleName) == 0)
-            {
-                rule = s->rule;
-                break;
-            }
+            flushSegments(ctx);
+            appendSegmentBuffer(ctx->segments, &worker->segments);
         }
-        sl = sl->next;
+        ctx->segments->rasterized += worker->segments.rasterized;
+        ctx->segments->rasterTime += worker->segments.rasterTime;
+        if (ctx->expressionJit && worker->ctx.expressionJit)
+            ctx->expressionJit->compiled += worker->ctx.expressionJit->compiled;
+        destroyExpressionJitCache(worker->ctx.expressionJit);
+        destroyInstanceCache(worker->ctx.instances);
+        releaseFrames(&worker->ctx);
+        freeSegmentBuffer(&worker->segments);
     }
+    flushSegments(ctx);
+    free(expansion.workers);
+    freeSegmentTileLocks(&expansion.tiles);
+    freeWorkPool(&expansion.pool);
+}
 
-    if (!rule)
+/*
+ * Apila y activa el frame de la llamada: la regla ya viene resuelta por el
+ * validador (ver Call.rule), así que llamar no busca nada. Si la regla se
+ * expande en paralelo, se ejecuta entera acá y no queda nada apilado.
+ */
+static void callRule(Rule *rule, ExpressionList *args, RenderContext *ctx)
+{
+    /* Los argumentos se evalúan en el frame de quien llama, directo a los lugares del nuevo; los de más se descartan. */
+    double *values = pushFrame(ctx, rule);
+    int given = 0;
+    for (ExpressionList *arg = args; arg; arg = arg->next)
+    {
+        double value = evaluateHotExpression(arg->expression, ctx);
+        if (given < rule->parameterCount)
+            values[given++] = value;
+    }
+    if (given < rule->parameterCount)
+        inheritFrameValues(ctx, given);
+    enterFrame(ctx);
+    if (lodSkipsFrame(ctx))
     {
-        logError(_logger, "Runtime Error: No se encontró la regla '%s'", ruleName);
+        popFrame(ctx);
         return;
     }
 
-    int argCount = 0;
-    ExpressionList *tempArgs = args;
-    while (tempArgs)
+    if (!ctx->expansion && !ctx->lod && rule->parallel && ctx->ruleThreads > 1 && hasCalls(rule))
     {
-        argCount++;
-        tempArgs = tempArgs->next;
+        expandRule(rule, values, ctx);
+        popFrame(ctx);
+        return;
     }
+    attachInstance(ctx);
+}
 
-    double *values = NULL;
-    if (argCount > 0)
+/*
+ * Ejecuta las reglas de la pila de frames hasta que quede sólo lo que había
+ * debajo de "bottom": cada vuelta ejecuta la sentencia de la continuación del
+ * frame de arriba. Un "call:" apila otro frame y sigue por él, y un "if:" que
+ * se cumple o el fin de las sentencias lo desapilan, así que la recursión de
+ * las reglas no usa la pila de C.
+ */
+static void runRules(RenderContext *ctx, size_t bottom)
+{
+    while (ctx->frameCount > bottom)
     {
-        values = calloc(argCount, sizeof(double));
-        tempArgs = args;
-        int i = 0;
-        while (tempArgs)
+        RuleFrame *frame = topFrame(ctx);
+        if (frame->instance)
         {
-            values[i++] = evaluateExpression(tempArgs->expression, ctx);
-            tempArgs = tempArgs->next;
+            replayInstanceStep(ctx, frame);
+            continue;
         }
-    }
+        RuleSentenceList *list = frame->next;
+        if (!list)
+        {
+            popFrame(ctx);
+            continue;
+        }
+        frame->next = list->next;
+        RuleSentence *rs = list->ruleSentence;
+        if (!rs)
+            continue;
 
-    IdentifierList *params = rule->identifierList;
-    int pushedCount = 0;
-    int i = 0;
-    while (params && params->variable)
-    {
-        if (i < argCount)
+        switch (rs->ruleSentenceType)
         {
-            pushVariable(ctx, params->variable->name, values[i]);
-            pushedCount++;
+        case RULE_SENTENCE_POLYGON:
+            drawPolygon(rs->polygon, ctx);
+            break;
+
+        case RULE_SENTENCE_CALL:
+            if (rs->call && rs->call->rule)
+            {
+                if (!spawnRuleTask(rs->call, ctx))
+                    callRule(rs->call->rule, rs->call->expressionList, ctx);
+            }
+            else if (rs->call && rs->call->variable)
+            {
+                logError(_logger, "Runtime Error: No se encontró la regla '%s'", rs->call->variable->name);
+            }
+            break;
+
+        case RULE_SENTENCE_ESCAPE:
+            flushSegments(ctx);
+            executeEscape(rs->escape, ctx);
+            break;
+
+        case RULE_SENTENCE_TRANSFORMATION:
+            flushSegments(ctx);
+            executeTransformation(rs->transformation, ctx);
+            break;
+
+        case RULE_SENTENCE_POINTS_STATEMENT:
+            if (rs->pointsStatement && rs->pointsStatement->numPoints)
+            {
+                ctx->numPoints = rs->pointsStatement->numPoints->value;
+            }
+            break;
+
+        case RULE_SENTENCE_IF:
+            if (rs->ifStatement && rs->ifStatement->condition)
+            {
+                double cond = evaluateHotExpression(rs->ifStatement->condition, ctx);
+                if (cond != 0.0)
+                    popFrame(ctx);
+            }
+            break;
+
+        default:
+            break;
         }
-        params = params->identifierList;
-        i++;
     }
-    if (values)
-        free(values);
+}
+
+static void executeRule(Rule *rule, ExpressionList *args, RenderContext *ctx)
+{
+    size_t bottom = ctx->frameCount;
+    callRule(rule, args, ctx);
+    runRules(ctx, bottom);
+}
 
-    executeRuleSentences(rule->ruleSentenceList, ctx);
+/* Estado de las llamadas del código nativo al intérprete. */
+typedef struct
+{
+    RenderContext *ctx;
+    NativeProgram *native;
+} NativeRun;
+
+/* Igual que drawPolygon, con los puntos ya evaluados. */
+static void drawNativePolygon(void *run, int count, const double *xs, const double *ys)
+{
+    RenderContext *ctx = ((NativeRun *)run)->ctx;
+    int startPx = mapX(ctx, xs[0]);
+    int startPy = mapY(ctx, ys[0]);
+    int prevPx = startPx;
+    int prevPy = startPy;
+    for (int k = 1; k < count; k++)
+    {
+        int currPx = mapX(ctx, xs[k]);
+        int currPy = mapY(ctx, ys[k]);
+        drawSegment(ctx, prevPx, prevPy, currPx, currPy, ctx->colorEnd);
+        prevPx = currPx;
+        prevPy = currPy;
+    }
+    drawSegment(ctx, prevPx, prevPy, startPx, startPy, ctx->colorEnd);
+}
 
-    for (int k = 0; k < pushedCount; k++)
-        popVariable(ctx);
+/* Los parámetros se apilan en un frame como en executeRule, para que el escape los lea por su lugar. */
+static void executeNativeEscape(void *run, int index, const double *parameters)
+{
+    RenderContext *ctx = ((NativeRun *)run)->ctx;
+    NativeSource *source = ((NativeRun *)run)->native->source;
+    const Rule *rule = source->escapeRules[index];
+    flushSegments(ctx);
+    double *values = pushFrame(ctx, rule);
+    for (int k = 0; k < rule->parameterCount; k++)
+        values[k] = parameters[k];
+    enterFrame(ctx);
+    executeEscape(source->escapes[index], ctx);
+    popFrame(ctx);
 }
 
-void generateFractal(Program *program, const char *outputFilename)
+static void executeNativeTransformation(void *run, int index)
+{
+    flushSegments(((NativeRun *)run)->ctx);
+    executeTransformation(((NativeRun *)run)->native->source->transformations[index], ((NativeRun *)run)->ctx);
+}
+
+static void setNativePoints(void *run, int count)
+{
+    ((NativeRun *)run)->ctx->numPoints = count;
+}
+
+/* Pasando NATIVE_MAX_DEPTH, la llamada y todo lo que cuelga de ella siguen en la pila de frames. */
+static void executeNativeCall(void *run, int index, const double *parameters)
+{
+    RenderContext *ctx = ((NativeRun *)run)->ctx;
+    const Rule *rule = ((NativeRun *)run)->native->source->rules[index];
+    size_t bottom = ctx->frameCount;
+    double *values = pushFrame(ctx, rule);
+    for (int k = 0; k < rule->parameterCount; k++)
+        values[k] = parameters[k];
+    enterFrame(ctx);
+    attachInstance(ctx);
+    runRules(ctx, bottom);
+}
+
+/* Ejecuta la regla inicial con el programa compilado; devuelve 0 si hay que interpretarla. */
+static int runNativeProgram(Program *program, const Rule *startRule, RenderContext *ctx)
+{
+    NativeProgram *native = loadNativeProgram(program, startRule);
+    if (!native)
+        return 0;
+    NativeRun run = {ctx, native};
+    NativeHost host = {&run, drawNativePolygon, executeNativeEscape, executeNativeTransformation, setNativePoints,
+                       executeNativeCall};
+    native->start(&host);
+    destroyNativeProgram(native);
+    return 1;
+}
+
+void generateFractal(Program *program, const char *outputFilename, const RenderOptions *options)
 {
     if (!program)
         return;
 
     RenderContext ctx;
+    ctx.startTime = renderClock();
     ctx.width = 1920;
     ctx.height = 1080;
     ctx.minX = -2.0;
     ctx.maxX = 2.0;
     ctx.minY = -2.0;
     ctx.maxY = 2.0;
+    ctx.view = NULL;
     ctx.program = program;
-    ctx.variables = NULL;
+    ctx.options = options;
+    ctx.outputFilename = outputFilename != NULL ? outputFilename : "output.bmp";
+    resetFrames(&ctx);
+    ctx.expansion = NULL;
+    ctx.worker = 0;
+    ctx.ruleThreads = renderThreadCount(options);
+    ctx.lod = options && options->lod;
+    ctx.expressionJit = (!options || options->jit) ? createExpressionJitCache() : NULL;
+    ctx.instances = (!options || options->instancing) ? createInstanceCache() : NULL;
+    SegmentBuffer segments;
+    initSegmentBuffer(&segments);
+    ctx.segments = &segments;
     ctx.bmp = NULL;
     ctx.currentPixelX = 0.0;
     ctx.currentPixelY = 0.0;
@@ -630,8 +883,10 @@ void generateFractal(Program *program, const char *outputFilename)
     ctx.colorEnd.r = 255;
     ctx.colorEnd.g = 255;
     ctx.colorEnd.b = 255;
+    ctx.colorStops = NULL;
+    ctx.colorStopCount = 0;
 
-    char *startRuleName = NULL;
+    Start *start = NULL;
 
     SentenceList *s = program->sentenceList;
     while (s != NULL)
@@ -656,6 +911,7 @@ void generateFractal(Program *program, const char *outputFilename)
                     ctx.maxX = evaluateExpression(sent->view->x->end, &ctx);
                     ctx.minY = evaluateExpression(sent->view->y->start, &ctx);
                     ctx.maxY = evaluateExpression(sent->view->y->end, &ctx);
+                    ctx.view = sent->view;
                 }
                 break;
 
@@ -664,13 +920,21 @@ void generateFractal(Program *program, const char *outputFilename)
                 {
                     ctx.colorStart = parseHexColor(sent->color->startColor);
                     ctx.colorEnd = parseHexColor(sent->color->endColor);
+                    free(ctx.colorStops);
+                    ctx.colorStops = NULL;
+                    ctx.colorStopCount = 0;
+                    for (HexColorList *stop = sent->color->middleColors; stop != NULL; stop = stop->next)
+                    {
+                        ctx.colorStops = realloc(ctx.colorStops, (ctx.colorStopCount + 1) * sizeof(RGBColor));
+                        ctx.colorStops[ctx.colorStopCount++] = parseHexColor(stop->color);
+                    }
                 }
                 break;
 
             case SENTENCE_START:
                 if (sent->start && sent->start->variable)
                 {
-                    startRuleName = sent->start->variable->name;
+                    start = sent->start;
                 }
                 break;
 
@@ -685,19 +949,33 @@ void generateFractal(Program *program, const char *outputFilename)
 
     clearBitmap(ctx.bmp, ctx.colorStart);
 
-    if (startRuleName)
+    if (start && start->rule)
+    {
+        /* El código nativo no poda: con la poda activa, las reglas siempre se interpretan. */
+        if (!options || !options->native || options->lod || !runNativeProgram(program, start->rule, &ctx))
+            executeRule(start->rule, NULL, &ctx);
+    }
+    else if (start)
     {
-        executeRule(startRuleName, NULL, &ctx);
+        logError(_logger, "Runtime Error: No se encontró la regla '%s'", start->variable->name);
     }
     else
     {
         logError(_logger, "No se encontró sentencia START.");
     }
+    flushSegments(&ctx);
+    logDebugging(_logger, "Segmentos rasterizados: %zu, en %.1f ms.", segments.rasterized, segments.rasterTime);
+    freeSegmentBuffer(&segments);
 
-    if (outputFilename == NULL)
+    if (ctx.expressionJit && ctx.expressionJit->compiled > 0)
     {
-        outputFilename = "output.bmp";
+        logDebugging(_logger, "Expresiones compiladas a x86-64: %d.", ctx.expressionJit->compiled);
     }
-    saveBitmap(ctx.bmp, outputFilename);
+    destroyExpressionJitCache(ctx.expressionJit);
+    destroyInstanceCache(ctx.instances);
+    releaseFrames(&ctx);
+
+    saveBitmap(ctx.bmp, ctx.outputFilename);
     destroyBitmap(ctx.bmp);
+    free(ctx.colorStops);
 }
@@ -4,7 +4,9 @@
 #include "../../frontend/syntactic-analysis/AbstractSyntaxTree.h"
 #include "../../support/logging/Logger.h"
 #include "../../support/type/ModuleDestructor.h"
+#include "../../support/type/RenderOptions.h"
 #include "../code-generation/Bitmap.h"
+#include "RenderContext.h"
 
 /** Inicializa el módulo */
 ModuleDestructor initializeInterpreterModule();
@@ -14,7 +16,8 @@ ModuleDestructor initializeInterpreterModule();
  * 1. Configura el lienzo (Size).
  * 2. Configura la vista (View).
  * 3. Ejecuta la regla inicial (Start).
+ * Las opciones de render (threads, etc.) no alteran la imagen resultante.
  */
-void generateFractal(Program * program, const char * outputFilename);
+void generateFractal(Program * program, const char * outputFilename, const RenderOptions * options);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,362 @@
+#include "Jit.h"
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+static void emitByte(JitBuffer *buffer, uint8_t byte)
+{
+    if (buffer->length == buffer->capacity)
+    {
+        buffer->capacity = buffer->capacity ? 2 * buffer->capacity : 256;
+        buffer->bytes = realloc(buffer->bytes, buffer->capacity);
+    }
+    buffer->bytes[buffer->length++] = byte;
+}
+
+static void emitInt32(JitBuffer *buffer, uint32_t value)
+{
+    for (int k = 0; k < 4; k++)
+        emitByte(buffer, (uint8_t)(value >> (8 * k)));
+}
+
+static void emitInt64(JitBuffer *buffer, uint64_t value)
+{
+    for (int k = 0; k < 8; k++)
+        emitByte(buffer, (uint8_t)(value >> (8 * k)));
+}
+
+/* REX con W, R (extiende reg) y B (extiende rm o base); se omite si no hace falta. */
+static void emitRex(JitBuffer *buffer, int wide, int reg, int rm)
+{
+    uint8_t rex = (uint8_t)(0x40 | (wide ? 8 : 0) | ((reg >> 3) & 1) << 2 | ((rm >> 3) & 1));
+    if (rex != 0x40)
+        emitByte(buffer, rex);
+}
+
+static void emitRegisterModRM(JitBuffer *buffer, int reg, int rm)
+{
+    emitByte(buffer, (uint8_t)(0xC0 | (reg & 7) << 3 | (rm & 7)));
+}
+
+/* [base + disp32]; rsp (y r12) como base necesitan un SIB. */
+static void emitMemoryModRM(JitBuffer *buffer, int reg, int base, int32_t displacement)
+{
+    emitByte(buffer, (uint8_t)(0x80 | (reg & 7) << 3 | (base & 7)));
+    if ((base & 7) == JIT_RSP)
+        emitByte(buffer, 0x24);
+    emitInt32(buffer, (uint32_t)displacement);
+}
+
+int jitAvailable(void)
+{
+#if defined(__x86_64__)
+    static int available = -1;
+    if (available < 0)
+    {
+        JitBuffer buffer;
+        JitCode code;
+        initJitBuffer(&buffer);
+        jitRet(&buffer);
+        available = finishJitCode(&buffer, &code);
+        releaseJitCode(&code);
+    }
+    return available;
+#else
+    return 0;
+#endif
+}
+
+int jitAvxAvailable(void)
+{
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+    return jitAvailable() && __builtin_cpu_supports("avx");
+#else
+    return 0;
+#endif
+}
+
+void initJitBuffer(JitBuffer *buffer)
+{
+    memset(buffer, 0, sizeof(JitBuffer));
+}
+
+void freeJitBuffer(JitBuffer *buffer)
+{
+    free(buffer->bytes);
+    memset(buffer, 0, sizeof(JitBuffer));
+}
+
+int finishJitCode(JitBuffer *buffer, JitCode *code)
+{
+    code->entry = NULL;
+    code->length = buffer->length;
+    code->size = 0;
+    long page = sysconf(_SC_PAGESIZE);
+    size_t size = buffer->length;
+    if (page > 0)
+        size = (size + page - 1) / page * page;
+    void *memory = size > 0 ? mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0)
+                            : MAP_FAILED;
+    if (memory != MAP_FAILED)
+    {
+        memcpy(memory, buffer->bytes, buffer->length);
+        if (mprotect(memory, size, PROT_READ | PROT_EXEC) == 0)
+        {
+            code->entry = memory;
+            code->size = size;
+        }
+        else
+        {
+            munmap(memory, size);
+        }
+    }
+    freeJitBuffer(buffer);
+    return code->entry != NULL;
+}
+
+void releaseJitCode(JitCode *code)
+{
+    if (code->entry)
+        munmap(code->entry, code->size);
+    code->entry = NULL;
+    code->length = 0;
+    code->size = 0;
+}
+
+void jitSse(JitBuffer *buffer, uint8_t prefix, uint8_t opcode, int reg, int rm)
+{
+    emitByte(buffer, prefix);
+    emitRex(buffer, 0, reg, rm);
+    emitByte(buffer, 0x0F);
+    emitByte(buffer, opcode);
+    emitRegisterModRM(buffer, reg, rm);
+}
+
+void jitSseMemory(JitBuffer *buffer, uint8_t prefix, uint8_t opcode, int reg, int base, int32_t displacement)
+{
+    emitByte(buffer, prefix);
+    emitRex(buffer, 0, reg, base);
+    emitByte(buffer, 0x0F);
+    emitByte(buffer, opcode);
+    emitMemoryModRM(buffer, reg, base, displacement);
+}
+
+/* VEX de 3 bytes: mapa 0F, W0, 256 bits y prefijo 66; src va invertido en vvvv. */
+static void emitVex(JitBuffer *buffer, int reg, int src, int rm)
+{
+    emitByte(buffer, 0xC4);
+    emitByte(buffer, (uint8_t)((((reg >> 3) & 1) ^ 1) << 7 | 1 << 6 | (((rm >> 3) & 1) ^ 1) << 5 | 0x01));
+    emitByte(buffer, (uint8_t)((~src & 0xF) << 3 | 1 << 2 | 0x01));
+}
+
+void jitAvx(JitBuffer *buffer, uint8_t opcode, int dst, int src, int rm)
+{
+    emitVex(buffer, dst, src, rm);
+    emitByte(buffer, opcode);
+    emitRegisterModRM(buffer, dst, rm);
+}
+
+void jitAvxMemory(JitBuffer *buffer, uint8_t opcode, int dst, int src, int base, int32_t displacement)
+{
+    emitVex(buffer, dst, src, base);
+    emitByte(buffer, opcode);
+    emitMemoryModRM(buffer, dst, base, displacement);
+}
+
+void jitAvxCompare(JitBuffer *buffer, int dst, int src, int rm, uint8_t predicate)
+{
+    jitAvx(buffer, 0xC2, dst, src, rm);
+    emitByte(buffer, predicate);
+}
+
+void jitAvxCompareMemory(JitBuffer *buffer, int dst, int src, int base, int32_t displacement, uint8_t predicate)
+{
+    jitAvxMemory(buffer, 0xC2, dst, src, base, displacement);
+    emitByte(buffer, predicate);
+}
+
+void jitAvxMovemask(JitBuffer *buffer, int gpr, int rm)
+{
+    jitAvx(buffer, 0x50, gpr, 0, rm);
+}
+
+void jitVzeroupper(JitBuffer *buffer)
+{
+    emitByte(buffer, 0xC5);
+    emitByte(buffer, 0xF8);
+    emitByte(buffer, 0x77);
+}
+
+void jitMovqToGpr(JitBuffer *buffer, int gpr, int xmm)
+{
+    emitByte(buffer, 0x66);
+    emitRex(buffer, 1, xmm, gpr);
+    emitByte(buffer, 0x0F);
+    emitByte(buffer, 0x7E);
+    emitRegisterModRM(buffer, xmm, gpr);
+}
+
+void jitMovqToXmm(JitBuffer *buffer, int xmm, int gpr)
+{
+    emitByte(buffer, 0x66);
+    emitRex(buffer, 1, xmm, gpr);
+    emitByte(buffer, 0x0F);
+    emitByte(buffer, 0x6E);
+    emitRegisterModRM(buffer, xmm, gpr);
+}
+
+void jitLoadDouble(JitBuffer *buffer, int xmm, double value)
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    if (bits == 0)
+    {
+        jitSse(buffer, JIT_PD, JIT_XOR, xmm, xmm);
+        return;
+    }
+    jitMovImmediate64(buffer, JIT_RAX, bits);
+    jitMovqToXmm(buffer, xmm, JIT_RAX);
+}
+
+void jitMovImmediate64(JitBuffer *buffer, int gpr, uint64_t value)
+{
+    emitRex(buffer, 1, 0, gpr);
+    emitByte(buffer, (uint8_t)(0xB8 + (gpr & 7)));
+    emitInt64(buffer, value);
+}
+
+void jitMovImmediate32(JitBuffer *buffer, int gpr, uint32_t value)
+{
+    emitRex(buffer, 0, 0, gpr);
+    emitByte(buffer, (uint8_t)(0xB8 + (gpr & 7)));
+    emitInt32(buffer, value);
+}
+
+void jitMov64(JitBuffer *buffer, int dst, int src)
+{
+    emitRex(buffer, 1, src, dst);
+    emitByte(buffer, 0x89);
+    emitRegisterModRM(buffer, src, dst);
+}
+
+void jitMov32(JitBuffer *buffer, int dst, int src)
+{
+    emitRex(buffer, 0, src, dst);
+    emitByte(buffer, 0x89);
+    emitRegisterModRM(buffer, src, dst);
+}
+
+void jitLoad64(JitBuffer *buffer, int dst, int base, int32_t displacement)
+{
+    emitRex(buffer, 1, dst, base);
+    emitByte(buffer, 0x8B);
+    emitMemoryModRM(buffer, dst, base, displacement);
+}
+
+void jitCmp64(JitBuffer *buffer, int a, int b)
+{
+    emitRex(buffer, 1, b, a);
+    emitByte(buffer, 0x39);
+    emitRegisterModRM(buffer, b, a);
+}
+
+void jitCmp32(JitBuffer *buffer, int a, int b)
+{
+    emitRex(buffer, 0, b, a);
+    emitByte(buffer, 0x39);
+    emitRegisterModRM(buffer, b, a);
+}
+
+void jitXor32(JitBuffer *buffer, int dst, int src)
+{
+    emitRex(buffer, 0, src, dst);
+    emitByte(buffer, 0x31);
+    emitRegisterModRM(buffer, src, dst);
+}
+
+void jitTest32(JitBuffer *buffer, int a, int b)
+{
+    emitRex(buffer, 0, b, a);
+    emitByte(buffer, 0x85);
+    emitRegisterModRM(buffer, b, a);
+}
+
+void jitAdd32(JitBuffer *buffer, int dst, int src)
+{
+    emitRex(buffer, 0, src, dst);
+    emitByte(buffer, 0x01);
+    emitRegisterModRM(buffer, src, dst);
+}
+
+void jitInc32(JitBuffer *buffer, int gpr)
+{
+    emitRex(buffer, 0, 0, gpr);
+    emitByte(buffer, 0xFF);
+    emitRegisterModRM(buffer, 0, gpr);
+}
+
+void jitAddImmediate64(JitBuffer *buffer, int gpr, int32_t value)
+{
+    emitRex(buffer, 1, 0, gpr);
+    emitByte(buffer, 0x81);
+    emitRegisterModRM(buffer, 0, gpr);
+    emitInt32(buffer, (uint32_t)value);
+}
+
+void jitPush(JitBuffer *buffer, int gpr)
+{
+    emitRex(buffer, 0, 0, gpr);
+    emitByte(buffer, (uint8_t)(0x50 + (gpr & 7)));
+}
+
+void jitPop(JitBuffer *buffer, int gpr)
+{
+    emitRex(buffer, 0, 0, gpr);
+    emitByte(buffer, (uint8_t)(0x58 + (gpr & 7)));
+}
+
+void jitCall(JitBuffer *buffer, int gpr)
+{
+    emitRex(buffer, 0, 0, gpr);
+    emitByte(buffer, 0xFF);
+    emitRegisterModRM(buffer, 2, gpr);
+}
+
+void jitRet(JitBuffer *buffer)
+{
+    emitByte(buffer, 0xC3);
+}
+
+size_t jitJump(JitBuffer *buffer)
+{
+    emitByte(buffer, 0xE9);
+    emitInt32(buffer, 0);
+    return buffer->length;
+}
+
+size_t jitJumpIf(JitBuffer *buffer, int condition)
+{
+    emitByte(buffer, 0x0F);
+    emitByte(buffer, (uint8_t)(0x80 | condition));
+    emitInt32(buffer, 0);
+    return buffer->length;
+}
+
+void jitJumpTo(JitBuffer *buffer, size_t target)
+{
+    size_t position = jitJump(buffer);
+    memcpy(buffer->bytes + position - 4, &(int32_t){(int32_t)(target - position)}, 4);
+}
+
+void jitJumpIfTo(JitBuffer *buffer, int condition, size_t target)
+{
+    size_t position = jitJumpIf(buffer, condition);
+    memcpy(buffer->bytes + position - 4, &(int32_t){(int32_t)(target - position)}, 4);
+}
+
+void jitPatch(JitBuffer *buffer, size_t position)
+{
+    memcpy(buffer->bytes + position - 4, &(int32_t){(int32_t)(buffer->length - position)}, 4);
+}
@@ -0,0 +1,151 @@
+#ifndef JIT_HEADER
+#define JIT_HEADER
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Ensamblador mínimo de x86-64 (SSE2 escalar y AVX empaquetado en double, y
+ * lo poco de enteros que hace falta alrededor) para los compiladores a código
+ * nativo. El código se arma en memoria común y se copia a páginas
+ * ejecutables al terminar, que nunca son escribibles y ejecutables a la vez.
+ */
+
+/* Registros de propósito general (la numeración es la de la codificación). */
+#define JIT_RAX 0
+#define JIT_RCX 1
+#define JIT_RDX 2
+#define JIT_RBX 3
+#define JIT_RSP 4
+#define JIT_RSI 6
+#define JIT_RDI 7
+#define JIT_R8 8
+#define JIT_R9 9
+#define JIT_R10 10
+#define JIT_R11 11
+
+/* Opcodes SSE2 (después de 0F) con su prefijo obligatorio. */
+#define JIT_SD 0xF2
+#define JIT_PD 0x66
+#define JIT_MOVSD_LOAD 0x10
+#define JIT_MOVSD_STORE 0x11
+#define JIT_MOVAPD 0x28
+#define JIT_UCOMISD 0x2E
+#define JIT_SQRT 0x51
+#define JIT_AND 0x54
+#define JIT_XOR 0x57
+#define JIT_ADD 0x58
+#define JIT_MUL 0x59
+#define JIT_SUB 0x5C
+#define JIT_DIV 0x5E
+
+/* Opcodes AVX (mapa 0F, prefijo 66) de las operaciones empaquetadas en double. */
+#define JIT_MOVUPD_LOAD 0x10
+#define JIT_MOVUPD_STORE 0x11
+#define JIT_ANDN 0x55
+#define JIT_OR 0x56
+
+/* Predicados de vcmppd. */
+#define JIT_CMP_LT 0x01
+#define JIT_CMP_NEQ 0x04
+#define JIT_CMP_GE 0x0D
+
+/* Condiciones de los saltos (el cuarto nibble de 0F 8x). */
+#define JIT_JP 0xA
+#define JIT_JNE 0x5
+#define JIT_JE 0x4
+#define JIT_JBE 0x6
+#define JIT_JA 0x7
+#define JIT_JGE 0xD
+
+typedef struct
+{
+    uint8_t *bytes;
+    size_t length;
+    size_t capacity;
+} JitBuffer;
+
+/** Código nativo ya copiado a páginas ejecutables. */
+typedef struct
+{
+    void *entry;
+    /* Bytes de código generados y tamaño de la zona mapeada (redondeado a páginas). */
+    size_t length;
+    size_t size;
+} JitCode;
+
+/** Si el proceso puede generar código nativo (x86-64 y el sistema da páginas ejecutables). */
+int jitAvailable(void);
+
+/** Si además el procesador tiene AVX, para las operaciones empaquetadas en registros ymm. */
+int jitAvxAvailable(void);
+
+void initJitBuffer(JitBuffer *buffer);
+void freeJitBuffer(JitBuffer *buffer);
+
+/**
+ * Copia el código a páginas ejecutables y libera el buffer. Devuelve 0 (con
+ * code->entry en NULL) si el sistema no las da.
+ */
+int finishJitCode(JitBuffer *buffer, JitCode *code);
+
+void releaseJitCode(JitCode *code);
+
+/* Operación SSE2 entre registros: xmm[reg] op= xmm[rm]. */
+void jitSse(JitBuffer *buffer, uint8_t prefix, uint8_t opcode, int reg, int rm);
+
+/* Operación SSE2 con memoria: xmm[reg] op= [base + displacement] (o la inversa, para los stores). */
+void jitSseMemory(JitBuffer *buffer, uint8_t prefix, uint8_t opcode, int reg, int base, int32_t displacement);
+
+/* Operación AVX de 256 bits entre registros: ymm[dst] = ymm[src] op ymm[rm]. */
+void jitAvx(JitBuffer *buffer, uint8_t opcode, int dst, int src, int rm);
+
+/* Lo mismo con el segundo operando (o el destino, en los stores) en [base + displacement]. */
+void jitAvxMemory(JitBuffer *buffer, uint8_t opcode, int dst, int src, int base, int32_t displacement);
+
+/* ymm[dst] = máscara de "ymm[src] predicate ymm[rm]", lane por lane. */
+void jitAvxCompare(JitBuffer *buffer, int dst, int src, int rm, uint8_t predicate);
+void jitAvxCompareMemory(JitBuffer *buffer, int dst, int src, int base, int32_t displacement, uint8_t predicate);
+
+/* Bits de signo de los lanes de ymm[rm] en un registro entero. */
+void jitAvxMovemask(JitBuffer *buffer, int gpr, int rm);
+
+/* Antes de volver a código SSE, para no pagar la transición. */
+void jitVzeroupper(JitBuffer *buffer);
+
+/* movq entre un xmm y un registro de 64 bits, en cualquiera de los dos sentidos. */
+void jitMovqToGpr(JitBuffer *buffer, int gpr, int xmm);
+void jitMovqToXmm(JitBuffer *buffer, int xmm, int gpr);
+
+/* Carga en un xmm el double exacto (los bits pasan por rax). */
+void jitLoadDouble(JitBuffer *buffer, int xmm, double value);
+
+/* Operaciones de enteros. */
+void jitMovImmediate64(JitBuffer *buffer, int gpr, uint64_t value);
+void jitMovImmediate32(JitBuffer *buffer, int gpr, uint32_t value);
+void jitMov64(JitBuffer *buffer, int dst, int src);
+void jitMov32(JitBuffer *buffer, int dst, int src);
+void jitLoad64(JitBuffer *buffer, int dst, int base, int32_t displacement);
+void jitCmp64(JitBuffer *buffer, int a, int b);
+void jitCmp32(JitBuffer *buffer, int a, int b);
+void jitXor32(JitBuffer *buffer, int dst, int src);
+void jitTest32(JitBuffer *buffer, int a, int b);
+void jitAdd32(JitBuffer *buffer, int dst, int src);
+void jitInc32(JitBuffer *buffer, int gpr);
+void jitAddImmediate64(JitBuffer *buffer, int gpr, int32_t value);
+void jitPush(JitBuffer *buffer, int gpr);
+void jitPop(JitBuffer *buffer, int gpr);
+void jitCall(JitBuffer *buffer, int gpr);
+void jitRet(JitBuffer *buffer);
+
+/*
+ * Saltos con destino de 32 bits. Los que van hacia adelante devuelven la
+ * posición a completar con jitPatch cuando se conoce el destino.
+ */
+size_t jitJump(JitBuffer *buffer);
+size_t jitJumpIf(JitBuffer *buffer, int condition);
+void jitJumpTo(JitBuffer *buffer, size_t target);
+void jitJumpIfTo(JitBuffer *buffer, int condition, size_t target);
+void jitPatch(JitBuffer *buffer, size_t position);
+
+#endif
@@ -0,0 +1,399 @@
+#include "NativeGenerator.h"
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct
+{
+    const Rule *rule;
+    int index;
+} RuleIndex;
+
+typedef struct
+{
+    NativeSource *source;
+    size_t capacity;
+    Rule **rules;
+    int ruleCount;
+    /* Las reglas ordenadas por dirección, para encontrar su número sin recorrerlas todas. */
+    RuleIndex *indices;
+    const char *failure;
+} NativeGenerator;
+
+static void emit(NativeGenerator *generator, const char *format, ...)
+{
+    NativeSource *source = generator->source;
+    for (;;)
+    {
+        va_list arguments;
+        va_start(arguments, format);
+        size_t available = generator->capacity - source->length;
+        int written = vsnprintf(source->code + source->length, available, format, arguments);
+        va_end(arguments);
+        if (written < 0)
+            return;
+        if ((size_t)written < available)
+        {
+            source->length += written;
+            return;
+        }
+        generator->capacity = 2 * generator->capacity + written;
+        source->code = realloc(source->code, generator->capacity);
+    }
+}
+
+static int compareRuleIndices(const void *left, const void *right)
+{
+    uintptr_t a = (uintptr_t)((const RuleIndex *)left)->rule;
+    uintptr_t b = (uintptr_t)((const RuleIndex *)right)->rule;
+    return (a > b) - (a < b);
+}
+
+/* Número de función de la regla (ya resuelta por el validador), o -1. */
+static int findRule(NativeGenerator *generator, const Rule *rule)
+{
+    RuleIndex key = {rule, -1};
+    RuleIndex *found = rule ? bsearch(&key, generator->indices, generator->ruleCount, sizeof(RuleIndex),
+                                      compareRuleIndices)
+                            : NULL;
+    return found ? found->index : -1;
+}
+
+static void emitExpression(NativeGenerator *generator, const Rule *rule, const Expression *expr);
+
+static void emitFactor(NativeGenerator *generator, const Rule *rule, const Factor *factor)
+{
+    switch (factor ? factor->type : RANGE)
+    {
+    case CONSTANT:
+        emit(generator, "(%d.0)", factor->constant->value);
+        break;
+    case DOUBLE_CONSTANT:
+        /* En hexadecimal, el literal es exactamente el mismo double. */
+        emit(generator, "(%a)", factor->doubleConstant->value);
+        break;
+    case VARIABLE:
+    {
+        /* El validador ya resolvió el lugar del parámetro, que es su posición en la firma. */
+        int index = factor->variable->slot;
+        if (index < 0)
+        {
+            generator->failure = "una expresión usa una variable que no es parámetro de su regla";
+            emit(generator, "0.0");
+        }
+        else
+        {
+            emit(generator, "p%d", index);
+        }
+        break;
+    }
+    case EXPRESSION:
+        emitExpression(generator, rule, factor->expression);
+        break;
+    case X_COORD_FACTOR:
+    case Y_COORD_FACTOR:
+        generator->failure = "una expresión de regla usa las coordenadas del píxel";
+        emit(generator, "0.0");
+        break;
+    default:
+        emit(generator, "0.0");
+        break;
+    }
+}
+
+static void emitExpression(NativeGenerator *generator, const Rule *rule, const Expression *expr)
+{
+    if (!expr)
+    {
+        emit(generator, "0.0");
+        return;
+    }
+
+    const char *symbol = NULL;
+    switch (expr->type)
+    {
+    case FACTOR:
+        emitFactor(generator, rule, expr->factor);
+        return;
+    case ABSOLUTE_VALUE:
+        emit(generator, "fabs(");
+        emitExpression(generator, rule, expr->leftExpression);
+        emit(generator, ")");
+        return;
+    case DIVISION:
+        emit(generator, "divide(");
+        emitExpression(generator, rule, expr->leftExpression);
+        emit(generator, ", ");
+        emitExpression(generator, rule, expr->rightExpression);
+        emit(generator, ")");
+        return;
+    case ADDITION:
+        symbol = "+";
+        break;
+    case SUBTRACTION:
+        symbol = "-";
+        break;
+    case MULTIPLICATION:
+        symbol = "*";
+        break;
+    case LOWER_THAN_OP:
+        symbol = "<";
+        break;
+    case GREATER_THAN_OP:
+        symbol = ">";
+        break;
+    default:
+        emit(generator, "0.0");
+        return;
+    }
+
+    /* Las comparaciones dan 1.0 o 0.0, como en el intérprete. */
+    int comparison = expr->type == LOWER_THAN_OP || expr->type == GREATER_THAN_OP;
+    emit(generator, comparison ? "(double)(" : "(");
+    emitExpression(generator, rule, expr->leftExpression);
+    emit(generator, " %s ", symbol);
+    emitExpression(generator, rule, expr->rightExpression);
+    emit(generator, ")");
+}
+
+static void emitSignature(NativeGenerator *generator, int index)
+{
+    emit(generator, "static void rule_%d(const NativeHost *host, int depth", index);
+    int count = generator->rules[index]->parameterCount;
+    for (int k = 0; k < count; k++)
+        emit(generator, ", double p%d", k);
+    emit(generator, ")");
+}
+
+static void emitPolygon(NativeGenerator *generator, const Rule *rule, const Polygon *polygon)
+{
+    if (!polygon || !polygon->pointList)
+        return;
+    int count = 0;
+    for (PointList *list = polygon->pointList; list; list = list->next)
+        count++;
+
+    emit(generator, "    {\n        const double xs[%d] = {", count);
+    for (PointList *list = polygon->pointList; list; list = list->next)
+    {
+        emitExpression(generator, rule, list->point->x);
+        emit(generator, list->next ? ", " : "};\n");
+    }
+    emit(generator, "        const double ys[%d] = {", count);
+    for (PointList *list = polygon->pointList; list; list = list->next)
+    {
+        emitExpression(generator, rule, list->point->y);
+        emit(generator, list->next ? ", " : "};\n");
+    }
+    emit(generator, "        host->polygon(host->ctx, %d, xs, ys);\n    }\n", count);
+}
+
+/*
+ * Los argumentos de más se evalúan en el intérprete y se descartan; como no
+ * tienen efectos, no se emiten. Pasando NATIVE_MAX_DEPTH llamadas anidadas,
+ * la regla la ejecuta el intérprete, para que la recursión profunda no
+ * desborde la pila de C.
+ */
+static void emitCall(NativeGenerator *generator, const Rule *rule, const Call *call)
+{
+    int callee = findRule(generator, call->rule);
+    if (callee < 0)
+    {
+        generator->failure = "se llama a una regla que no existe";
+        return;
+    }
+    int count = generator->rules[callee]->parameterCount;
+    if (count == 0)
+    {
+        emit(generator, "    if (depth < %d)\n        rule_%d(host, depth + 1);\n", NATIVE_MAX_DEPTH, callee);
+        emit(generator, "    else\n        host->call(host->ctx, %d, 0);\n", callee);
+        return;
+    }
+    emit(generator, "    {\n        const double arguments[%d] = {", count);
+    ExpressionList *argument = call->expressionList;
+    for (int k = 0; k < count; k++, argument = argument->next)
+    {
+        if (!argument)
+        {
+            generator->failure = "una llamada tiene menos argumentos que parámetros";
+            return;
+        }
+        emitExpression(generator, rule, argument->expression);
+        emit(generator, k + 1 < count ? ", " : "};\n");
+    }
+    emit(generator, "        if (depth < %d)\n            rule_%d(host, depth + 1", NATIVE_MAX_DEPTH, callee);
+    for (int k = 0; k < count; k++)
+        emit(generator, ", arguments[%d]", k);
+    emit(generator, ");\n        else\n            host->call(host->ctx, %d, arguments);\n    }\n", callee);
+}
+
+static void emitEscape(NativeGenerator *generator, Rule *rule, Escape *escape)
+{
+    NativeSource *source = generator->source;
+    int index = source->escapeCount++;
+    source->escapes = realloc(source->escapes, source->escapeCount * sizeof(Escape *));
+    source->escapeRules = realloc(source->escapeRules, source->escapeCount * sizeof(Rule *));
+    source->escapes[index] = escape;
+    source->escapeRules[index] = rule;
+
+    int count = rule->parameterCount;
+    if (count == 0)
+    {
+        emit(generator, "    host->escape(host->ctx, %d, 0);\n", index);
+        return;
+    }
+    emit(generator, "    {\n        const double parameters[%d] = {", count);
+    for (int k = 0; k < count; k++)
+        emit(generator, k + 1 < count ? "p%d, " : "p%d};\n", k);
+    emit(generator, "        host->escape(host->ctx, %d, parameters);\n    }\n", index);
+}
+
+static void emitTransformation(NativeGenerator *generator, Transformation *transformation)
+{
+    NativeSource *source = generator->source;
+    int index = source->transformationCount++;
+    source->transformations = realloc(source->transformations, source->transformationCount * sizeof(Transformation *));
+    source->transformations[index] = transformation;
+    emit(generator, "    host->transformation(host->ctx, %d);\n", index);
+}
+
+static void emitRule(NativeGenerator *generator, int index)
+{
+    Rule *rule = generator->rules[index];
+    /* Las funciones sólo reciben sus parámetros, así que no ven los de quien llamó. */
+    if (rule->callerVariables)
+    {
+        generator->failure = "una regla lee variables de las reglas que la llaman";
+        return;
+    }
+    emit(generator, "\n/* %s */\n", rule->variable->name);
+    emitSignature(generator, index);
+    emit(generator, "\n{\n");
+    for (RuleSentenceList *list = rule->ruleSentenceList; list; list = list->next)
+    {
+        RuleSentence *rs = list->ruleSentence;
+        if (!rs)
+            continue;
+        switch (rs->ruleSentenceType)
+        {
+        case RULE_SENTENCE_POLYGON:
+            emitPolygon(generator, rule, rs->polygon);
+            break;
+        case RULE_SENTENCE_CALL:
+            if (rs->call && rs->call->variable)
+                emitCall(generator, rule, rs->call);
+            break;
+        case RULE_SENTENCE_ESCAPE:
+            emitEscape(generator, rule, rs->escape);
+            break;
+        case RULE_SENTENCE_TRANSFORMATION:
+            emitTransformation(generator, rs->transformation);
+            break;
+        case RULE_SENTENCE_POINTS_STATEMENT:
+            if (rs->pointsStatement && rs->pointsStatement->numPoints)
+                emit(generator, "    host->points(host->ctx, %d);\n", rs->pointsStatement->numPoints->value);
+            break;
+        case RULE_SENTENCE_IF:
+            if (rs->ifStatement && rs->ifStatement->condition)
+            {
+                emit(generator, "    if (");
+                emitExpression(generator, rule, rs->ifStatement->condition);
+                emit(generator, " != 0.0)\n        return;\n");
+            }
+            break;
+        default:
+            break;
+        }
+    }
+    emit(generator, "}\n");
+}
+
+static const char *PROLOGUE = "/* Generado por Fractalang a partir del programa: no editar. */\n"
+                              "#include <math.h>\n"
+                              "\n"
+                              "typedef struct\n"
+                              "{\n"
+                              "    void *ctx;\n"
+                              "    void (*polygon)(void *ctx, int count, const double *xs, const double *ys);\n"
+                              "    void (*escape)(void *ctx, int index, const double *parameters);\n"
+                              "    void (*transformation)(void *ctx, int index);\n"
+                              "    void (*points)(void *ctx, int count);\n"
+                              "    void (*call)(void *ctx, int index, const double *parameters);\n"
+                              "} NativeHost;\n"
+                              "\n"
+                              "static double divide(double left, double right)\n"
+                              "{\n"
+                              "    return right != 0.0 ? left / right : 0.0;\n"
+                              "}\n";
+
+NativeSource *generateNativeSource(Program *program, const Rule *startRule, const char **reason)
+{
+    NativeGenerator generator;
+    memset(&generator, 0, sizeof(generator));
+    generator.source = calloc(1, sizeof(NativeSource));
+    generator.capacity = 4096;
+    generator.source->code = malloc(generator.capacity);
+    generator.source->code[0] = '\0';
+
+    for (SentenceList *s = program->sentenceList; s; s = s->next)
+    {
+        if (s->sentence && s->sentence->sentenceType == SENTENCE_RULE && s->sentence->rule &&
+            s->sentence->rule->variable)
+        {
+            generator.rules = realloc(generator.rules, (generator.ruleCount + 1) * sizeof(Rule *));
+            generator.rules[generator.ruleCount++] = s->sentence->rule;
+        }
+    }
+    generator.indices = malloc((generator.ruleCount + 1) * sizeof(RuleIndex));
+    for (int k = 0; k < generator.ruleCount; k++)
+    {
+        generator.indices[k].rule = generator.rules[k];
+        generator.indices[k].index = k;
+    }
+    qsort(generator.indices, generator.ruleCount, sizeof(RuleIndex), compareRuleIndices);
+
+    int start = findRule(&generator, startRule);
+    if (start < 0)
+        generator.failure = "no existe la regla de \"start:\"";
+
+    emit(&generator, "%s", PROLOGUE);
+    emit(&generator, "\n");
+    for (int k = 0; k < generator.ruleCount; k++)
+    {
+        emitSignature(&generator, k);
+        emit(&generator, ";\n");
+    }
+    for (int k = 0; k < generator.ruleCount && !generator.failure; k++)
+        emitRule(&generator, k);
+
+    /* Sin argumentos, los parámetros de la regla inicial valen 0.0. */
+    emit(&generator, "\nvoid %s(const NativeHost *host)\n{\n    rule_%d(host, 0", NATIVE_START_SYMBOL, start);
+    for (int k = 0; start >= 0 && k < generator.rules[start]->parameterCount; k++)
+        emit(&generator, ", 0.0");
+    emit(&generator, ");\n}\n");
+
+    generator.source->rules = generator.rules;
+    generator.source->ruleCount = generator.ruleCount;
+    free(generator.indices);
+    if (generator.failure)
+    {
+        *reason = generator.failure;
+        destroyNativeSource(generator.source);
+        return NULL;
+    }
+    return generator.source;
+}
+
+void destroyNativeSource(NativeSource *source)
+{
+    if (!source)
+        return;
+    free(source->code);
+    free(source->escapes);
+    free(source->escapeRules);
+    free(source->transformations);
+    free(source->rules);
+    free(source);
+}
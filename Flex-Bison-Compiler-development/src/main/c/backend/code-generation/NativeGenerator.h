@@ -0,0 +1,67 @@
+#ifndef NATIVE_GENERATOR_HEADER
+#define NATIVE_GENERATOR_HEADER
+
+#include "../../frontend/syntactic-analysis/AbstractSyntaxTree.h"
+
+/*
+ * Llamadas anidadas que hace el código generado con la pila de C; las más
+ * profundas las ejecuta el intérprete (ver NativeHost.call), que no la usa.
+ */
+#define NATIVE_MAX_DEPTH 4096
+
+/*
+ * Lo que el código generado le pide al intérprete: dibujar un polígono (en
+ * coordenadas del view), ejecutar el escape o la transformación número
+ * "index" (en el orden de NativeSource), cambiar la cantidad de puntos del
+ * juego del caos y, pasando NATIVE_MAX_DEPTH, ejecutar la regla número
+ * "index" entera. Los escapes y las reglas reciben los valores de todos los
+ * parámetros de la regla, en orden.
+ */
+typedef struct
+{
+    void *ctx;
+    void (*polygon)(void *ctx, int count, const double *xs, const double *ys);
+    void (*escape)(void *ctx, int index, const double *parameters);
+    void (*transformation)(void *ctx, int index);
+    void (*points)(void *ctx, int count);
+    void (*call)(void *ctx, int index, const double *parameters);
+} NativeHost;
+
+/* Función exportada por el código generado, que ejecuta la regla de "start:". */
+#define NATIVE_START_SYMBOL "fractalangStart"
+typedef void (*NativeStartFunction)(const NativeHost *host);
+
+/**
+ * Traducción a C del programa: cada regla es una función con sus parámetros
+ * como argumentos double, las expresiones son expresiones de C con las mismas
+ * operaciones que evaluateExpression, y cada "call:" es una llamada directa
+ * hasta NATIVE_MAX_DEPTH.
+ * Los escapes y las transformaciones se siguen ejecutando en el intérprete
+ * (ver NativeHost), que ya los itera con los kernels, SIMD y el JIT.
+ */
+typedef struct
+{
+    char *code;
+    size_t length;
+    Escape **escapes;
+    Rule **escapeRules;
+    int escapeCount;
+    Transformation **transformations;
+    int transformationCount;
+    /* Las reglas, en el orden de sus funciones (rule_0, rule_1...). */
+    Rule **rules;
+    int ruleCount;
+} NativeSource;
+
+/**
+ * Genera el código del programa, empezando por la regla startRule.
+ * Devuelve NULL, con el motivo en *reason, si el programa depende de algo que
+ * el código generado no reproduce exactamente: llamadas a reglas que no
+ * existen, o con menos argumentos que parámetros (los que faltan se buscan en
+ * las reglas que llamaron).
+ */
+NativeSource *generateNativeSource(Program *program, const Rule *startRule, const char **reason);
+
+void destroyNativeSource(NativeSource *source);
+
+#endif
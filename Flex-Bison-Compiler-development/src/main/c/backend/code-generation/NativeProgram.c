@@ -0,0 +1,228 @@
+#include "NativeProgram.h"
+#include "../../support/configuration/Environment.h"
+#include <dlfcn.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <spawn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+extern char **environ;
+
+static Logger *_logger = NULL;
+
+void _shutdownNativeProgramModule()
+{
+    if (_logger != NULL)
+    {
+        destroyLogger(_logger);
+        _logger = NULL;
+    }
+}
+
+ModuleDestructor initializeNativeProgramModule()
+{
+    _logger = createLogger("NativeProgram");
+    return _shutdownNativeProgramModule;
+}
+
+/*
+ * FNV-1a de 64 bits del código generado, que también incluye la interfaz con
+ * el intérprete, y del compilador con sus opciones: otro $CC no reusa la
+ * biblioteca.
+ */
+static uint64_t hashSource(const NativeSource *source, const char *compiler)
+{
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t k = 0; k < source->length; k++)
+    {
+        hash ^= (unsigned char)source->code[k];
+        hash *= 1099511628211ull;
+    }
+    /* Incluye el 0 final, que separa el compilador del código. */
+    for (const char *character = compiler;; character++)
+    {
+        hash ^= (unsigned char)*character;
+        hash *= 1099511628211ull;
+        if (*character == '\0')
+            break;
+    }
+    return hash;
+}
+
+/*
+ * Directorio de la caché (se crea si no existe, con permisos 0700), o NULL. Se
+ * libera con free. Como se cargan con dlopen las bibliotecas que encuentra, el
+ * directorio tiene que ser del usuario y nadie más puede escribir en él: en el
+ * /tmp compartido, otro usuario podría haberlo creado antes.
+ */
+static char *cacheDirectory(void)
+{
+    const char *base = getStringOrDefault("XDG_CACHE_HOME", NULL);
+    const char *suffix = "/fractalang";
+    if (base == NULL || base[0] == '\0')
+    {
+        base = getStringOrDefault("HOME", NULL);
+        suffix = "/.cache/fractalang";
+    }
+    if (base == NULL || base[0] == '\0')
+    {
+        base = "/tmp";
+        suffix = "/fractalang";
+    }
+
+    size_t length = strlen(base) + strlen(suffix) + 1;
+    char *directory = malloc(length);
+    snprintf(directory, length, "%s%s", base, suffix);
+    /* Como "mkdir -p": cada prefijo que termina en '/' y el directorio completo. */
+    for (char *slash = strchr(directory + 1, '/');; slash = strchr(slash + 1, '/'))
+    {
+        if (slash)
+            *slash = '\0';
+        if (mkdir(directory, 0700) != 0 && errno != EEXIST)
+        {
+            free(directory);
+            return NULL;
+        }
+        if (!slash)
+            break;
+        *slash = '/';
+    }
+
+    struct stat status;
+    if (lstat(directory, &status) != 0 || !S_ISDIR(status.st_mode) || status.st_uid != geteuid() ||
+        (status.st_mode & (S_IWGRP | S_IWOTH)) != 0)
+    {
+        logWarning(_logger, "El directorio %s no es del usuario o otros pueden escribir en él.", directory);
+        free(directory);
+        return NULL;
+    }
+    return directory;
+}
+
+static char *cachePath(const char *directory, uint64_t hash, const char *suffix)
+{
+    size_t length = strlen(directory) + strlen(suffix) + 40;
+    char *path = malloc(length);
+    snprintf(path, length, "%s/%016" PRIx64 "%s", directory, hash, suffix);
+    return path;
+}
+
+/* Compila el código a una biblioteca en "library", pasando por archivos temporales. */
+static int compileSource(const NativeSource *source, const char *compiler, const char *directory, uint64_t hash,
+                         const char *library)
+{
+    char suffix[64];
+    snprintf(suffix, sizeof(suffix), ".%ld.c", (long)getpid());
+    char *code = cachePath(directory, hash, suffix);
+    snprintf(suffix, sizeof(suffix), ".%ld.so", (long)getpid());
+    char *object = cachePath(directory, hash, suffix);
+
+    FILE *file = fopen(code, "wb");
+    int ok = file != NULL;
+    if (file)
+    {
+        ok = fwrite(source->code, 1, source->length, file) == source->length;
+        ok = fclose(file) == 0 && ok;
+    }
+
+    /*
+     * Sin contracciones a FMA, cada operación redondea igual que en el
+     * intérprete. $CC pasa por sh sin comillas, como en make, así que puede
+     * traer su propio prefijo y opciones ("ccache gcc", "gcc -m64").
+     */
+    char *arguments[] = {"sh", "-c", "compiler=$1; shift; exec $compiler \"$@\"", "sh", (char *)compiler,
+                         "-std=c99", "-O3", "-ffp-contract=off", "-fPIC", "-shared",
+                         "-o", object, code, "-lm", NULL};
+    pid_t pid;
+    int status = 0;
+    ok = ok && posix_spawn(&pid, "/bin/sh", NULL, NULL, arguments, environ) == 0;
+    ok = ok && waitpid(pid, &status, 0) == pid && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    if (!ok)
+        logWarning(_logger, "No se pudo compilar %s con \"%s\".", code, compiler);
+
+    /* El código queda al lado de la biblioteca, para poder leerlo. */
+    char *kept = cachePath(directory, hash, ".c");
+    ok = ok && rename(object, library) == 0;
+    if (!ok || rename(code, kept) != 0)
+        remove(code);
+    remove(object);
+    free(kept);
+    free(code);
+    free(object);
+    return ok;
+}
+
+NativeProgram *loadNativeProgram(Program *program, const Rule *startRule)
+{
+    const char *reason = NULL;
+    NativeSource *source = generateNativeSource(program, startRule, &reason);
+    if (!source)
+    {
+        logInformation(_logger, "El programa no se compila a código nativo: %s.", reason);
+        return NULL;
+    }
+
+    const char *compiler = getStringOrDefault("CC", "cc");
+    uint64_t hash = hashSource(source, compiler);
+    char *directory = cacheDirectory();
+    if (!directory)
+    {
+        logWarning(_logger, "No se pudo usar el directorio de la caché de programas compilados.");
+        destroyNativeSource(source);
+        return NULL;
+    }
+    char *library = cachePath(directory, hash, ".so");
+
+    if (access(library, R_OK) == 0)
+    {
+        logInformation(_logger, "Programa compilado en la caché: %s.", library);
+    }
+    else
+    {
+        struct timespec begin, end;
+        clock_gettime(CLOCK_MONOTONIC, &begin);
+        if (compileSource(source, compiler, directory, hash, library))
+        {
+            clock_gettime(CLOCK_MONOTONIC, &end);
+            logInformation(_logger, "Programa compilado a %s en %.0f ms.", library,
+                           (end.tv_sec - begin.tv_sec) * 1000.0 + (end.tv_nsec - begin.tv_nsec) / 1e6);
+        }
+    }
+
+    NativeProgram *native = NULL;
+    void *handle = dlopen(library, RTLD_NOW | RTLD_LOCAL);
+    void *start = handle ? dlsym(handle, NATIVE_START_SYMBOL) : NULL;
+    if (start)
+    {
+        native = calloc(1, sizeof(NativeProgram));
+        native->source = source;
+        native->library = handle;
+        native->start = (NativeStartFunction)start;
+    }
+    else
+    {
+        logWarning(_logger, "No se pudo cargar %s (%s): se usa el intérprete.", library,
+                   handle ? "falta " NATIVE_START_SYMBOL : dlerror());
+        if (handle)
+            dlclose(handle);
+        destroyNativeSource(source);
+    }
+    free(library);
+    free(directory);
+    return native;
+}
+
+void destroyNativeProgram(NativeProgram *native)
+{
+    if (!native)
+        return;
+    dlclose(native->library);
+    destroyNativeSource(native->source);
+    free(native);
+}
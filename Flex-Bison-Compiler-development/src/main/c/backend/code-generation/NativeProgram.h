@@ -0,0 +1,35 @@
+#ifndef NATIVE_PROGRAM_HEADER
+#define NATIVE_PROGRAM_HEADER
+
+#include "../../frontend/syntactic-analysis/AbstractSyntaxTree.h"
+#include "../../support/logging/Logger.h"
+#include "../../support/type/ModuleDestructor.h"
+#include "NativeGenerator.h"
+
+/**
+ * El programa traducido a C (ver NativeGenerator.h), compilado con el
+ * compilador del sistema ($CC, o "cc") y cargado con dlopen. La biblioteca se
+ * guarda en ${XDG_CACHE_HOME:-$HOME/.cache}/fractalang con el hash del código
+ * generado como nombre, así que volver a renderizar el mismo programa (con
+ * otro tamaño, view o colores, que no están en el código) no recompila.
+ */
+typedef struct
+{
+    NativeSource *source;
+    void *library;
+    NativeStartFunction start;
+} NativeProgram;
+
+/** Inicializa el módulo */
+ModuleDestructor initializeNativeProgramModule();
+
+/**
+ * Genera, compila (o encuentra en la caché) y carga el programa. Devuelve
+ * NULL si el programa no se puede traducir o no se pudo compilar o cargar: se
+ * sigue con el intérprete.
+ */
+NativeProgram *loadNativeProgram(Program *program, const Rule *startRule);
+
+void destroyNativeProgram(NativeProgram *native);
+
+#endif
@@ -0,0 +1,141 @@
+#include "Palette.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Interpola linealmente entre dos colores (t va de 0.0 a 1.0)
+static RGBColor interpolateColor(RGBColor c1, RGBColor c2, double t)
+{
+    RGBColor res;
+    if (t < 0.0)
+        t = 0.0;
+    if (t > 1.0)
+        t = 1.0;
+
+    res.r = (uint8_t)(c1.r + (c2.r - c1.r) * t);
+    res.g = (uint8_t)(c1.g + (c2.g - c1.g) * t);
+    res.b = (uint8_t)(c1.b + (c2.b - c1.b) * t);
+    return res;
+}
+
+/*
+ * Color del gradiente en t (de 0.0 a 1.0). Con dos colores el tramo es todo
+ * el gradiente y t se usa tal cual, así que coincide con interpolar los dos.
+ */
+static RGBColor gradientColor(const Palette *palette, double t)
+{
+    double position = t * (palette->stopCount - 1);
+    int k = (int)position;
+    if (k > palette->stopCount - 2)
+        k = palette->stopCount - 2;
+    if (k < 0)
+        k = 0;
+    return interpolateColor(palette->stops[k], palette->stops[k + 1], position - k);
+}
+
+RGBColor computePaletteColor(const Palette *palette, int iter)
+{
+    if (iter >= palette->maxIter)
+        return palette->stops[palette->stopCount - 1];
+    return gradientColor(palette, sqrt((double)iter / (double)palette->maxIter));
+}
+
+Palette *createPalette(const RenderContext *ctx, int maxIter)
+{
+    Palette *palette = calloc(1, sizeof(Palette));
+    palette->maxIter = maxIter;
+    palette->stopCount = ctx->colorStopCount + 2;
+    palette->stops = malloc(palette->stopCount * sizeof(RGBColor));
+    palette->stops[0] = ctx->colorStart;
+    if (ctx->colorStopCount > 0)
+        memcpy(palette->stops + 1, ctx->colorStops, ctx->colorStopCount * sizeof(RGBColor));
+    palette->stops[palette->stopCount - 1] = ctx->colorEnd;
+
+    palette->bandCount = maxIter < PALETTE_MAX_BANDS ? (maxIter < 0 ? 0 : maxIter + 1) : PALETTE_MAX_BANDS;
+    palette->bands = malloc((palette->bandCount > 0 ? palette->bandCount : 1) * sizeof(RGBColor));
+    for (int iter = 0; iter < palette->bandCount; iter++)
+    {
+        palette->bands[iter] = computePaletteColor(palette, iter);
+    }
+    return palette;
+}
+
+/* log2(value) para value > 0 y finito: el exponente exacto más la mantisa interpolada en la tabla. */
+static inline double tableLog2(const Palette *palette, double value)
+{
+    int exponent;
+    double mantissa = frexp(value, &exponent);
+    double position = (2.0 * mantissa - 1.0) * PALETTE_LOG_ENTRIES;
+    int k = (int)position;
+    double low = palette->log2Mantissa[k];
+    return (exponent - 1) + low + (palette->log2Mantissa[k + 1] - low) * (position - k);
+}
+
+int enableSmoothPalette(Palette *palette, double threshold)
+{
+    if (!(threshold > 1.0) || isinf(threshold) || palette->maxIter <= 0)
+        return 0;
+
+    for (int k = 0; k <= PALETTE_LOG_ENTRIES; k++)
+        palette->log2Mantissa[k] = log2(1.0 + (double)k / PALETTE_LOG_ENTRIES);
+    palette->logThreshold = log2(threshold);
+    palette->smoothScale = PALETTE_SMOOTH_STEPS;
+    if ((double)palette->maxIter * PALETTE_SMOOTH_STEPS > PALETTE_MAX_SMOOTH_ENTRIES - 2)
+        palette->smoothScale = (double)(PALETTE_MAX_SMOOTH_ENTRIES - 2) / palette->maxIter;
+
+    /* Una entrada de más, para interpolar el último tramo sin chequear el borde. */
+    palette->smoothCount = (int)(palette->maxIter * palette->smoothScale) + 2;
+    palette->smooth = malloc(palette->smoothCount * sizeof(RGBColor));
+    for (int k = 0; k < palette->smoothCount; k++)
+    {
+        double t = k / palette->smoothScale / palette->maxIter;
+        palette->smooth[k] = gradientColor(palette, sqrt(t < 1.0 ? t : 1.0));
+    }
+    return 1;
+}
+
+double paletteSmoothIteration(const Palette *palette, int iter, double norm)
+{
+    if (!(norm > 0.0) || isinf(norm))
+        return iter;
+
+    /* log|z| / log(bailout) = log2(|z|^2) / log2(bailout^2), que es >= 1 en un píxel que escapó. */
+    double ratio = tableLog2(palette, norm) / palette->logThreshold;
+    double nu = ratio > 1.0 ? iter + 1.0 - tableLog2(palette, ratio) : iter + 1.0;
+    return nu < 0.0 ? 0.0 : nu;
+}
+
+RGBColor paletteIterationColor(const Palette *palette, double nu)
+{
+    double position = nu * palette->smoothScale;
+    if (position > palette->smoothCount - 2)
+        position = palette->smoothCount - 2;
+    if (position < 0.0)
+        position = 0.0;
+    int k = (int)position;
+    int weight = (int)((position - k) * 256.0);
+    RGBColor a = palette->smooth[k];
+    RGBColor b = palette->smooth[k + 1];
+    RGBColor res;
+    res.r = (uint8_t)((a.r * (256 - weight) + b.r * weight + 128) >> 8);
+    res.g = (uint8_t)((a.g * (256 - weight) + b.g * weight + 128) >> 8);
+    res.b = (uint8_t)((a.b * (256 - weight) + b.b * weight + 128) >> 8);
+    return res;
+}
+
+RGBColor paletteSmoothColor(const Palette *palette, int iter, double norm)
+{
+    if (!palette->smooth || iter >= palette->maxIter)
+        return paletteColor(palette, iter);
+    return paletteIterationColor(palette, paletteSmoothIteration(palette, iter, norm));
+}
+
+void destroyPalette(Palette *palette)
+{
+    if (!palette)
+        return;
+    free(palette->stops);
+    free(palette->bands);
+    free(palette->smooth);
+    free(palette);
+}
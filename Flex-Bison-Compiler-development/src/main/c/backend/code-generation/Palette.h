@@ -0,0 +1,82 @@
+#ifndef PALETTE_HEADER
+#define PALETTE_HEADER
+
+#include "Bitmap.h"
+#include "RenderContext.h"
+
+/* Entradas de la tabla por iteración; con un "max:" mayor, el resto se calcula en el momento. */
+#define PALETTE_MAX_BANDS (1 << 20)
+
+/* Muestras por iteración de la tabla del coloreo suave (se interpola entre ellas). */
+#define PALETTE_SMOOTH_STEPS 16
+
+/* Entradas máximas de la tabla del coloreo suave; con "max:" grandes se baja la densidad. */
+#define PALETTE_MAX_SMOOTH_ENTRIES (1 << 20)
+
+/* Tramos de la tabla de log2 de la mantisa, en [1, 2). */
+#define PALETTE_LOG_ENTRIES 256
+
+/**
+ * Colores de un escape: el gradiente de "color:" (inicio, intermedios y fin,
+ * a distancias iguales) recorrido con t = sqrt(iteraciones / maxIter). Se
+ * arma una vez por escape y cada píxel se colorea con un acceso a la tabla.
+ */
+typedef struct
+{
+    RGBColor *stops;
+    int stopCount;
+    int maxIter;
+    /* bands[iter] para iter < bandCount (bands[maxIter] es el color de "max:", si entra). */
+    RGBColor *bands;
+    int bandCount;
+    /* Coloreo suave: el gradiente muestreado cada 1/smoothScale iteraciones, o NULL. */
+    RGBColor *smooth;
+    int smoothCount;
+    double smoothScale;
+    /* log2 del umbral de |z|^2 del bailout. */
+    double logThreshold;
+    /* log2(1 + k / PALETTE_LOG_ENTRIES), con una entrada de más para interpolar el último tramo. */
+    double log2Mantissa[PALETTE_LOG_ENTRIES + 1];
+} Palette;
+
+/** Arma la tabla por iteración con los colores del contexto. */
+Palette *createPalette(const RenderContext *ctx, int maxIter);
+
+/**
+ * Arma la tabla del coloreo suave para un bailout |z|^2 > threshold de
+ * z = z*z + c. Devuelve 0 (y la paleta sigue por bandas) si el umbral no
+ * admite la fórmula (threshold <= 1).
+ */
+int enableSmoothPalette(Palette *palette, double threshold);
+
+void destroyPalette(Palette *palette);
+
+/** Color de un píxel con un "max:" más grande que la tabla. */
+RGBColor computePaletteColor(const Palette *palette, int iter);
+
+/** Color de un píxel que hizo "iter" iteraciones. */
+static inline RGBColor paletteColor(const Palette *palette, int iter)
+{
+    if (iter < palette->bandCount)
+        return palette->bands[iter];
+    return computePaletteColor(palette, iter);
+}
+
+/**
+ * Cantidad fraccionaria de iteraciones de un píxel de z = z*z + c que escapó
+ * en "iter" iteraciones con |z|^2 = norm: iter + 1 - log2(log|z| / log(bailout)).
+ * Los logaritmos salen de una tabla, así que no hay funciones trascendentes
+ * por píxel. Necesita enableSmoothPalette.
+ */
+double paletteSmoothIteration(const Palette *palette, int iter, double norm);
+
+/** Color de una cantidad fraccionaria de iteraciones, interpolado en la tabla suave. */
+RGBColor paletteIterationColor(const Palette *palette, double nu);
+
+/**
+ * Color de un píxel que escapó en "iter" iteraciones con |z|^2 = norm, con el
+ * coloreo suave si está armado y por bandas si no (o si el píxel no escapó).
+ */
+RGBColor paletteSmoothColor(const Palette *palette, int iter, double norm);
+
+#endif
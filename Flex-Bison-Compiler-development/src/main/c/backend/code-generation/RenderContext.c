@@ -0,0 +1,195 @@
+#include "RenderContext.h"
+#include <pthread.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+static Logger *_logger = NULL;
+
+void _shutdownRenderContextModule()
+{
+    if (_logger != NULL)
+    {
+        destroyLogger(_logger);
+        _logger = NULL;
+    }
+}
+
+ModuleDestructor initializeRenderContextModule()
+{
+    _logger = createLogger("RenderContext");
+    return _shutdownRenderContextModule;
+}
+
+double *pushFrame(RenderContext *ctx, const Rule *rule)
+{
+    size_t size = rule->parameterCount;
+    if (ctx->frameTop + size > ctx->frameCapacity || !ctx->frameValues)
+    {
+        size_t capacity = ctx->frameCapacity ? ctx->frameCapacity : 1024;
+        while (ctx->frameTop + size > capacity)
+            capacity *= 2;
+        ctx->frameValues = realloc(ctx->frameValues, capacity * sizeof(double));
+        ctx->frameCapacity = capacity;
+    }
+    if (ctx->frameCount == ctx->frameLimit)
+    {
+        ctx->frameLimit = ctx->frameLimit ? 2 * ctx->frameLimit : 256;
+        ctx->frames = realloc(ctx->frames, ctx->frameLimit * sizeof(RuleFrame));
+    }
+    RuleFrame *frame = &ctx->frames[ctx->frameCount];
+    frame->rule = rule;
+    frame->next = rule->ruleSentenceList;
+    frame->base = ctx->frameTop;
+    frame->depth = ctx->frameCount ? ctx->frames[ctx->frameCount - 1].depth + 1 : 0;
+    frame->instance = NULL;
+    frame->step = 0;
+    ctx->frameCount++;
+    ctx->frameTop += size;
+    return ctx->frameValues + frame->base;
+}
+
+/* Lugar visible de "name" en la regla, entre sus primeros "count" parámetros, o -1. */
+static int visibleSlot(const Rule *rule, const char *name, int count)
+{
+    int slot = -1;
+    int k = 0;
+    for (IdentifierList *p = rule->identifierList; p && p->variable && k < count; p = p->identifierList, k++)
+    {
+        if (strcmp(p->variable->name, name) == 0)
+            slot = k;
+    }
+    return slot;
+}
+
+/* Valor visible para "name" en los frames debajo de "frame", que ya tienen completos todos sus lugares, o 0.0. */
+static double valueBelow(const RenderContext *ctx, const RuleFrame *frame, const char *name)
+{
+    for (const RuleFrame *caller = frame - 1; caller >= ctx->frames; caller--)
+    {
+        int slot = visibleSlot(caller->rule, name, caller->rule->parameterCount);
+        if (slot >= 0)
+            return ctx->frameValues[caller->base + slot];
+    }
+    return 0.0;
+}
+
+void inheritFrameValues(const RenderContext *ctx, int given)
+{
+    const RuleFrame *frame = topFrame(ctx);
+    double *values = ctx->frameValues + frame->base;
+    int k = 0;
+    for (IdentifierList *p = frame->rule->identifierList; p && p->variable; p = p->identifierList, k++)
+    {
+        if (k < given)
+            continue;
+        const char *name = p->variable->name;
+        int slot = visibleSlot(frame->rule, name, given);
+        values[k] = slot >= 0 ? values[slot] : valueBelow(ctx, frame, name);
+    }
+}
+
+double callerVariableValue(const RenderContext *ctx, const char *name)
+{
+    if (!ctx->frameActive)
+        return 0.0;
+    return valueBelow(ctx, &ctx->frames[ctx->frameActive - 1], name);
+}
+
+void enterFrame(RenderContext *ctx)
+{
+    ctx->frameBase = topFrame(ctx)->base;
+    ctx->frameActive = ctx->frameCount;
+}
+
+void popFrame(RenderContext *ctx)
+{
+    if (ctx->frameCount)
+    {
+        ctx->frameTop = ctx->frames[--ctx->frameCount].base;
+        ctx->frameBase = ctx->frameCount ? ctx->frames[ctx->frameCount - 1].base : 0;
+        ctx->frameActive = ctx->frameCount;
+    }
+}
+
+const double *currentFrameValues(const RenderContext *ctx)
+{
+    return ctx->frameValues + ctx->frameBase;
+}
+
+void resetFrames(RenderContext *ctx)
+{
+    ctx->frameValues = NULL;
+    ctx->frameTop = 0;
+    ctx->frameCapacity = 0;
+    ctx->frames = NULL;
+    ctx->frameCount = 0;
+    ctx->frameLimit = 0;
+    ctx->frameBase = 0;
+    ctx->frameActive = 0;
+}
+
+void releaseFrames(RenderContext *ctx)
+{
+    free(ctx->frameValues);
+    free(ctx->frames);
+    resetFrames(ctx);
+}
+
+int renderThreadCount(const RenderOptions *options)
+{
+    int threads = options ? options->threads : 0;
+    if (threads <= 0)
+    {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = online > 0 ? (int)online : 1;
+    }
+    return threads;
+}
+
+void runRenderThreads(void *(*function)(void *), void *arguments, size_t size, int threads)
+{
+    pthread_t *handles = calloc(threads > 1 ? threads : 1, sizeof(pthread_t));
+    int started = 1;
+    for (; started < threads; started++)
+    {
+        if (pthread_create(&handles[started], NULL, function, (char *)arguments + started * size) != 0)
+        {
+            logWarning(_logger, "No se pudo crear el worker %d, se continúa con %d.", started, started);
+            break;
+        }
+    }
+
+    function(arguments);
+
+    for (int k = 1; k < started; k++)
+    {
+        pthread_join(handles[k], NULL);
+    }
+    free(handles);
+}
+
+double renderClock(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000.0 + now.tv_nsec / 1e6;
+}
+
+int renderBudgetSpent(const RenderContext *ctx)
+{
+    if (!ctx->options || !ctx->options->progressive || ctx->options->budget <= 0)
+        return 0;
+    return renderClock() - ctx->startTime >= ctx->options->budget;
+}
+
+void flushRenderPreview(const RenderContext *ctx)
+{
+    size_t length = strlen(ctx->outputFilename) + 9;
+    char *temporary = malloc(length);
+    snprintf(temporary, length, "%s.preview", ctx->outputFilename);
+    saveBitmap(ctx->bmp, temporary);
+    if (rename(temporary, ctx->outputFilename) != 0)
+        remove(temporary);
+    free(temporary);
+}
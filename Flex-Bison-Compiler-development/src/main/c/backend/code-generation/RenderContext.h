@@ -0,0 +1,172 @@
+#ifndef RENDER_CONTEXT_HEADER
+#define RENDER_CONTEXT_HEADER
+
+#include "../../frontend/syntactic-analysis/AbstractSyntaxTree.h"
+#include "../../support/logging/Logger.h"
+#include "../../support/type/ModuleDestructor.h"
+#include "../../support/type/RenderOptions.h"
+#include "Bitmap.h"
+
+/**
+ * Llamada a una regla en ejecución, en la pila de frames del contexto. Los
+ * valores de sus parámetros están en la pila de valores, a partir de "base",
+ * en el orden en que la regla los declara: el validador resuelve cada
+ * referencia a un parámetro a su lugar (ver Variable.slot). "next" es la
+ * continuación: la sentencia por la que sigue la regla cuando su frame
+ * vuelve a quedar arriba (NULL si ya terminó).
+ */
+typedef struct
+{
+    const Rule *rule;
+    RuleSentenceList *next;
+    size_t base;
+    /* Llamadas anidadas desde la regla que empezó la expansión en paralelo (o desde "start:"). */
+    int depth;
+    /* Si no es NULL, el frame repite esta instancia (ver InstanceCache.h) desde el paso "step", en vez de sus sentencias. */
+    struct RuleInstance *instance;
+    int step;
+} RuleFrame;
+
+/**
+ * Estado de ejecución del intérprete. Los renderers paralelos trabajan sobre
+ * copias por worker, de modo que todo lo que cambia por píxel (currentPixelX,
+ * currentPixelY) nunca se comparte entre threads.
+ */
+typedef struct
+{
+    double minX, maxX, minY, maxY;
+    /* Sentencia "view:" de la que salen los límites, para recalcularlos con más precisión. */
+    View *view;
+    int width, height;
+    Bitmap *bmp;
+    Program *program;
+    const RenderOptions *options;
+    /* Imagen de salida (los archivos auxiliares se guardan a su lado). */
+    const char *outputFilename;
+    /* Instante (reloj monótono, en milisegundos) en que empezó el render, para el presupuesto. */
+    double startTime;
+
+    /* Pila contigua de valores de los parámetros de todos los frames (crece duplicándose, nunca se achica). */
+    double *frameValues;
+    size_t frameTop, frameCapacity;
+    /* Pila de frames, que crece igual: la profundidad de la recursión sólo depende de la memoria. */
+    RuleFrame *frames;
+    size_t frameCount, frameLimit;
+    /* Dónde empiezan en frameValues los parámetros del frame activo, y cuántos frames hay hasta él, inclusive. */
+    size_t frameBase;
+    size_t frameActive;
+    /* En la expansión en paralelo de una regla (ver Interpreter.c): el trabajo y el worker de este contexto, o NULL. */
+    struct RuleExpansion *expansion;
+    int worker;
+    /* Workers de la expansión en paralelo (1: las reglas se ejecutan en este thread). */
+    int ruleThreads;
+    /* Si se podan las llamadas que no cambiarían la imagen (ver RenderOptions.lod). */
+    int lod;
+    /* Expresiones calientes compiladas a código nativo (ver ExpressionJit.h), o NULL. */
+    struct ExpressionJitCache *expressionJit;
+    /* Instancias de las reglas que se trasladan (ver InstanceCache.h), o NULL. */
+    struct InstanceCache *instances;
+    /* Segmentos dibujados que todavía no se rasterizaron (ver SegmentBuffer.h). */
+    struct SegmentBuffer *segments;
+
+    double currentPixelX;
+    double currentPixelY;
+    int numPoints;
+
+    RGBColor colorStart;
+    RGBColor colorEnd;
+    /* Colores intermedios del gradiente de "color:", repartidos a distancias iguales. */
+    RGBColor *colorStops;
+    int colorStopCount;
+} RenderContext;
+
+/** Inicializa el módulo */
+ModuleDestructor initializeRenderContextModule();
+
+/**
+ * Apila un frame para la regla, con la continuación en su primera sentencia,
+ * sin activarlo, y devuelve dónde van los valores de sus parámetros: los
+ * argumentos todavía se evalúan en el frame de quien llama. El puntero vale
+ * hasta el próximo pushFrame.
+ */
+double *pushFrame(RenderContext *ctx, const Rule *rule);
+
+/**
+ * Completa los parámetros a partir de "given" que la llamada no pasó al frame
+ * apilado, con el valor visible para su nombre: un parámetro anterior con el
+ * mismo nombre, o el de la regla que llamó (y así hacia abajo en la pila), o
+ * 0.0.
+ */
+void inheritFrameValues(const RenderContext *ctx, int given);
+
+/** Activa el frame apilado. */
+void enterFrame(RenderContext *ctx);
+
+/** Desapila el frame de arriba y activa el de quien llamó. */
+void popFrame(RenderContext *ctx);
+
+/** El frame de arriba de la pila (NULL si no hay). Vale hasta el próximo pushFrame. */
+static inline RuleFrame *topFrame(const RenderContext *ctx)
+{
+    return ctx->frameCount ? &ctx->frames[ctx->frameCount - 1] : NULL;
+}
+
+/** Valores de los parámetros del frame activo. */
+const double *currentFrameValues(const RenderContext *ctx);
+
+/**
+ * Valor visible para "name" desde las reglas que llamaron a la del frame
+ * activo: el del parámetro con ese nombre en la más cercana, o 0.0.
+ */
+double callerVariableValue(const RenderContext *ctx, const char *name);
+
+/**
+ * Devuelve el valor de un parámetro del frame activo (0.0 si no es un
+ * parámetro), o el de una variable de quien llamó (ver CALLER_VARIABLE_SLOT).
+ * Sólo las expresiones de las reglas tienen lugares, y se evalúan siempre con
+ * el frame de su regla activo.
+ */
+static inline double getVariableValue(const RenderContext *ctx, const Variable *variable)
+{
+    if (variable->slot >= 0)
+        return ctx->frameValues[ctx->frameBase + variable->slot];
+    if (variable->slot == CALLER_VARIABLE_SLOT)
+        return callerVariableValue(ctx, variable->name);
+    return 0.0;
+}
+
+/** Deja las pilas vacías, sin memoria (para un contexto copiado de otro). */
+void resetFrames(RenderContext *ctx);
+
+/** Libera las pilas de valores y de frames. */
+void releaseFrames(RenderContext *ctx);
+
+/**
+ * Threads que usan los renderizadores paralelos (los escapes, la expansión de
+ * las reglas y el rasterizado en tiles): el valor de --threads o, con 0, uno
+ * por procesador en línea. Siempre es al menos 1.
+ */
+int renderThreadCount(const RenderOptions *options);
+
+/**
+ * Corre "function" en "threads" threads y espera a que terminen todos: el
+ * thread que llama es el 0 y recibe "arguments", y el thread k recibe
+ * arguments + k * size (con size 0, todos reciben lo mismo). Si no se puede
+ * crear alguno, lo avisa y sigue con los que ya había.
+ */
+void runRenderThreads(void *(*function)(void *), void *arguments, size_t size, int threads);
+
+/** Milisegundos de un reloj monótono (sólo sirven las diferencias). */
+double renderClock(void);
+
+/** Si el render es progresivo y ya gastó su presupuesto de tiempo. */
+int renderBudgetSpent(const RenderContext *ctx);
+
+/**
+ * Escribe el bitmap tal como está en la imagen de salida, como vista previa
+ * de un render progresivo. Se escribe aparte y se renombra, para que quien la
+ * esté mirando nunca lea un archivo a medias.
+ */
+void flushRenderPreview(const RenderContext *ctx);
+
+#endif
@@ -0,0 +1,327 @@
+#include "SegmentBuffer.h"
+#include "RenderContext.h"
+#include <pthread.h>
+#include <string.h>
+#include <time.h>
+
+void initSegmentBuffer(SegmentBuffer *buffer)
+{
+    memset(buffer, 0, sizeof(SegmentBuffer));
+}
+
+void freeSegmentBuffer(SegmentBuffer *buffer)
+{
+    free(buffer->x0);
+    free(buffer->y0);
+    free(buffer->x1);
+    free(buffer->y1);
+    free(buffer->color);
+    free(buffer->binned);
+    initSegmentBuffer(buffer);
+}
+
+static void growSegmentBuffer(SegmentBuffer *buffer)
+{
+    buffer->capacity = buffer->capacity ? 2 * buffer->capacity : 4096;
+    buffer->x0 = realloc(buffer->x0, buffer->capacity * sizeof(int));
+    buffer->y0 = realloc(buffer->y0, buffer->capacity * sizeof(int));
+    buffer->x1 = realloc(buffer->x1, buffer->capacity * sizeof(int));
+    buffer->y1 = realloc(buffer->y1, buffer->capacity * sizeof(int));
+    buffer->color = realloc(buffer->color, buffer->capacity);
+}
+
+static int sameColor(RGBColor a, RGBColor b)
+{
+    return a.r == b.r && a.g == b.g && a.b == b.b;
+}
+
+/* Índice del color en el buffer, o colorCount si no está. */
+static int findColor(const SegmentBuffer *buffer, RGBColor color)
+{
+    int index = 0;
+    while (index < buffer->colorCount && !sameColor(buffer->colors[index], color))
+        index++;
+    return index;
+}
+
+int appendSegmentBuffer(SegmentBuffer *buffer, SegmentBuffer *other)
+{
+    int missing = 0;
+    for (int k = 0; k < other->colorCount; k++)
+        missing += findColor(buffer, other->colors[k]) == buffer->colorCount;
+    if (buffer->colorCount + missing > SEGMENT_BUFFER_COLORS)
+        return 0;
+
+    uint8_t map[SEGMENT_BUFFER_COLORS];
+    for (int k = 0; k < other->colorCount; k++)
+    {
+        int index = findColor(buffer, other->colors[k]);
+        if (index == buffer->colorCount)
+            buffer->colors[buffer->colorCount++] = other->colors[k];
+        map[k] = (uint8_t)index;
+    }
+    while (buffer->capacity < buffer->count + other->count)
+        growSegmentBuffer(buffer);
+    size_t first = buffer->count;
+    memcpy(buffer->x0 + first, other->x0, other->count * sizeof(int));
+    memcpy(buffer->y0 + first, other->y0, other->count * sizeof(int));
+    memcpy(buffer->x1 + first, other->x1, other->count * sizeof(int));
+    memcpy(buffer->y1 + first, other->y1, other->count * sizeof(int));
+    for (size_t k = 0; k < other->count; k++)
+        buffer->color[first + k] = map[other->color[k]];
+    buffer->count += other->count;
+    other->count = 0;
+    other->colorCount = 0;
+    return 1;
+}
+
+int appendSegment(SegmentBuffer *buffer, int x0, int y0, int x1, int y1, RGBColor color)
+{
+    /* Casi siempre es el color del segmento anterior. */
+    int index = buffer->colorCount - 1;
+    if (index < 0 || !sameColor(buffer->colors[index], color))
+    {
+        index = findColor(buffer, color);
+        if (index == buffer->colorCount)
+        {
+            if (buffer->colorCount == SEGMENT_BUFFER_COLORS)
+                return 0;
+            buffer->colors[buffer->colorCount++] = color;
+        }
+    }
+    if (buffer->count == buffer->capacity)
+        growSegmentBuffer(buffer);
+    size_t k = buffer->count++;
+    buffer->x0[k] = x0;
+    buffer->y0[k] = y0;
+    buffer->x1[k] = x1;
+    buffer->y1[k] = y1;
+    buffer->color[k] = (uint8_t)index;
+    return 1;
+}
+
+/*
+ * Rasterizado en tres fases, cada una repartida entre los threads con un
+ * contador atómico: contar cuántos segmentos de cada tramo (un rango
+ * contiguo de segmentos por thread) tocan cada tile, anotarlos en "binned",
+ * tile por tile y tramo por tramo (así quedan en el orden del buffer), y
+ * dibujar los tiles, empezando por "firstTile" y con su mutex tomado si hay
+ * "locks".
+ */
+typedef struct
+{
+    SegmentBuffer *buffer;
+    Bitmap *bitmap;
+    int tilesX, tileCount;
+    int chunks;
+    /* Por tramo y tile: primero cuántos segmentos hay, después dónde va el siguiente. */
+    uint32_t *slots;
+    /* Dónde empiezan en "binned" los segmentos de cada tile (tileCount + 1). */
+    uint32_t *tileStart;
+    pthread_mutex_t *locks;
+    int firstTile;
+    int phase;
+    int next;
+} TileJob;
+
+/*
+ * Anota el segmento k en cada tile que puede tocar: en "slots" si "binned"
+ * es NULL, y si no en "binned", en el lugar que indica "slots". Para cada
+ * fila de tiles alcanza con las columnas en que la recta ideal pasa por la
+ * fila, con un píxel de margen, porque Bresenham se aparta de ella menos de
+ * medio píxel; puede sobrar algún tile, al que drawLineInBox no le dibuja
+ * nada.
+ */
+static void binSegment(const TileJob *job, size_t k, uint32_t *slots, uint32_t *binned)
+{
+    const SegmentBuffer *buffer = job->buffer;
+    int x0 = buffer->x0[k], y0 = buffer->y0[k], x1 = buffer->x1[k], y1 = buffer->y1[k];
+    int minX = x0 < x1 ? x0 : x1, maxX = x0 < x1 ? x1 : x0;
+    int minY = y0 < y1 ? y0 : y1, maxY = y0 < y1 ? y1 : y0;
+    if (minX < 0)
+        minX = 0;
+    if (minY < 0)
+        minY = 0;
+    if (maxX >= job->bitmap->width)
+        maxX = job->bitmap->width - 1;
+    if (maxY >= job->bitmap->height)
+        maxY = job->bitmap->height - 1;
+    if (minX > maxX || minY > maxY)
+        return;
+
+    int firstColumn = minX / SEGMENT_TILE_SIZE, lastColumn = maxX / SEGMENT_TILE_SIZE;
+    int firstRow = minY / SEGMENT_TILE_SIZE, lastRow = maxY / SEGMENT_TILE_SIZE;
+    /* En double: con los extremos lejos del bitmap, la resta de ints desborda. */
+    double slope = y0 != y1 ? ((double)x1 - x0) / ((double)y1 - y0) : 0.0;
+    for (int row = firstRow; row <= lastRow; row++)
+    {
+        int from = firstColumn, to = lastColumn;
+        if (y0 != y1 && from != to)
+        {
+            double top = x0 + (row * SEGMENT_TILE_SIZE - 1.0 - y0) * slope;
+            double bottom = x0 + ((row + 1) * SEGMENT_TILE_SIZE - (double)y0) * slope;
+            double left = (top < bottom ? top : bottom) - 1.0, right = (top < bottom ? bottom : top) + 1.0;
+            if (left > minX && (int)left / SEGMENT_TILE_SIZE > from)
+                from = (int)left / SEGMENT_TILE_SIZE;
+            if (right < maxX && (int)right / SEGMENT_TILE_SIZE < to)
+                to = (int)right / SEGMENT_TILE_SIZE;
+        }
+        for (int tile = row * job->tilesX + from; tile <= row * job->tilesX + to; tile++)
+        {
+            if (binned)
+                binned[slots[tile]++] = (uint32_t)k;
+            else
+                slots[tile]++;
+        }
+    }
+}
+
+static void drawTile(const TileJob *job, int tile)
+{
+    const SegmentBuffer *buffer = job->buffer;
+    int minX = (tile % job->tilesX) * SEGMENT_TILE_SIZE, minY = (tile / job->tilesX) * SEGMENT_TILE_SIZE;
+    int maxX = minX + SEGMENT_TILE_SIZE - 1, maxY = minY + SEGMENT_TILE_SIZE - 1;
+    if (maxX >= job->bitmap->width)
+        maxX = job->bitmap->width - 1;
+    if (maxY >= job->bitmap->height)
+        maxY = job->bitmap->height - 1;
+    if (job->tileStart[tile] == job->tileStart[tile + 1])
+        return;
+    if (job->locks)
+        pthread_mutex_lock(&job->locks[tile]);
+    for (uint32_t b = job->tileStart[tile]; b < job->tileStart[tile + 1]; b++)
+    {
+        uint32_t k = buffer->binned[b];
+        drawLineInBox(job->bitmap, buffer->x0[k], buffer->y0[k], buffer->x1[k], buffer->y1[k],
+                      buffer->colors[buffer->color[k]], minX, minY, maxX, maxY);
+    }
+    if (job->locks)
+        pthread_mutex_unlock(&job->locks[tile]);
+}
+
+static void *tileWorkerMain(void *argument)
+{
+    TileJob *job = argument;
+    int items = job->phase == 2 ? job->tileCount : job->chunks;
+    int item;
+    while ((item = __atomic_fetch_add(&job->next, 1, __ATOMIC_RELAXED)) < items)
+    {
+        if (job->phase == 2)
+        {
+            drawTile(job, (job->firstTile + item) % job->tileCount);
+            continue;
+        }
+        size_t first = job->buffer->count * item / job->chunks;
+        size_t last = job->buffer->count * (item + 1) / job->chunks;
+        uint32_t *slots = job->slots + (size_t)item * job->tileCount;
+        for (size_t k = first; k < last; k++)
+            binSegment(job, k, slots, job->phase == 1 ? job->buffer->binned : NULL);
+    }
+    return NULL;
+}
+
+/* Corre la fase actual con el thread llamador y threads - 1 threads más. */
+static void runTilePhase(TileJob *job, int threads)
+{
+    job->next = 0;
+    runRenderThreads(tileWorkerMain, job, 0, threads);
+}
+
+static void rasterizeTiles(SegmentBuffer *buffer, Bitmap *bitmap, int threads, pthread_mutex_t *locks, int firstTile)
+{
+    TileJob job;
+    job.buffer = buffer;
+    job.bitmap = bitmap;
+    job.locks = locks;
+    job.tilesX = (bitmap->width + SEGMENT_TILE_SIZE - 1) / SEGMENT_TILE_SIZE;
+    job.tileCount = job.tilesX * ((bitmap->height + SEGMENT_TILE_SIZE - 1) / SEGMENT_TILE_SIZE);
+    job.firstTile = firstTile % job.tileCount;
+    job.chunks = threads;
+    job.slots = calloc((size_t)job.chunks * job.tileCount, sizeof(uint32_t));
+    job.tileStart = malloc((job.tileCount + 1) * sizeof(uint32_t));
+
+    job.phase = 0;
+    runTilePhase(&job, threads);
+
+    /* Los lugares de cada tile, en el orden de los tramos. */
+    size_t total = 0;
+    for (int tile = 0; tile < job.tileCount; tile++)
+    {
+        job.tileStart[tile] = (uint32_t)total;
+        for (int chunk = 0; chunk < job.chunks; chunk++)
+        {
+            uint32_t *slot = &job.slots[(size_t)chunk * job.tileCount + tile];
+            uint32_t count = *slot;
+            *slot = (uint32_t)total;
+            total += count;
+        }
+    }
+    job.tileStart[job.tileCount] = (uint32_t)total;
+    if (total > buffer->binnedCapacity)
+    {
+        buffer->binnedCapacity = total;
+        free(buffer->binned);
+        buffer->binned = malloc(total * sizeof(uint32_t));
+    }
+
+    job.phase = 1;
+    runTilePhase(&job, threads);
+    job.phase = 2;
+    runTilePhase(&job, threads);
+
+    free(job.tileStart);
+    free(job.slots);
+}
+
+/* Con "tiles", siempre en tiles y con sus mutex (ver rasterizeSharedSegments). */
+static void rasterize(SegmentBuffer *buffer, Bitmap *bitmap, int threads, SegmentTileLocks *tiles, int first)
+{
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (tiles)
+    {
+        rasterizeTiles(buffer, bitmap, 1, tiles->locks, first);
+    }
+    else if (threads > 1 && buffer->count >= SEGMENT_TILE_MIN)
+    {
+        rasterizeTiles(buffer, bitmap, threads, NULL, 0);
+    }
+    else
+    {
+        for (size_t k = 0; k < buffer->count; k++)
+            drawLine(bitmap, buffer->x0[k], buffer->y0[k], buffer->x1[k], buffer->y1[k], buffer->colors[buffer->color[k]]);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    buffer->rasterTime += (end.tv_sec - start.tv_sec) * 1e3 + (end.tv_nsec - start.tv_nsec) / 1e6;
+    buffer->rasterized += buffer->count;
+    buffer->count = 0;
+    buffer->colorCount = 0;
+}
+
+void rasterizeSegments(SegmentBuffer *buffer, Bitmap *bitmap, int threads)
+{
+    rasterize(buffer, bitmap, threads, NULL, 0);
+}
+
+void rasterizeSharedSegments(SegmentBuffer *buffer, Bitmap *bitmap, SegmentTileLocks *tiles, int first)
+{
+    rasterize(buffer, bitmap, 1, tiles, first);
+}
+
+void initSegmentTileLocks(SegmentTileLocks *tiles, const Bitmap *bitmap)
+{
+    int tilesX = (bitmap->width + SEGMENT_TILE_SIZE - 1) / SEGMENT_TILE_SIZE;
+    tiles->count = tilesX * ((bitmap->height + SEGMENT_TILE_SIZE - 1) / SEGMENT_TILE_SIZE);
+    tiles->locks = malloc(tiles->count * sizeof(pthread_mutex_t));
+    for (int k = 0; k < tiles->count; k++)
+        pthread_mutex_init(&tiles->locks[k], NULL);
+}
+
+void freeSegmentTileLocks(SegmentTileLocks *tiles)
+{
+    for (int k = 0; k < tiles->count; k++)
+        pthread_mutex_destroy(&tiles->locks[k]);
+    free(tiles->locks);
+    tiles->locks = NULL;
+    tiles->count = 0;
+}
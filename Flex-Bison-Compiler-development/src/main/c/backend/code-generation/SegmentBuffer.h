@@ -0,0 +1,94 @@
+#ifndef SEGMENT_BUFFER_HEADER
+#define SEGMENT_BUFFER_HEADER
+
+#include "Bitmap.h"
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Colores distintos que puede nombrar un buffer entre dos rasterizaciones. */
+#define SEGMENT_BUFFER_COLORS 256
+
+/* Lado de los tiles del rasterizado en paralelo, en píxeles. */
+#define SEGMENT_TILE_SIZE 64
+
+/* Segmentos a partir de los que conviene repartir el rasterizado en tiles. */
+#define SEGMENT_TILE_MIN 4096
+
+/**
+ * Display list entre la ejecución de las reglas y el rasterizado: cada
+ * segmento, ya llevado a píxeles, es un extremo (x0, y0), el otro (x1, y1) y
+ * el índice de su color en "colors", guardados en arreglos separados que
+ * crecen duplicándose. El rasterizado los consume después, todos juntos, así
+ * que puede recorrerlos en otro orden o repartirlos, y su costo se mide
+ * aparte del de generarlos.
+ */
+typedef struct SegmentBuffer
+{
+    int *x0, *y0, *x1, *y1;
+    uint8_t *color;
+    size_t count, capacity;
+    RGBColor colors[SEGMENT_BUFFER_COLORS];
+    int colorCount;
+    /* Índices de los segmentos agrupados por tile, reusados entre rasterizaciones. */
+    uint32_t *binned;
+    size_t binnedCapacity;
+    /* Segmentos rasterizados desde que se creó el buffer, y los milisegundos que llevó. */
+    size_t rasterized;
+    double rasterTime;
+} SegmentBuffer;
+
+/**
+ * Un mutex por cada tile de SEGMENT_TILE_SIZE píxeles de un bitmap, para que
+ * varios threads rasterizen sus buffers a la vez en el mismo bitmap (ver
+ * rasterizeSharedSegments).
+ */
+typedef struct
+{
+    pthread_mutex_t *locks;
+    int count;
+} SegmentTileLocks;
+
+void initSegmentBuffer(SegmentBuffer *buffer);
+
+void freeSegmentBuffer(SegmentBuffer *buffer);
+
+/**
+ * Mueve los segmentos de "other" al final de "buffer", en orden, y vacía
+ * "other". Devuelve 0, sin mover nada, si entre los dos nombran más de
+ * SEGMENT_BUFFER_COLORS colores: hay que rasterizar "buffer" antes.
+ */
+int appendSegmentBuffer(SegmentBuffer *buffer, SegmentBuffer *other);
+
+/**
+ * Agrega el segmento al final del buffer. Devuelve 0, sin agregarlo, si ya
+ * hay SEGMENT_BUFFER_COLORS colores distintos y el suyo no está: hay que
+ * rasterizar antes.
+ */
+int appendSegment(SegmentBuffer *buffer, int x0, int y0, int x1, int y1, RGBColor color);
+
+/**
+ * Dibuja los segmentos en el bitmap y vacía el buffer. Con más de un thread,
+ * cada segmento se anota en los tiles de SEGMENT_TILE_SIZE píxeles que puede
+ * tocar y los threads se reparten los tiles: cada uno dibuja, en el orden en
+ * que se agregaron, los segmentos de sus tiles recortados al tile
+ * (drawLineInBox), así que nadie escribe los píxeles de otro y la imagen es
+ * la misma que dibujándolos en orden con drawLine.
+ */
+void rasterizeSegments(SegmentBuffer *buffer, Bitmap *bitmap, int threads);
+
+void initSegmentTileLocks(SegmentTileLocks *tiles, const Bitmap *bitmap);
+
+void freeSegmentTileLocks(SegmentTileLocks *tiles);
+
+/**
+ * Como rasterizeSegments en tiles, pero en el thread que llama y con el
+ * mutex de cada tile tomado mientras lo dibuja, así que otros threads pueden
+ * estar rasterizando sus propios buffers en el mismo bitmap. Los tiles se
+ * recorren desde "first", para que threads que empiezan juntos no esperen
+ * por los mismos. Como los buffers se dibujan en cualquier orden, la imagen
+ * sólo es la de drawLine en orden si todos sus segmentos son del mismo color.
+ */
+void rasterizeSharedSegments(SegmentBuffer *buffer, Bitmap *bitmap, SegmentTileLocks *tiles, int first);
+
+#endif
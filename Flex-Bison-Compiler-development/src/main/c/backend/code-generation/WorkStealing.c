@@ -0,0 +1,129 @@
+#include "WorkStealing.h"
+#include "RenderContext.h"
+#include <sched.h>
+#include <stdlib.h>
+
+/*
+ * Las operaciones de la deque siguen a "Correct and Efficient Work-Stealing
+ * for Weak Memory Models" (Lê et al., 2013), con los builtins atómicos de GCC.
+ */
+
+static int pushDeque(WorkDeque *deque, void *task)
+{
+    long bottom = __atomic_load_n(&deque->bottom, __ATOMIC_RELAXED);
+    long top = __atomic_load_n(&deque->top, __ATOMIC_ACQUIRE);
+    if (bottom - top >= WORK_DEQUE_CAPACITY)
+        return 0;
+    __atomic_store_n(&deque->tasks[bottom & (WORK_DEQUE_CAPACITY - 1)], task, __ATOMIC_RELAXED);
+    /* Publica la tarea (y lo que apunta) para el ladrón que lea bottom. */
+    __atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_RELEASE);
+    return 1;
+}
+
+static void *takeDeque(WorkDeque *deque)
+{
+    long bottom = __atomic_load_n(&deque->bottom, __ATOMIC_RELAXED) - 1;
+    __atomic_store_n(&deque->bottom, bottom, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    long top = __atomic_load_n(&deque->top, __ATOMIC_RELAXED);
+    if (top > bottom)
+    {
+        __atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_RELAXED);
+        return NULL;
+    }
+    void *task = __atomic_load_n(&deque->tasks[bottom & (WORK_DEQUE_CAPACITY - 1)], __ATOMIC_RELAXED);
+    if (top == bottom)
+    {
+        /* La última tarea: se la disputa con los ladrones. */
+        if (!__atomic_compare_exchange_n(&deque->top, &top, top + 1, 0, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+            task = NULL;
+        __atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_RELAXED);
+    }
+    return task;
+}
+
+static void *stealDeque(WorkDeque *deque)
+{
+    long top = __atomic_load_n(&deque->top, __ATOMIC_ACQUIRE);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    long bottom = __atomic_load_n(&deque->bottom, __ATOMIC_ACQUIRE);
+    if (top >= bottom)
+        return NULL;
+    void *task = __atomic_load_n(&deque->tasks[top & (WORK_DEQUE_CAPACITY - 1)], __ATOMIC_RELAXED);
+    if (!__atomic_compare_exchange_n(&deque->top, &top, top + 1, 0, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+        return NULL;
+    return task;
+}
+
+void initWorkPool(WorkPool *pool, int threads, WorkFunction run, void *context)
+{
+    pool->threads = threads < 1 ? 1 : threads;
+    pool->deques = calloc(pool->threads, sizeof(WorkDeque));
+    pool->run = run;
+    pool->context = context;
+    pool->pending = 0;
+}
+
+int pushWork(WorkPool *pool, int worker, void *task)
+{
+    __atomic_add_fetch(&pool->pending, 1, __ATOMIC_RELAXED);
+    if (pushDeque(&pool->deques[worker], task))
+        return 1;
+    __atomic_sub_fetch(&pool->pending, 1, __ATOMIC_RELAXED);
+    return 0;
+}
+
+typedef struct
+{
+    WorkPool *pool;
+    int index;
+} WorkThread;
+
+static void *workerMain(void *argument)
+{
+    WorkPool *pool = ((WorkThread *)argument)->pool;
+    int index = ((WorkThread *)argument)->index;
+    for (;;)
+    {
+        void *task = takeDeque(&pool->deques[index]);
+        for (int k = 1; !task && k < pool->threads; k++)
+            task = stealDeque(&pool->deques[(index + k) % pool->threads]);
+        if (task)
+        {
+            pool->run(pool->context, index, task);
+            __atomic_sub_fetch(&pool->pending, 1, __ATOMIC_RELEASE);
+        }
+        else if (__atomic_load_n(&pool->pending, __ATOMIC_ACQUIRE) == 0)
+        {
+            return NULL;
+        }
+        else
+        {
+            sched_yield();
+        }
+    }
+}
+
+void runWorkPool(WorkPool *pool, void *root)
+{
+    if (!pushWork(pool, 0, root))
+    {
+        pool->run(pool->context, 0, root);
+        return;
+    }
+
+    WorkThread *workers = calloc(pool->threads, sizeof(WorkThread));
+    for (int k = 0; k < pool->threads; k++)
+    {
+        workers[k].pool = pool;
+        workers[k].index = k;
+    }
+    runRenderThreads(workerMain, workers, sizeof(WorkThread), pool->threads);
+    free(workers);
+}
+
+void freeWorkPool(WorkPool *pool)
+{
+    free(pool->deques);
+    pool->deques = NULL;
+}
@@ -0,0 +1,52 @@
+#ifndef WORK_STEALING_HEADER
+#define WORK_STEALING_HEADER
+
+/* Tareas pendientes que entran en la deque de cada worker. */
+#define WORK_DEQUE_CAPACITY 4096
+
+/**
+ * Deque de Chase y Lev: el dueño apila y desapila por abajo (LIFO, así que
+ * recorre su parte del árbol en profundidad) y los demás roban por arriba
+ * las tareas más viejas, que son las más grandes. Capacidad fija: si está
+ * llena, quien apila ejecuta la tarea en el momento.
+ */
+typedef struct
+{
+    long top;
+    /* top y bottom en líneas de caché distintas: los ladrones sólo escriben top. */
+    char padding[64 - sizeof(long)];
+    long bottom;
+    void *tasks[WORK_DEQUE_CAPACITY];
+} WorkDeque;
+
+/** Ejecuta una tarea en el worker "worker" (0 es el thread que llamó a runWorkPool). */
+typedef void (*WorkFunction)(void *context, int worker, void *task);
+
+typedef struct
+{
+    int threads;
+    WorkDeque *deques;
+    WorkFunction run;
+    void *context;
+    /* Tareas apiladas que todavía no terminaron: cuando llega a 0 no queda trabajo. */
+    long pending;
+} WorkPool;
+
+void initWorkPool(WorkPool *pool, int threads, WorkFunction run, void *context);
+
+/**
+ * Apila una tarea en la deque del worker, que sólo puede llamarla desde su
+ * propio thread. Devuelve 0 si la deque está llena.
+ */
+int pushWork(WorkPool *pool, int worker, void *task);
+
+/**
+ * Ejecuta la tarea raíz y todas las que se apilen desde ella, con el thread
+ * que llama como worker 0 y threads - 1 threads más. Vuelve cuando no queda
+ * ninguna.
+ */
+void runWorkPool(WorkPool *pool, void *root);
+
+void freeWorkPool(WorkPool *pool);
+
+#endif
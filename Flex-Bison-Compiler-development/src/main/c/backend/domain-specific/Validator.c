@@ -20,21 +20,49 @@ ModuleDestructor initializeValidatorModule()
     return _shutdownValidatorModule;
 }
 
-static bool _variableExistsInParams(char *name, IdentifierList *params)
+/* Lugar del parámetro en el frame de la regla: con nombres repetidos vale el último, que es el que tapa a los demás. */
+static int _parameterSlot(char *name, IdentifierList *params)
 {
-    IdentifierList *p = params;
-    while (p != NULL)
+    int slot = -1;
+    int k = 0;
+    for (IdentifierList *p = params; p && p->variable; p = p->identifierList, k++)
     {
-        if (p->variable && strcmp(p->variable->name, name) == 0)
+        if (strcmp(p->variable->name, name) == 0)
         {
-            return true;
+            slot = k;
         }
-        p = p->identifierList;
     }
-    return false;
+    return slot;
+}
+
+static int _parameterCount(IdentifierList *params)
+{
+    int count = 0;
+    for (IdentifierList *p = params; p && p->variable; p = p->identifierList)
+    {
+        count++;
+    }
+    return count;
+}
+
+/*
+ * Resuelve el lugar de una variable que no es parámetro de la regla. Entre
+ * paréntesis ("nested") siempre se aceptó, porque la validación no entraba
+ * ahí: se busca por nombre en las reglas que llamaron (alcance dinámico, ver
+ * Rule.callerVariables). Fuera de paréntesis es un error.
+ */
+static bool _resolveVariable(Variable *variable, Rule *rule, bool nested)
+{
+    variable->slot = _parameterSlot(variable->name, rule->identifierList);
+    if (variable->slot < 0 && nested)
+    {
+        variable->slot = CALLER_VARIABLE_SLOT;
+        rule->callerVariables = true;
+    }
+    return variable->slot != -1;
 }
 
-static bool _validateExpressionVariables(Expression *expr, IdentifierList *params)
+static bool _validateExpressionVariables(Expression *expr, Rule *rule, bool nested)
 {
     if (!expr)
         return true;
@@ -42,10 +70,14 @@ static bool _validateExpressionVariables(Expression *expr, IdentifierList *param
     switch (expr->type)
     {
     case FACTOR:
+        if (expr->factor && expr->factor->type == EXPRESSION)
+        {
+            return _validateExpressionVariables(expr->factor->expression, rule, true);
+        }
         if (expr->factor && expr->factor->type == VARIABLE)
         {
             char *name = expr->factor->variable->name;
-            if (!_variableExistsInParams(name, params))
+            if (!_resolveVariable(expr->factor->variable, rule, nested))
             {
                 logError(
                     _logger,
@@ -62,10 +94,10 @@ static bool _validateExpressionVariables(Expression *expr, IdentifierList *param
     case DIVISION:
     case LOWER_THAN_OP:
     case GREATER_THAN_OP:
-        return _validateExpressionVariables(expr->leftExpression, params) && _validateExpressionVariables(expr->rightExpression, params);
+        return _validateExpressionVariables(expr->leftExpression, rule, nested) && _validateExpressionVariables(expr->rightExpression, rule, nested);
 
     case ABSOLUTE_VALUE:
-        return _validateExpressionVariables(expr->leftExpression, params);
+        return _validateExpressionVariables(expr->leftExpression, rule, nested);
 
     default:
         break;
@@ -75,8 +107,9 @@ static bool _validateExpressionVariables(Expression *expr, IdentifierList *param
 
 static bool _validateEscapeExpression(
     EscapeExpression *expr,
-    IdentifierList *params,
-    const char *escapeVarName)
+    Rule *rule,
+    const char *escapeVarName,
+    bool nested)
 {
     if (!expr)
         return true;
@@ -98,7 +131,7 @@ static bool _validateEscapeExpression(
                 return true;
             }
 
-            if (_variableExistsInParams(name, params))
+            if (_resolveVariable(f->variable, rule, nested))
             {
                 return true;
             }
@@ -112,7 +145,11 @@ static bool _validateEscapeExpression(
 
         case RANGE:
 
-            return _validateEscapeExpression(f->range->start, params, escapeVarName) && _validateEscapeExpression(f->range->end, params, escapeVarName);
+            return _validateEscapeExpression(f->range->start, rule, escapeVarName, nested) && _validateEscapeExpression(f->range->end, rule, escapeVarName, nested);
+
+        case EXPRESSION:
+
+            return _validateEscapeExpression(f->expression, rule, escapeVarName, true);
 
         case CONSTANT:
         case DOUBLE_CONSTANT:
@@ -124,36 +161,88 @@ static bool _validateEscapeExpression(
         }
     }
 
-    return _validateEscapeExpression(expr->leftExpression, params, escapeVarName) && _validateEscapeExpression(expr->rightExpression, params, escapeVarName);
+    return _validateEscapeExpression(expr->leftExpression, rule, escapeVarName, nested) && _validateEscapeExpression(expr->rightExpression, rule, escapeVarName, nested);
 }
 
-static bool _ruleExists(Program *program, char *ruleName)
+/*
+ * Tabla de símbolos de las reglas, armada una sola vez: direccionamiento
+ * abierto por el hash del nombre. Con nombres repetidos queda la primera
+ * regla, que es la que siempre se ejecutó.
+ */
+typedef struct
 {
-    if (!program || !program->sentenceList)
-        return false;
+    Rule **rules;
+    size_t mask;
+} _RuleTable;
+
+static size_t _hashName(const char *name)
+{
+    size_t hash = 2166136261u;
+    for (const unsigned char *c = (const unsigned char *)name; *c; c++)
+    {
+        hash = (hash ^ *c) * 16777619u;
+    }
+    return hash;
+}
+
+static void _buildRuleTable(_RuleTable *table, Program *program)
+{
+    size_t count = 0;
+    for (SentenceList *current = program->sentenceList; current != NULL; current = current->next)
+    {
+        if (current->sentence && current->sentence->sentenceType == SENTENCE_RULE)
+        {
+            count++;
+        }
+    }
+
+    size_t capacity = 16;
+    while (capacity < 2 * count)
+    {
+        capacity *= 2;
+    }
+    table->rules = calloc(capacity, sizeof(Rule *));
+    table->mask = capacity - 1;
 
-    SentenceList *current = program->sentenceList;
-    while (current != NULL)
+    for (SentenceList *current = program->sentenceList; current != NULL; current = current->next)
     {
         Sentence *s = current->sentence;
-        if (s && s->sentenceType == SENTENCE_RULE)
+        if (!s || s->sentenceType != SENTENCE_RULE)
         {
-            if (strcmp(s->rule->variable->name, ruleName) == 0)
-            {
-                return true;
-            }
+            continue;
+        }
+        size_t k = _hashName(s->rule->variable->name) & table->mask;
+        while (table->rules[k] && strcmp(table->rules[k]->variable->name, s->rule->variable->name) != 0)
+        {
+            k = (k + 1) & table->mask;
+        }
+        if (!table->rules[k])
+        {
+            table->rules[k] = s->rule;
         }
-        current = current->next;
     }
-    return false;
+}
+
+static Rule *_findRule(const _RuleTable *table, const char *name)
+{
+    size_t k = _hashName(name) & table->mask;
+    while (table->rules[k])
+    {
+        if (strcmp(table->rules[k]->variable->name, name) == 0)
+        {
+            return table->rules[k];
+        }
+        k = (k + 1) & table->mask;
+    }
+    return NULL;
 }
 
 static bool _validateRuleSentences(
-    Program *program,
-    RuleSentenceList *list,
-    IdentifierList *params)
+    const _RuleTable *table,
+    Rule *rule)
 {
     bool valid = true;
+    RuleSentenceList *list = rule->ruleSentenceList;
 
     while (list != NULL)
     {
@@ -175,9 +264,9 @@ static bool _validateRuleSentences(
                 Point *p = pl->point;
                 if (p)
                 {
-                    if (!_validateExpressionVariables(p->x, params))
+                    if (!_validateExpressionVariables(p->x, rule, false))
                         valid = false;
-                    if (!_validateExpressionVariables(p->y, params))
+                    if (!_validateExpressionVariables(p->y, rule, false))
                         valid = false;
                 }
                 pl = pl->next;
@@ -189,7 +278,8 @@ static bool _validateRuleSentences(
         {
             char *targetName = rs->call->variable->name;
 
-            if (!_ruleExists(program, targetName))
+            rs->call->rule = _findRule(table, targetName);
+            if (!rs->call->rule)
             {
 
                 logWarning(
@@ -199,19 +289,21 @@ static bool _validateRuleSentences(
             }
 
             ExpressionList *args = rs->call->expressionList;
+            rs->call->argumentCount = 0;
             while (args != NULL)
             {
-                if (!_validateExpressionVariables(args->expression, params))
+                if (!_validateExpressionVariables(args->expression, rule, false))
                 {
                     valid = false;
                 }
+                rs->call->argumentCount++;
                 args = args->next;
             }
             break;
         }
 
         case RULE_SENTENCE_IF:
-            if (!_validateExpressionVariables(rs->ifStatement->condition, params))
+            if (!_validateExpressionVariables(rs->ifStatement->condition, rule, false))
             {
                 valid = false;
             }
@@ -229,11 +321,11 @@ static bool _validateRuleSentences(
                 escapeVarName = e->variable->name;
             }
 
-            if (!_validateEscapeExpression(e->initialValue, params, escapeVarName))
+            if (!_validateEscapeExpression(e->initialValue, rule, escapeVarName, false))
                 valid = false;
-            if (!_validateEscapeExpression(e->recursiveAssigment, params, escapeVarName))
+            if (!_validateEscapeExpression(e->recursiveAssigment, rule, escapeVarName, false))
                 valid = false;
-            if (!_validateEscapeExpression(e->untilCondition, params, escapeVarName))
+            if (!_validateEscapeExpression(e->untilCondition, rule, escapeVarName, false))
                 valid = false;
             break;
         }
@@ -253,6 +345,469 @@ static bool _validateRuleSentences(
     return valid;
 }
 
+/*
+ * Si la regla, sin mirar a quién llama, sólo dibuja polígonos y llama a reglas
+ * que existen con todos sus argumentos, y no lee variables de quien la llamó.
+ */
+static bool _ruleIsLocallyParallel(Rule *rule)
+{
+    if (rule->callerVariables)
+    {
+        return false;
+    }
+    for (RuleSentenceList *list = rule->ruleSentenceList; list != NULL; list = list->next)
+    {
+        RuleSentence *rs = list->ruleSentence;
+        if (!rs)
+        {
+            continue;
+        }
+        switch (rs->ruleSentenceType)
+        {
+        case RULE_SENTENCE_POLYGON:
+        case RULE_SENTENCE_IF:
+            break;
+
+        case RULE_SENTENCE_CALL:
+            if (!rs->call->rule || rs->call->argumentCount < rs->call->rule->parameterCount)
+            {
+                return false;
+            }
+            break;
+
+        default:
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * Marca las reglas cuyo árbol de llamadas entero cumple _ruleIsLocallyParallel.
+ * Se parte de suponer que todas lo cumplen (las recursivas también) y se
+ * desmarcan hasta que no cambie nada.
+ */
+static void _markParallelRules(Program *program)
+{
+    for (SentenceList *current = program->sentenceList; current != NULL; current = current->next)
+    {
+        Sentence *s = current->sentence;
+        if (s && s->sentenceType == SENTENCE_RULE)
+        {
+            s->rule->parallel = _ruleIsLocallyParallel(s->rule);
+        }
+    }
+
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        for (SentenceList *current = program->sentenceList; current != NULL; current = current->next)
+        {
+            Sentence *s = current->sentence;
+            if (!s || s->sentenceType != SENTENCE_RULE || !s->rule->parallel)
+            {
+                continue;
+            }
+            for (RuleSentenceList *list = s->rule->ruleSentenceList; list != NULL; list = list->next)
+            {
+                RuleSentence *rs = list->ruleSentence;
+                if (rs && rs->ruleSentenceType == RULE_SENTENCE_CALL && !rs->call->rule->parallel)
+                {
+                    s->rule->parallel = false;
+                    changed = true;
+                    break;
+                }
+            }
+        }
+    }
+}
+
+/* Si la expresión es sólo el parámetro del lugar "slot" (entre paréntesis o no). */
+static bool _isParameter(Expression *expr, int slot)
+{
+    while (expr && expr->type == FACTOR && expr->factor && expr->factor->type == EXPRESSION)
+    {
+        expr = expr->factor->expression;
+    }
+    return expr && expr->type == FACTOR && expr->factor && expr->factor->type == VARIABLE && expr->factor->variable->slot == slot;
+}
+
+/* Si la expresión sólo depende de constantes y de parámetros que no están en los lugares "x" ni "y". */
+static bool _avoidsParameters(Expression *expr, int x, int y)
+{
+    if (!expr)
+        return false;
+
+    switch (expr->type)
+    {
+    case FACTOR:
+        switch (expr->factor->type)
+        {
+        case CONSTANT:
+        case DOUBLE_CONSTANT:
+            return true;
+        case VARIABLE:
+            return expr->factor->variable->slot != x && expr->factor->variable->slot != y;
+        case EXPRESSION:
+            return _avoidsParameters(expr->factor->expression, x, y);
+        default:
+            return false;
+        }
+
+    case ADDITION:
+    case SUBTRACTION:
+    case MULTIPLICATION:
+    case DIVISION:
+    case LOWER_THAN_OP:
+    case GREATER_THAN_OP:
+        return _avoidsParameters(expr->leftExpression, x, y) && _avoidsParameters(expr->rightExpression, x, y);
+
+    case ABSOLUTE_VALUE:
+        return _avoidsParameters(expr->leftExpression, x, y);
+
+    default:
+        return false;
+    }
+}
+
+/*
+ * Si la expresión es "p", "p + d", "d + p" o "p - d", con "p" el parámetro
+ * del lugar "slot" y "d" sin los de "x" ni "y": su valor es el de "p" más el
+ * que toma con "p" en 0, redondeado igual.
+ */
+static bool _isTranslation(Expression *expr, int slot, int x, int y)
+{
+    while (expr && expr->type == FACTOR && expr->factor && expr->factor->type == EXPRESSION)
+    {
+        expr = expr->factor->expression;
+    }
+    if (!expr)
+        return false;
+    if (_isParameter(expr, slot))
+        return true;
+    if (expr->type == ADDITION)
+    {
+        return (_isParameter(expr->leftExpression, slot) && _avoidsParameters(expr->rightExpression, x, y)) ||
+               (_isParameter(expr->rightExpression, slot) && _avoidsParameters(expr->leftExpression, x, y));
+    }
+    if (expr->type == SUBTRACTION)
+    {
+        return _isParameter(expr->leftExpression, slot) && _avoidsParameters(expr->rightExpression, x, y);
+    }
+    return false;
+}
+
+/* Si los parámetros de los lugares "x" e "y" de la regla sólo trasladan lo que dibuja (ver Rule.translationX). */
+static bool _ruleTranslates(Rule *rule, int x, int y)
+{
+    if (rule->callerVariables)
+    {
+        return false;
+    }
+    bool calls = false;
+    for (RuleSentenceList *list = rule->ruleSentenceList; list != NULL; list = list->next)
+    {
+        RuleSentence *rs = list->ruleSentence;
+        if (!rs)
+        {
+            continue;
+        }
+        switch (rs->ruleSentenceType)
+        {
+        case RULE_SENTENCE_POLYGON:
+            for (PointList *p = rs->polygon->pointList; p != NULL; p = p->next)
+            {
+                if (!_isTranslation(p->point->x, x, x, y) || !_isTranslation(p->point->y, y, x, y))
+                {
+                    return false;
+                }
+            }
+            break;
+
+        case RULE_SENTENCE_CALL:
+        {
+            if (rs->call->rule != rule || rs->call->argumentCount < rule->parameterCount)
+            {
+                return false;
+            }
+            ExpressionList *arg = rs->call->expressionList;
+            for (int k = 0; k < rule->parameterCount; k++, arg = arg->next)
+            {
+                bool valid = k == x   ? _isTranslation(arg->expression, x, x, y)
+                             : k == y ? _isTranslation(arg->expression, y, x, y)
+                                      : _avoidsParameters(arg->expression, x, y);
+                if (!valid)
+                {
+                    return false;
+                }
+            }
+            calls = true;
+            break;
+        }
+
+        case RULE_SENTENCE_IF:
+            if (!_avoidsParameters(rs->ifStatement->condition, x, y))
+            {
+                return false;
+            }
+            break;
+
+        default:
+            return false;
+        }
+    }
+    return calls;
+}
+
+/* Busca, en las reglas recursivas, un par de parámetros que sólo trasladen lo que dibujan. */
+static void _markTranslatedRules(Program *program)
+{
+    for (SentenceList *current = program->sentenceList; current != NULL; current = current->next)
+    {
+        Sentence *s = current->sentence;
+        if (!s || s->sentenceType != SENTENCE_RULE)
+        {
+            continue;
+        }
+        Rule *rule = s->rule;
+        for (int x = 0; x < rule->parameterCount && rule->translationX < 0; x++)
+        {
+            for (int y = 0; y < rule->parameterCount; y++)
+            {
+                if (x != y && _ruleTranslates(rule, x, y))
+                {
+                    rule->translationX = x;
+                    rule->translationY = y;
+                    logDebugging(_logger, "La regla '%s' se puede instanciar por traslación.", rule->variable->name);
+                    break;
+                }
+            }
+        }
+    }
+}
+
+/* Una expresión lineal: constante + x * p[x] + y * p[y] + s * p[s]. */
+typedef struct
+{
+    double constant;
+    double x;
+    double y;
+    double s;
+} _LinearForm;
+
+static bool _isConstantForm(const _LinearForm *form)
+{
+    return form->x == 0.0 && form->y == 0.0 && form->s == 0.0;
+}
+
+/*
+ * Si la expresión es lineal en los parámetros de los lugares "x", "y" y "s",
+ * con coeficientes constantes, y no lee ningún otro: deja los coeficientes en
+ * "form".
+ */
+static bool _linearForm(Expression *expr, int x, int y, int s, _LinearForm *form)
+{
+    if (!expr)
+        return false;
+
+    _LinearForm left = {0}, right = {0};
+    switch (expr->type)
+    {
+    case FACTOR:
+        *form = (_LinearForm){0};
+        switch (expr->factor->type)
+        {
+        case CONSTANT:
+            form->constant = expr->factor->constant->value;
+            return true;
+        case DOUBLE_CONSTANT:
+            form->constant = expr->factor->doubleConstant->value;
+            return true;
+        case VARIABLE:
+        {
+            int slot = expr->factor->variable->slot;
+            if (slot < 0)
+                return false;
+            form->x = slot == x;
+            form->y = slot == y;
+            form->s = slot == s;
+            return !_isConstantForm(form);
+        }
+        case EXPRESSION:
+            return _linearForm(expr->factor->expression, x, y, s, form);
+        default:
+            return false;
+        }
+
+    case ADDITION:
+    case SUBTRACTION:
+    {
+        if (!_linearForm(expr->leftExpression, x, y, s, &left) || !_linearForm(expr->rightExpression, x, y, s, &right))
+            return false;
+        double sign = expr->type == ADDITION ? 1.0 : -1.0;
+        form->constant = left.constant + sign * right.constant;
+        form->x = left.x + sign * right.x;
+        form->y = left.y + sign * right.y;
+        form->s = left.s + sign * right.s;
+        return true;
+    }
+
+    case MULTIPLICATION:
+        if (!_linearForm(expr->leftExpression, x, y, s, &left) || !_linearForm(expr->rightExpression, x, y, s, &right))
+            return false;
+        if (!_isConstantForm(&left))
+        {
+            _LinearForm swap = left;
+            left = right;
+            right = swap;
+        }
+        if (!_isConstantForm(&left))
+            return false;
+        form->constant = left.constant * right.constant;
+        form->x = left.constant * right.x;
+        form->y = left.constant * right.y;
+        form->s = left.constant * right.s;
+        return true;
+
+    case DIVISION:
+        if (!_linearForm(expr->leftExpression, x, y, s, &left) || !_linearForm(expr->rightExpression, x, y, s, &right))
+            return false;
+        if (!_isConstantForm(&right) || right.constant == 0.0)
+            return false;
+        form->constant = left.constant / right.constant;
+        form->x = left.x / right.constant;
+        form->y = left.y / right.constant;
+        form->s = left.s / right.constant;
+        return true;
+
+    default:
+        return false;
+    }
+}
+
+/* Si la expresión es "p + a * s", con "p" el parámetro del lugar "slot" y "other" el del otro eje: deja "a". */
+static bool _isScaledOffset(Expression *expr, int slot, int other, int s, double *offset)
+{
+    _LinearForm form;
+    if (!_linearForm(expr, slot, other, s, &form))
+        return false;
+    *offset = form.s;
+    return form.constant == 0.0 && form.x == 1.0 && form.y == 0.0;
+}
+
+/*
+ * Si los parámetros de los lugares "x", "y" y "s" de la regla ubican y
+ * escalan lo que dibuja (ver Rule.scaleX), y deja en "box" una caja que
+ * contiene todo lo que dibujan sus llamadas con x = y = 0 y s = 1. Una cota
+ * superior "u" de las x sirve si cubre los puntos y, para cada llamada,
+ * c + k * u <= u, o sea u >= c / (1 - k): por inducción en la profundidad,
+ * ningún punto la pasa. La cota inferior es igual.
+ */
+static bool _ruleScales(Rule *rule, int x, int y, int s, double box[4])
+{
+    if (rule->callerVariables)
+    {
+        return false;
+    }
+    box[0] = box[1] = 0.0;
+    box[2] = box[3] = 0.0;
+    bool first = true, calls = false;
+    for (RuleSentenceList *list = rule->ruleSentenceList; list != NULL; list = list->next)
+    {
+        RuleSentence *rs = list->ruleSentence;
+        if (!rs)
+        {
+            continue;
+        }
+        double bx, by;
+        switch (rs->ruleSentenceType)
+        {
+        case RULE_SENTENCE_POLYGON:
+            for (PointList *p = rs->polygon->pointList; p != NULL; p = p->next)
+            {
+                if (!_isScaledOffset(p->point->x, x, y, s, &bx) || !_isScaledOffset(p->point->y, y, x, s, &by))
+                {
+                    return false;
+                }
+                box[0] = first || bx < box[0] ? bx : box[0];
+                box[1] = first || by < box[1] ? by : box[1];
+                box[2] = first || bx > box[2] ? bx : box[2];
+                box[3] = first || by > box[3] ? by : box[3];
+                first = false;
+            }
+            break;
+
+        case RULE_SENTENCE_CALL:
+        {
+            if (rs->call->rule != rule || rs->call->argumentCount < rule->parameterCount)
+            {
+                return false;
+            }
+            ExpressionList *arg = rs->call->expressionList;
+            ExpressionList *args[3] = {NULL, NULL, NULL};
+            for (int k = 0; k < rule->parameterCount; k++, arg = arg->next)
+            {
+                args[0] = k == x ? arg : args[0];
+                args[1] = k == y ? arg : args[1];
+                args[2] = k == s ? arg : args[2];
+            }
+            _LinearForm scale;
+            if (!_isScaledOffset(args[0]->expression, x, y, s, &bx) ||
+                !_isScaledOffset(args[1]->expression, y, x, s, &by) ||
+                !_linearForm(args[2]->expression, x, y, s, &scale) || scale.constant != 0.0 ||
+                scale.x != 0.0 || scale.y != 0.0 || !(scale.s > 0.0 && scale.s < 1.0))
+            {
+                return false;
+            }
+            bx /= 1.0 - scale.s;
+            by /= 1.0 - scale.s;
+            box[0] = first || bx < box[0] ? bx : box[0];
+            box[1] = first || by < box[1] ? by : box[1];
+            box[2] = first || bx > box[2] ? bx : box[2];
+            box[3] = first || by > box[3] ? by : box[3];
+            first = false;
+            calls = true;
+            break;
+        }
+
+        case RULE_SENTENCE_IF:
+            break;
+
+        default:
+            return false;
+        }
+    }
+    return calls;
+}
+
+/* Busca, en las reglas recursivas, tres parámetros que ubiquen y escalen lo que dibujan. */
+static void _markScaledRules(Program *program)
+{
+    for (SentenceList *current = program->sentenceList; current != NULL; current = current->next)
+    {
+        Sentence *s = current->sentence;
+        if (!s || s->sentenceType != SENTENCE_RULE)
+        {
+            continue;
+        }
+        Rule *rule = s->rule;
+        int count = rule->parameterCount;
+        for (int k = 0; k < count * count * count && rule->scale < 0; k++)
+        {
+            int x = k % count, y = k / count % count, scale = k / count / count;
+            if (x != y && x != scale && y != scale && _ruleScales(rule, x, y, scale, rule->scaleBox))
+            {
+                rule->scaleX = x;
+                rule->scaleY = y;
+                rule->scale = scale;
+                logDebugging(_logger, "La regla '%s' dibuja adentro de una caja proporcional a un parámetro.",
+                             rule->variable->name);
+            }
+        }
+    }
+}
+
 ComputationResult executeValidator(CompilerState *compilerState)
 {
     ComputationResult result = {.succeeded = true};
@@ -268,7 +823,9 @@ ComputationResult executeValidator(CompilerState *compilerState)
     SentenceList *s = program->sentenceList;
 
     bool hasView = false;
-    char *startRuleName = NULL;
+    Start *start = NULL;
+    _RuleTable table;
+    _buildRuleTable(&table, program);
 
     logDebugging(_logger, "Iniciando validación semántica...");
 
@@ -296,19 +853,21 @@ ComputationResult executeValidator(CompilerState *compilerState)
                 break;
 
             case SENTENCE_START:
-                if (startRuleName != NULL)
+                if (start != NULL)
                 {
                     logWarning(
                         _logger,
                         "Advertencia: Múltiples sentencias START encontradas. Se usará la última.");
                 }
-                startRuleName = sent->start->variable->name;
+                start = sent->start;
+                start->rule = _findRule(&table, start->variable->name);
                 break;
 
             case SENTENCE_RULE:
             {
                 Rule *r = sent->rule;
-                if (!_validateRuleSentences(program, r->ruleSentenceList, r->identifierList))
+                r->parameterCount = _parameterCount(r->identifierList);
+                if (!_validateRuleSentences(&table, r))
                 {
                     result.succeeded = false;
                 }
@@ -329,14 +888,22 @@ ComputationResult executeValidator(CompilerState *compilerState)
         result.succeeded = false;
     }
 
-    if (startRuleName != NULL)
+    free(table.rules);
+    _markParallelRules(program);
+    if (result.succeeded)
+    {
+        _markTranslatedRules(program);
+        _markScaledRules(program);
+    }
+
+    if (start != NULL)
     {
-        if (!_ruleExists(program, startRuleName))
+        if (!start->rule)
         {
             logError(
                 _logger,
                 "Error Semántico: La regla inicial (START) '%s' no está definida.",
-                startRuleName);
+                start->variable->name);
             result.succeeded = false;
         }
     }
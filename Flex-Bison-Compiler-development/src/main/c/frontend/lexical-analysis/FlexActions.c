@@ -172,7 +172,7 @@ CompilationStatus LexemeAction(TokenLabel label){
 
 CompilationStatus DoubleLexemeAction() {
 	Token * token = createToken(_lexicalAnalyzer, DOUBLE);
-	sscanf((token->lexeme), "%lf", &(token->semanticValue->Double));
+	token->semanticValue->string = strdup(token->lexeme);
 	_logTokenAction(__FUNCTION__, token);
 	CompilationStatus status = pushToken(_lexicalAnalyzer, token);
 	destroyToken(token);
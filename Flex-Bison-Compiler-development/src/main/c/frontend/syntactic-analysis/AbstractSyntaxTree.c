@@ -81,6 +81,7 @@ void destroyFactor(Factor * factor) {
 void destroyDoubleConstant(DoubleConstant * doubleConstant){
 	logDebugging(_logger, "Executing destructor: %s", __FUNCTION__);
 	if(doubleConstant != NULL){
+		free(doubleConstant->lexeme);
 		free(doubleConstant);
 	}
 }
@@ -315,11 +316,21 @@ void destroyColor(Color* color){
 	logDebugging(_logger, "Executing destructor: %s", __FUNCTION__);
 	if(color != NULL){
 		free(color->startColor);
+		destroyHexColorList(color->middleColors);
 		free(color->endColor);
 		free(color);
 	}
 }
 
+void destroyHexColorList(HexColorList* hexColorList){
+	logDebugging(_logger, "Executing destructor: %s", __FUNCTION__);
+	if(hexColorList != NULL){
+		free(hexColorList->color);
+		destroyHexColorList(hexColorList->next);
+		free(hexColorList);
+	}
+}
+
 void destroySentenceColor(Sentence* sentence){
 	destroyColor(sentence->color);
 }
@@ -32,6 +32,7 @@ typedef struct Sentence Sentence;
 typedef struct SentenceList SentenceList;
 typedef struct Size Size;
 typedef struct Color Color;
+typedef struct HexColorList HexColorList;
 typedef struct Variable Variable;
 typedef struct Rule Rule;
 typedef struct IdentifierList IdentifierList;
@@ -187,6 +188,8 @@ struct View {
 
 struct DoubleConstant {
 	double value;
+	/* The literal as written, for backends that need more than a double. */
+	char * lexeme;
 };
 
 struct Size {
@@ -196,17 +199,67 @@ struct Size {
 
 struct Color {
 	char * startColor;
+	/* Stops between start and end, evenly spaced along the gradient (NULL for two colors). */
+	HexColorList * middleColors;
 	char * endColor;
 };
 
+struct HexColorList {
+	char * color;
+	HexColorList * next;
+};
+
+/* Slot of a variable that is not a parameter of its rule, looked up by name in the calling rules. */
+#define CALLER_VARIABLE_SLOT -2
+
 struct Variable {
 	char * name;
+	/*
+	 * Frame slot of the rule parameter it references, resolved by the validator
+	 * (-1 otherwise, or CALLER_VARIABLE_SLOT, see Rule.callerVariables).
+	 */
+	int slot;
 };
 
 struct Rule {
 	Variable * variable;
 	IdentifierList * identifierList;
 	RuleSentenceList * ruleSentenceList;
+	/* Number of parameters, which is also the size of its frame. */
+	int parameterCount;
+	/*
+	 * Whether its whole call tree only draws polygons and calls rules with all
+	 * their arguments, so sibling calls can run in any order (set by the validator).
+	 */
+	int parallel;
+	/*
+	 * Frame slots of the parameters that only translate what it draws, or -1:
+	 * every polygon point and every call to itself places them as "x + offset"
+	 * (or "x - offset"), and nothing else depends on them, so calls with the
+	 * same other arguments draw translated copies (set by the validator).
+	 */
+	int translationX;
+	int translationY;
+	/*
+	 * Frame slots of the parameters that place and scale what it draws, or -1:
+	 * every polygon point is "x + a * s" and "y + b * s", and every call to
+	 * itself passes "x + c * s", "y + d * s" and "k * s", with constant a, b,
+	 * c, d and 0 < k < 1. Everything a call draws, its own calls included,
+	 * then lies in (x, y) + s * scaleBox (minX, minY, maxX, maxY), which is
+	 * what level-of-detail pruning checks (set by the validator).
+	 */
+	int scaleX;
+	int scaleY;
+	int scale;
+	double scaleBox[4];
+	/*
+	 * Whether a parenthesised expression reads a variable that is not one of
+	 * its parameters, which takes the value of the innermost calling rule with
+	 * a parameter of that name (dynamic scoping, set by the validator). Its
+	 * calls then depend on more than their arguments, so it is neither
+	 * parallel nor translated.
+	 */
+	int callerVariables;
 };
 
 struct IdentifierList {
@@ -275,6 +328,9 @@ struct IfStatement {
 struct Call {
 	Variable * variable;
 	ExpressionList * expressionList;
+	/* Rule it calls, bound by the validator (NULL if there is none), and how many arguments it passes. */
+	Rule * rule;
+	int argumentCount;
 };
 
 struct Polygon {
@@ -293,6 +349,8 @@ struct Point {
 
 struct Start {
 	Variable * variable;
+	/* Rule it starts from, bound by the validator (NULL if there is none). */
+	Rule * rule;
 };
 
 struct PointsStatement {
@@ -314,6 +372,7 @@ void destroyRange(Range * range);
 void destroyView(View * view);
 void destroySize(Size * size);
 void destroyColor(Color * color);
+void destroyHexColorList(HexColorList * hexColorList);
 void destroyVariable(Variable * variable);
 void destroyRule(Rule * rule);
 void destroyIdentifierList(IdentifierList * identifierList);
@@ -145,7 +145,11 @@ void printSizeSentence(Sentence* sentence) {
 
 void printColorSentence(Sentence* sentence) {
     Color* color = sentence->color;
-    printf("      Color: start=%s, end=%s\n", color->startColor, color->endColor);
+    printf("      Color: start=%s", color->startColor);
+    for (HexColorList* stop = color->middleColors; stop != NULL; stop = stop->next) {
+        printf(", stop=%s", stop->color);
+    }
+    printf(", end=%s\n", color->endColor);
 }
 
 void printStartSentence(Sentence* sentence) {
@@ -100,10 +100,11 @@ Sentence * SentenceExpressionSemanticAction(Expression * expression) {
 	return sentence;
 }
 
-DoubleConstant * DoubleConstantSemanticAction(const double value) {
+DoubleConstant * DoubleConstantSemanticAction(char * lexeme) {
 	_logSyntacticAnalyzerAction(__FUNCTION__);
 	DoubleConstant * doubleConstant = calloc(1, sizeof(DoubleConstant));
-	doubleConstant->value = value;
+	sscanf(lexeme, "%lf", &(doubleConstant->value));
+	doubleConstant->lexeme = lexeme;
 	return doubleConstant;
 }
 
@@ -179,14 +180,39 @@ Size* SizeSemanticAction(Constant* x, Constant* y) {
 	return size;
 }
 
-Color* ColorSemanticAction(char* startColor, char* endColor){
+/* The last color of the list is the end of the gradient; the others are its middle stops. */
+Color* ColorSemanticAction(char* startColor, HexColorList* colors){
 	_logSyntacticAnalyzerAction(__FUNCTION__);
 	Color* color = calloc(1, sizeof(Color));
 	color->startColor = startColor;
-	color->endColor = endColor;
+	HexColorList** last = &colors;
+	while((*last)->next != NULL){
+		last = &(*last)->next;
+	}
+	color->endColor = (*last)->color;
+	free(*last);
+	*last = NULL;
+	color->middleColors = colors;
 	return color;
 }
 
+HexColorList* HexColorListSemanticAction(HexColorList* list, char* color){
+	_logSyntacticAnalyzerAction(__FUNCTION__);
+	HexColorList* node = calloc(1, sizeof(HexColorList));
+	node->color = color;
+	node->next = NULL;
+	if(list == NULL){
+		return node;
+	}
+
+	HexColorList* current = list;
+	while(current->next != NULL){
+		current = current->next;
+	}
+	current->next = node;
+	return list;
+}
+
 Sentence * SentenceColorSemanticAction(Color* color){
 	_logSyntacticAnalyzerAction(__FUNCTION__);
 	Sentence * sentence = calloc(1, sizeof(Sentence));
@@ -199,6 +225,7 @@ Variable * VariableSemanticAction(char * name) {
 	_logSyntacticAnalyzerAction(__FUNCTION__);
 	Variable * variable = calloc(1, sizeof(Variable));
 	variable->name = name;
+	variable->slot = -1;
 	return variable;
 }
 
@@ -208,6 +235,11 @@ Rule * RuleSemanticAction(Variable * variable, IdentifierList * identifierList,
 	rule->variable = variable;
 	rule->identifierList = identifierList;
 	rule->ruleSentenceList = ruleSentenceList;
+	rule->translationX = -1;
+	rule->translationY = -1;
+	rule->scaleX = -1;
+	rule->scaleY = -1;
+	rule->scale = -1;
 	return rule;
 }
 
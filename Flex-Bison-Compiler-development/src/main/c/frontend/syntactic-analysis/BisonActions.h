@@ -24,7 +24,7 @@ Factor * DoubleConstantFactorSemanticAction(DoubleConstant * doubleConstant);
 Factor * VariableFactorSemanticAction(Variable * variable);
 Factor * ExpressionFactorSemanticAction(Expression * expression);
 
-DoubleConstant * DoubleConstantSemanticAction(const double value);
+DoubleConstant * DoubleConstantSemanticAction(char * lexeme);
 Range * RangeSemanticAction(Expression * start, Expression * end);
 View * ViewSemanticAction(Range * xRange, Range * yRange);
 View * ViewSemanticAction(Range * xRange, Range * yRange);
@@ -34,7 +34,8 @@ Sentence * SentenceExpressionSemanticAction(Expression * expression);
 SentenceList * SentenceListSemanticAction(SentenceList * sentenceList,  Sentence * sentence);
 Size* SizeSemanticAction(Constant* x, Constant* y);
 Sentence * SentenceSizeSemanticAction(Size * size);
-Color* ColorSemanticAction(char* startColor, char* endColor);
+Color* ColorSemanticAction(char* startColor, HexColorList* colors);
+HexColorList* HexColorListSemanticAction(HexColorList* list, char* color);
 Sentence * SentenceColorSemanticAction(Color* color);
 Variable * VariableSemanticAction(char * name);
 Rule * RuleSemanticAction(Variable * variable, IdentifierList * identifierList, RuleSentenceList * ruleSentenceList);
@@ -44,6 +44,7 @@ void yyerror(const YYLTYPE * location, const char * message) {}
 	SentenceList * sentenceList;
 	Size * size;
 	Color * color;
+	HexColorList * hexColorList;
 	Start * start;
 	Variable * variable;
 	Rule * rule;
@@ -83,6 +84,7 @@ void yyerror(const YYLTYPE * location, const char * message) {}
 %destructor { destroyDoubleConstant($$); } <doubleConstant>
 %destructor { destroySize($$); } <size>
 %destructor { destroyColor($$); } <color>
+%destructor { destroyHexColorList($$); } <hexColorList>
 %destructor { destroyVariable($$); } <variable>
 %destructor { destroyRule($$); } <rule>
 %destructor { destroyIdentifierList($$); } <identifierList>
@@ -128,7 +130,7 @@ void yyerror(const YYLTYPE * location, const char * message) {}
 %token <token> OPEN_BRACKET
 %token <token> CLOSE_BRACKET
 %token <token> COMMA
-%token <Double> DOUBLE
+%token <string> DOUBLE
 %token <token> LINE_JUMP
 %token <token> SIZE
 %token <token> COLOR
@@ -171,6 +173,7 @@ void yyerror(const YYLTYPE * location, const char * message) {}
 %type <sentenceList> sentenceList
 %type <size> size
 %type <color> color
+%type <hexColorList> hexColorList
 %type <start> start
 %type <rule> rule
 %type <variable> variable
@@ -261,7 +264,11 @@ view: VIEW range[x] range[y] 								{ $$ = ViewSemanticAction($x, $y); }
 size: SIZE constant[x] constant[y]							{ $$ = SizeSemanticAction($x, $y); }
 	;
 
-color: COLOR HEX_COLOR[start] HEX_COLOR[end]                { $$ = ColorSemanticAction($start, $end); }
+color: COLOR HEX_COLOR[start] hexColorList[colors]          { $$ = ColorSemanticAction($start, $colors); }
+	;
+
+hexColorList: hexColorList[list] HEX_COLOR[next]            { $$ = HexColorListSemanticAction($list, $next); }
+	| HEX_COLOR[next]                                       { $$ = HexColorListSemanticAction(NULL, $next); }
 	;
 
 variable: IDENTIFIER 										{ $$ = VariableSemanticAction($1); }
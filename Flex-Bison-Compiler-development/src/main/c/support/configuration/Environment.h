@@ -12,6 +12,13 @@
  */
 const bool getBooleanOrDefault(const char * name, const bool defaultValue);
 
+/**
+ * Analog to "getStringOrDefault", but parsing the value as a decimal integer.
+ * The default value is used when the variable is undefined or is not a valid
+ * integer.
+ */
+const int getIntegerOrDefault(const char * name, const int defaultValue);
+
 /**
  * Gets the value of an environment variable by name, or returns a default
  * value if the variable is undefined.
@@ -0,0 +1,164 @@
+#include "RenderConfiguration.h"
+
+/* PRIVATE FUNCTIONS */
+
+static const bool _booleanValue(const char * value);
+static const char * _optionValue(const char * argument, const char * name);
+static const RenderPrecision _precisionValue(Logger * logger, const char * value, const RenderPrecision defaultValue);
+static const char * _precisionName(const RenderPrecision precision);
+
+/**
+ * Parses a boolean option with the same rule used by the environment: only
+ * "true" is true.
+ */
+static const bool _booleanValue(const char * value) {
+	return strcmp(value, "true") == 0;
+}
+
+/**
+ * If the argument has the form "--name=value", returns a pointer to the value;
+ * otherwise, returns NULL.
+ */
+static const char * _optionValue(const char * argument, const char * name) {
+	const size_t length = strlen(name);
+	if (strncmp(argument, "--", 2) != 0 || strncmp(argument + 2, name, length) != 0) {
+		return NULL;
+	}
+	if (argument[2 + length] != '=') {
+		return NULL;
+	}
+	return argument + 3 + length;
+}
+
+/**
+ * Parses a precision option ("auto", "float", "double" or "double-double").
+ * Any other value is reported and ignored.
+ */
+static const RenderPrecision _precisionValue(Logger * logger, const char * value, const RenderPrecision defaultValue) {
+	if (value == NULL) {
+		return defaultValue;
+	}
+	for (RenderPrecision precision = RENDER_PRECISION_AUTO; precision <= RENDER_PRECISION_DOUBLE_DOUBLE; ++precision) {
+		if (strcmp(value, _precisionName(precision)) == 0) {
+			return precision;
+		}
+	}
+	logWarning(logger, "Unknown precision ignored: \"%s\".", value);
+	return defaultValue;
+}
+
+/**
+ * The name of a precision, as written in the option.
+ */
+static const char * _precisionName(const RenderPrecision precision) {
+	switch (precision) {
+		case RENDER_PRECISION_FLOAT:
+			return "float";
+		case RENDER_PRECISION_DOUBLE:
+			return "double";
+		case RENDER_PRECISION_DOUBLE_DOUBLE:
+			return "double-double";
+		default:
+			return "auto";
+	}
+}
+
+/* PUBLIC FUNCTIONS */
+
+RenderOptions loadRenderOptions(const int length, const char ** arguments) {
+	Logger * logger = createLogger("RenderConfiguration");
+	RenderOptions options = {
+		.threads = getIntegerOrDefault("RENDER_THREADS", 0),
+		.simd = getBooleanOrDefault("RENDER_SIMD", true),
+		.jit = getBooleanOrDefault("RENDER_JIT", true),
+		.native = getBooleanOrDefault("RENDER_NATIVE", false),
+		.instancing = getBooleanOrDefault("RENDER_INSTANCING", true),
+		.lod = getBooleanOrDefault("RENDER_LOD", false),
+		.periodicity = getBooleanOrDefault("RENDER_PERIODICITY", false),
+		.interior = getBooleanOrDefault("RENDER_INTERIOR", false),
+		.subdivision = getBooleanOrDefault("RENDER_SUBDIVISION", false),
+		.supersampling = getIntegerOrDefault("RENDER_SUPERSAMPLING", 0),
+		.smooth = getBooleanOrDefault("RENDER_SMOOTH", false),
+		.symmetry = getBooleanOrDefault("RENDER_SYMMETRY", false),
+		.iterationCache = getBooleanOrDefault("RENDER_ITERATION_CACHE", false),
+		.progressive = getBooleanOrDefault("RENDER_PROGRESSIVE", false),
+		.budget = getIntegerOrDefault("RENDER_BUDGET", 0),
+		.deepZoom = getBooleanOrDefault("RENDER_DEEP_ZOOM", true),
+		.precision = _precisionValue(logger, getStringOrDefault("RENDER_PRECISION", NULL), RENDER_PRECISION_AUTO)
+	};
+	for (int k = 2; k < length; ++k) {
+		const char * value = NULL;
+		if ((value = _optionValue(arguments[k], "threads")) != NULL) {
+			options.threads = atoi(value);
+		}
+		else if ((value = _optionValue(arguments[k], "simd")) != NULL) {
+			options.simd = _booleanValue(value);
+		}
+		else if ((value = _optionValue(arguments[k], "jit")) != NULL) {
+			options.jit = _booleanValue(value);
+		}
+		else if ((value = _optionValue(arguments[k], "native")) != NULL) {
+			options.native = _booleanValue(value);
+		}
+		else if ((value = _optionValue(arguments[k], "instancing")) != NULL) {
+			options.instancing = _booleanValue(value);
+		}
+		else if ((value = _optionValue(arguments[k], "lod")) != NULL) {
+			options.lod = _booleanValue(value);
+		}
+		else if ((value = _optionValue(arguments[k], "periodicity")) != NULL) {
+			options.periodicity = _booleanValue(value);
+		}
+		else if ((value = _optionValue(arguments[k], "interior")) != NULL) {
+			options.interior = _booleanValue(value);
+		}
+		else if ((value = _optionValue(arguments[k], "subdivision")) != NULL) {
+			options.subdivision = _booleanValue(value);
+		}
+		else if ((value = _optionValue(arguments[k], "supersampling")) != NULL) {
+			options.supersampling = atoi(value);
+		}
+		else if ((value = _optionValue(arguments[k], "smooth")) != NULL) {
+			options.smooth = _booleanValue(value);
+		}
+		else if ((value = _optionValue(arguments[k], "symmetry")) != NULL) {
+			options.symmetry = _booleanValue(value);
+		}
+		else if ((value = _optionValue(arguments[k], "iteration-cache")) != NULL) {
+			options.iterationCache = _booleanValue(value);
+		}
+		else if ((value = _optionValue(arguments[k], "progressive")) != NULL) {
+			options.progressive = _booleanValue(value);
+		}
+		else if ((value = _optionValue(arguments[k], "budget")) != NULL) {
+			options.budget = atoi(value);
+		}
+		else if ((value = _optionValue(arguments[k], "deep-zoom")) != NULL) {
+			options.deepZoom = _booleanValue(value);
+		}
+		else if ((value = _optionValue(arguments[k], "precision")) != NULL) {
+			options.precision = _precisionValue(logger, value, options.precision);
+		}
+		else {
+			logWarning(logger, "Unknown option ignored: \"%s\".", arguments[k]);
+		}
+	}
+	if (options.threads < 0) {
+		logWarning(logger, "Invalid amount of threads (%d), using one per processor.", options.threads);
+		options.threads = 0;
+	}
+	if (options.supersampling < 0) {
+		logWarning(logger, "Invalid supersampling grid (%d), disabling it.", options.supersampling);
+		options.supersampling = 0;
+	}
+	if (options.budget < 0) {
+		logWarning(logger, "Invalid render budget (%d ms), disabling it.", options.budget);
+		options.budget = 0;
+	}
+	logDebugging(logger, "Render options: threads=%d, simd=%s, jit=%s, native=%s, instancing=%s, lod=%s, periodicity=%s, interior=%s, subdivision=%s, supersampling=%d, smooth=%s, symmetry=%s, iteration-cache=%s, progressive=%s, budget=%d, deep-zoom=%s, precision=%s.", options.threads,
+		options.simd ? "true" : "false", options.jit ? "true" : "false", options.native ? "true" : "false", options.instancing ? "true" : "false", options.lod ? "true" : "false", options.periodicity ? "true" : "false", options.interior ? "true" : "false",
+		options.subdivision ? "true" : "false", options.supersampling, options.smooth ? "true" : "false",
+		options.symmetry ? "true" : "false", options.iterationCache ? "true" : "false", options.progressive ? "true" : "false", options.budget, options.deepZoom ? "true" : "false", _precisionName(options.precision));
+	destroyLogger(logger);
+	return options;
+}
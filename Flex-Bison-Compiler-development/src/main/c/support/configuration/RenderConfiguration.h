@@ -0,0 +1,18 @@
+#ifndef RENDER_CONFIGURATION_HEADER
+#define RENDER_CONFIGURATION_HEADER
+
+#include "../logging/Logger.h"
+#include "../type/RenderOptions.h"
+#include "Environment.h"
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Loads the rendering options. Every option takes its default value from an
+ * environment variable (e.g., "RENDER_THREADS"), and can be overridden with a
+ * command-line argument of the form "--name=value" (e.g., "--threads=8")
+ * placed after the output image name.
+ */
+RenderOptions loadRenderOptions(const int length, const char ** arguments);
+
+#endif
@@ -2,6 +2,7 @@
 #define COMPILER_STATE_HEADER
 
 #include "../../frontend/syntactic-analysis/AbstractSyntaxTree.h"
+#include "RenderOptions.h"
 
 /**
  * The global state of the compiler. Should transport every data structure
@@ -13,6 +14,11 @@ typedef struct {
 	 */
 	void * abstractSyntaxtTree;
 	const char * outputImageName;
+
+	/**
+	 * Backend tuning options (threads, etc.).
+	 */
+	RenderOptions renderOptions;
 } CompilerState;
 
 #endif
\ No newline at end of file
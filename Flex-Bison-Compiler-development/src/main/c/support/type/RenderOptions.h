@@ -0,0 +1,160 @@
+#ifndef RENDER_OPTIONS_HEADER
+#define RENDER_OPTIONS_HEADER
+
+#include <stdbool.h>
+
+/**
+ * The arithmetic used to iterate escape-time orbits.
+ */
+typedef enum {
+	RENDER_PRECISION_AUTO,
+	RENDER_PRECISION_FLOAT,
+	RENDER_PRECISION_DOUBLE,
+	RENDER_PRECISION_DOUBLE_DOUBLE
+} RenderPrecision;
+
+/**
+ * Options that tune how the backend renders an image. They are loaded from
+ * the environment and can be overridden from the command line. Unless its
+ * documentation says otherwise, an option only changes how fast the image is
+ * produced, never its pixels.
+ */
+typedef struct {
+	/**
+	 * The amount of worker threads used by the parallel renderers. Zero (0)
+	 * means one worker per online processor.
+	 */
+	int threads;
+
+	/**
+	 * Whether the escape-time renderer may iterate several pixels in lockstep
+	 * with SIMD instructions, when the processor supports them.
+	 */
+	bool simd;
+
+	/**
+	 * Whether escape-time formulas without a native kernel, and the rule
+	 * expressions evaluated most often, are compiled to x86-64 machine code.
+	 * Falls back to the interpreters when the processor or the operating
+	 * system does not allow executable memory.
+	 */
+	bool jit;
+
+	/**
+	 * Whether rules are translated to C, compiled with the system compiler
+	 * ($CC, split into words as make does, or "cc") and loaded as a shared
+	 * library, cached by the hash of the generated code and the compiler in a
+	 * directory that only the current user may write to. Calls nested deeper
+	 * than NATIVE_MAX_DEPTH continue in the interpreter. Falls back to the
+	 * interpreter when the program cannot be translated exactly or the
+	 * compiler is not available.
+	 */
+	bool native;
+
+	/**
+	 * Whether calls to rules whose parameters split into a translation and
+	 * the rest (see Rule.translationX) evaluate their sentences once for each
+	 * distinct value of the rest, and then replay them translated.
+	 */
+	bool instancing;
+
+	/**
+	 * Whether calls to recursive rules that place and scale what they draw
+	 * (see Rule.scaleX) are skipped when the box that bounds everything they
+	 * and their own calls could draw lies outside the image, or is a small box
+	 * that is already painted. Other rules are never pruned.
+	 */
+	bool lod;
+
+	/**
+	 * Whether escape-time orbits are checked for exact cycles (Brent's
+	 * algorithm). A pixel whose orbit repeats can never escape, so it stops
+	 * early and is coloured as if it had reached "max:".
+	 */
+	bool periodicity;
+
+	/**
+	 * Whether pixels inside the main cardioid or the period-2 bulb skip the
+	 * iteration entirely. Only applies to formulas recognised as Mandelbrot.
+	 */
+	bool interior;
+
+	/**
+	 * Whether the escape-time renderer only iterates the border of each
+	 * rectangle, and its middle row and column, filling it when all of them
+	 * have the same count (Mariani-Silver). Changes the image: the result is
+	 * approximate, since a uniform border does not guarantee a uniform
+	 * interior at pixel resolution, and a detail that crosses no sampled
+	 * pixel is filled over. Even on connected sets like Mandelbrot's, a few
+	 * pixels can differ from a full render.
+	 */
+	bool subdivision;
+
+	/**
+	 * The side of the grid of samples taken for each escape-time pixel whose
+	 * iteration count differs from one of its neighbours (anti-aliasing only
+	 * along the edges). Changes the image: edge pixels become the average of
+	 * their samples. Zero (0) or one (1) disables it.
+	 */
+	int supersampling;
+
+	/**
+	 * Whether escape-time pixels recognised as z*z + c are coloured by their
+	 * fractional (normalised) iteration count, which removes the bands
+	 * between consecutive counts. Changes the image.
+	 */
+	bool smooth;
+
+	/**
+	 * Whether escape-time formulas that are provably conjugate-symmetric
+	 * (real coefficients, the axis coordinate only as an imaginary part)
+	 * iterate one side of the axis and mirror the other. Changes the image:
+	 * the view is shifted by less than a quarter of a pixel so that the axis
+	 * falls on the pixel grid.
+	 */
+	bool symmetry;
+
+	/**
+	 * Whether each escape-time render keeps the iteration count of every
+	 * pixel in a file next to the output image, keyed by everything that
+	 * decides the counts. A later run that only changes "color:" maps that
+	 * file and recolours it without iterating.
+	 */
+	bool iterationCache;
+
+	/**
+	 * Whether escape-time renders go from coarse to fine: a pass over one
+	 * pixel in 16 along each axis (each one painted as a block), then passes
+	 * that only compute the pixels still missing, and a preview of the output
+	 * image after each of them. Chaos-game points flush previews as they
+	 * accumulate. The final image is the same unless the budget runs out.
+	 */
+	bool progressive;
+
+	/**
+	 * The wall-clock budget of a progressive render, in milliseconds. Once it
+	 * is spent, no further refinement passes run and the image reached so far
+	 * is saved, so it changes the image (blocky escape renders, fewer
+	 * chaos-game points). Zero (0) means no budget.
+	 */
+	int budget;
+
+	/**
+	 * Whether escape-time renders switch to perturbation (one high-precision
+	 * reference orbit, every pixel as a double delta from it) when the view
+	 * is too narrow for double precision.
+	 */
+	bool deepZoom;
+
+	/**
+	 * The arithmetic of escape-time orbits. With "auto", double is used
+	 * unless the view is too narrow for it; narrower views use perturbation
+	 * when deepZoom is enabled and the formula allows it, and double-double
+	 * otherwise. Float (twice the SIMD lanes) is never chosen automatically:
+	 * it changes the image, since its orbits drift from double's near the
+	 * border of the set.
+	 */
+	RenderPrecision precision;
+} RenderOptions;
+
+#endif